@@ -0,0 +1,123 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Runs overlay displays in a plain Ogre window outside of rviz, shared by the benchmarks.
+//
+// The displays are not initialized by a display context: a benchmark calls their initializeOverlay() and enables
+// them with enableDetached(), then passes messages to them like their subscription does. Needs a QApplication.
+
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_BENCHMARK_DISPLAY_HARNESS_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_BENCHMARK_DISPLAY_HARNESS_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+#include <OgreCamera.h>
+#include <OgreRenderWindow.h>
+#include <OgreRoot.h>
+#include <OgreSceneManager.h>
+#include <OgreViewport.h>
+#include <QWindow>
+#include <rviz_common/display.hpp>
+#include <rviz_rendering/render_system.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+namespace benchmark
+{
+  using Clock = std::chrono::steady_clock;
+
+  inline double elapsedMs(Clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  inline double percentile(std::vector<double> values, double p)
+  {
+    if (values.empty()) {
+      return 0.0;
+    }
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+  }
+
+  /** @brief A window rendered by the rviz render system with overlays enabled, like the render panel. */
+  class RenderWindow
+  {
+  public:
+    RenderWindow(int width, int height)
+    {
+      window_.resize(width, height);
+      window_.show();
+      rviz_rendering::RenderSystem * render_system = rviz_rendering::RenderSystem::get();
+      Ogre::RenderWindow * render_window = render_system->makeRenderWindow(window_.winId(), width, height);
+      root_ = render_system->getOgreRoot();
+      scene_manager_ = root_->createSceneManager();
+      render_system->prepareOverlays(scene_manager_);
+      Ogre::Camera * camera = scene_manager_->createCamera("BenchmarkCamera");
+      scene_manager_->getRootSceneNode()->createChildSceneNode()->attachObject(camera);
+      Ogre::Viewport * viewport = render_window->addViewport(camera);
+      viewport->setOverlaysEnabled(true);
+    }
+
+    /** @brief Renders one frame, the OverlayFrameScheduler runs the pending draws at its start. */
+    void renderFrame()
+    {
+      root_->renderOneFrame();
+    }
+
+  private:
+    QWindow window_;
+    Ogre::Root * root_;
+    Ogre::SceneManager * scene_manager_;
+  };
+
+  /** @brief Checks the enabled property of a display without a display context.
+   *
+   * Display::onEnableChanged() needs the scene node and the context of an initialized display, so the change is
+   * not signaled; the caller runs onEnable() of the display afterwards. */
+  inline void enableDetached(rviz_common::Display & display)
+  {
+    const bool blocked = display.blockSignals(true);
+    display.setEnabled(true);
+    display.blockSignals(blocked);
+  }
+}  // namespace benchmark
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_BENCHMARK_DISPLAY_HARNESS_HPP
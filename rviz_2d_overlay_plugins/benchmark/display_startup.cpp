@@ -0,0 +1,127 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Measures the creation time of many text displays, like loading an rviz config with many overlays.
+//
+// Needs an X server for the font database, a virtual one is sufficient:
+//   xvfb-run ros2 run rviz_2d_overlay_plugins display_startup --displays 50
+// The displays are created first, with a cold font database. Afterwards the previous behaviour of
+// every display querying the font database and adding all families to its font property is measured.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QApplication>
+#include <QFontDatabase>
+#include <rviz_common/properties/enum_property.hpp>
+
+#include "font_catalog.hpp"
+#include "overlay_text_display.hpp"
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+
+  double elapsedMs(Clock::time_point start)
+  {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  }
+
+  // gives access to the font property to open it like the property editor does
+  class StartupTextDisplay : public rviz_2d_overlay_plugins::OverlayTextDisplay
+  {
+  public:
+    void expandFontProperty()
+    {
+      Q_EMIT font_property_->requestOptions(font_property_);
+    }
+  };
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  int displays = 50;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    if (arg == "--displays" && i + 1 < argc) {
+      displays = std::atoi(argv[++i]);
+    } else {
+      std::fprintf(stderr, "usage: %s [--displays N]\n", argv[0]);
+      return 1;
+    }
+  }
+
+  QApplication app(argc, argv);
+
+  auto start = Clock::now();
+  std::vector<std::unique_ptr<StartupTextDisplay>> text_displays;
+  for (int i = 0; i < displays; i++) {
+    text_displays.push_back(std::make_unique<StartupTextDisplay>());
+  }
+  const double create_ms = elapsedMs(start);
+
+  start = Clock::now();
+  const int family_count = rviz_2d_overlay_plugins::FontCatalog::instance().families().size();
+  const double catalog_wait_ms = elapsedMs(start);
+
+  start = Clock::now();
+  text_displays.front()->expandFontProperty();
+  const double expand_ms = elapsedMs(start);
+
+  start = Clock::now();
+  std::vector<std::unique_ptr<rviz_common::properties::EnumProperty>> font_properties;
+  for (int i = 0; i < displays; i++) {
+    QFontDatabase database;
+    const QStringList font_families = database.families();
+    font_properties.push_back(
+      std::make_unique<rviz_common::properties::EnumProperty>("font", "DejaVu Sans Mono", "font"));
+    for (int j = 0; j < font_families.size(); j++) {
+      font_properties.back()->addOption(font_families[j], j);
+    }
+  }
+  const double per_display_ms = elapsedMs(start);
+
+  std::printf("%d font families, %d text displays\n", family_count, displays);
+  std::printf("create displays          %9.3f ms\n", create_ms);
+  std::printf("wait for font catalog    %9.3f ms\n", catalog_wait_ms);
+  std::printf("first font expansion     %9.3f ms\n", expand_ms);
+  std::printf("families per display     %9.3f ms (previous behaviour, warm font database)\n", per_display_ms);
+  return 0;
+}
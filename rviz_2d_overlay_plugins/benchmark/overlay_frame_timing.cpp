@@ -0,0 +1,356 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Measures the frame time of many text displays fed with synthetic messages, without an rviz session.
+//
+// The OverlayTextDisplays are run like in rviz, but without a display context: every frame the messages are passed
+// to them like from their subscription, then their draws are run by the OverlayFrameScheduler and the frame is
+// rendered. Needs an X server, a virtual one and software rendering are sufficient:
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run -s "-screen 0 1920x1080x24" \
+//     ros2 run rviz_2d_overlay_plugins overlay_frame_timing --overlays 32 --frames 500
+// Find the number of displays at which the frame time exceeds the budget:
+//   ... overlay_frame_timing --ramp --budget-ms 16.7
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <OgreFrameListener.h>
+#include <QApplication>
+#include <rviz_2d_overlay_msgs/msg/overlay_text.hpp>
+
+#include "display_harness.hpp"
+#include "overlay_frame_scheduler.hpp"
+#include "overlay_text_display.hpp"
+#include "overlay_utils.hpp"
+
+namespace
+{
+  using rviz_2d_overlay_msgs::msg::OverlayText;
+  using rviz_2d_overlay_plugins::benchmark::Clock;
+  using rviz_2d_overlay_plugins::benchmark::elapsedMs;
+  using rviz_2d_overlay_plugins::benchmark::percentile;
+
+  struct Options
+  {
+    int overlays = 16;
+    int frames = 300;
+    int width = 1280;
+    int height = 720;
+    int overlay_width = 256;
+    int overlay_height = 64;
+    // fraction of the displays receiving a message per frame
+    double update_fraction = 1.0;
+    // fraction of the messages changing the texture size, which recreates texture and material
+    double resize_fraction = 0.1;
+    bool ramp = false;
+    double budget_ms = 16.7;
+  };
+
+  struct Timings
+  {
+    std::vector<double> message;
+    std::vector<double> upload;
+    std::vector<double> material;
+    std::vector<double> overlay;
+    std::vector<double> frame;
+  };
+
+  // time spent in the calls of the displays to their overlays, summed over all displays
+  struct OverlayCallTimes
+  {
+    double material = 0.0;
+    double overlay = 0.0;
+  };
+
+  // an overlay timing the recreation of its texture and material and the updates of its overlay element
+  class InstrumentedOverlay : public rviz_2d_overlay_plugins::OverlayObject
+  {
+  public:
+    InstrumentedOverlay(const std::string & name, OverlayCallTimes & times)
+    : OverlayObject(name), times_(times)
+    {
+    }
+
+    void updateTextureSize(unsigned int width, unsigned int height,
+                           Ogre::PixelFormat format = Ogre::PF_A8R8G8B8) override
+    {
+      const auto start = Clock::now();
+      OverlayObject::updateTextureSize(width, height, format);
+      times_.material += elapsedMs(start);
+    }
+
+    void setPosition(double hor_dist, double ver_dist, rviz_2d_overlay_plugins::HorizontalAlignment hor_alignment,
+                     rviz_2d_overlay_plugins::VerticalAlignment ver_alignment) override
+    {
+      const auto start = Clock::now();
+      OverlayObject::setPosition(hor_dist, ver_dist, hor_alignment, ver_alignment);
+      times_.overlay += elapsedMs(start);
+    }
+
+    void setDimensions(double width, double height) override
+    {
+      const auto start = Clock::now();
+      OverlayObject::setDimensions(width, height);
+      times_.overlay += elapsedMs(start);
+    }
+
+    void setTextureCoordinates(double u1, double v1, double u2, double v2) override
+    {
+      const auto start = Clock::now();
+      OverlayObject::setTextureCoordinates(u1, v1, u2, v2);
+      times_.overlay += elapsedMs(start);
+    }
+
+  private:
+    OverlayCallTimes & times_;
+  };
+
+  // a text display initialized without a display context, drawing into an InstrumentedOverlay
+  class BenchmarkTextDisplay : public rviz_2d_overlay_plugins::OverlayTextDisplay
+  {
+  public:
+    explicit BenchmarkTextDisplay(OverlayCallTimes & times)
+    {
+      // names stay unique over all runs, textures are only released with the resource manager
+      static int count = 0;
+      initializeOverlay();
+      // set up like in createOverlay(), which keeps an existing overlay
+      overlay_ = std::make_shared<InstrumentedOverlay>("BenchmarkTextDisplay" + std::to_string(count++), times);
+      overlay_->setDownscalable(true);
+      overlay_->setTextureLostCallback([this]() { require_update_texture_ = true; });
+      overlay_->setPriority(draw_priority_property_->getInt());
+      rviz_2d_overlay_plugins::benchmark::enableDetached(*this);
+      onEnable();
+    }
+
+    // passes the message to processMessage() like the subscription does
+    void receive(const OverlayText::ConstSharedPtr & msg)
+    {
+      incomingMessage(msg);
+    }
+
+    // requests the draw if required, like the render panel every frame
+    void updateFrame(float wall_dt)
+    {
+      update(wall_dt, wall_dt);
+    }
+  };
+
+  void printRow(const char * name, const std::vector<double> & values)
+  {
+    std::printf("%-10s %9.3f %9.3f %9.3f %9.3f\n", name,
+                percentile(values, 0.5), percentile(values, 0.9), percentile(values, 0.99),
+                values.empty() ? 0.0 : *std::max_element(values.begin(), values.end()));
+  }
+
+  bool parseOptions(int argc, char ** argv, Options & options)
+  {
+    for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      const bool has_value = i + 1 < argc;
+      if (arg == "--overlays" && has_value) {
+        options.overlays = std::atoi(argv[++i]);
+      } else if (arg == "--frames" && has_value) {
+        options.frames = std::atoi(argv[++i]);
+      } else if (arg == "--overlay-size" && i + 2 < argc) {
+        options.overlay_width = std::atoi(argv[++i]);
+        options.overlay_height = std::atoi(argv[++i]);
+      } else if (arg == "--update-fraction" && has_value) {
+        options.update_fraction = std::atof(argv[++i]);
+      } else if (arg == "--resize-fraction" && has_value) {
+        options.resize_fraction = std::atof(argv[++i]);
+      } else if (arg == "--ramp") {
+        options.ramp = true;
+      } else if (arg == "--budget-ms" && has_value) {
+        options.budget_ms = std::atof(argv[++i]);
+      } else {
+        std::fprintf(stderr,
+                     "usage: %s [--overlays N] [--frames N] [--overlay-size W H] [--update-fraction F]\n"
+                     "          [--resize-fraction F] [--ramp] [--budget-ms MS]\n", argv[0]);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  // a message placing the display in a grid on the window, wrapping around to stay on screen
+  OverlayText::SharedPtr makeMessage(const Options & options, int index, int height, const std::string & text)
+  {
+    const int columns = std::max(1, options.width / (options.overlay_width + 4));
+    const int rows = std::max(1, options.height / (options.overlay_height + 20));
+    auto msg = std::make_shared<OverlayText>();
+    msg->action = OverlayText::ADD;
+    msg->width = options.overlay_width;
+    msg->height = height;
+    msg->horizontal_distance = 10 + (index % columns) * (options.overlay_width + 4);
+    msg->vertical_distance = 10 + (index / columns % rows) * (options.overlay_height + 20);
+    msg->horizontal_alignment = OverlayText::LEFT;
+    msg->vertical_alignment = OverlayText::TOP;
+    msg->bg_color.a = 0.5f;
+    msg->fg_color.r = 0.1f;
+    msg->fg_color.g = 1.0f;
+    msg->fg_color.b = 0.94f;
+    msg->fg_color.a = 1.0f;
+    msg->text_size = 10.0f;
+    msg->font = "DejaVu Sans Mono";
+    msg->line_width = 2;
+    msg->text = text;
+    return msg;
+  }
+
+  // runs the given number of frames with count displays, all timings are per frame
+  Timings run(const Options & options, int count, QApplication & app,
+              rviz_2d_overlay_plugins::benchmark::RenderWindow & window)
+  {
+    OverlayCallTimes times;
+    std::vector<std::unique_ptr<BenchmarkTextDisplay>> displays;
+    std::vector<int> heights(count, options.overlay_height);
+    for (int i = 0; i < count; i++) {
+      displays.push_back(std::make_unique<BenchmarkTextDisplay>(times));
+    }
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+    rviz_2d_overlay_plugins::OverlayFrameScheduler & scheduler =
+      rviz_2d_overlay_plugins::OverlayFrameScheduler::instance();
+
+    Timings timings;
+    std::vector<OverlayText::SharedPtr> messages(count);
+    auto last_frame = Clock::now();
+    for (int frame = 0; frame < options.frames; frame++) {
+      // the messages of this frame are created up front, like the subscription hands them over
+      for (int i = 0; i < count; i++) {
+        messages[i].reset();
+        if (uniform(rng) >= options.update_fraction) {
+          continue;
+        }
+        // a size change recreates texture and material, like text with a new line count
+        if (uniform(rng) < options.resize_fraction) {
+          heights[i] = (heights[i] == options.overlay_height) ? options.overlay_height + 16 : options.overlay_height;
+        }
+        const std::string text = "overlay " + std::to_string(i) + " frame " + std::to_string(frame) +
+                                 " value " + std::to_string(uniform(rng));
+        messages[i] = makeMessage(options, i, heights[i], text);
+      }
+
+      // message: processMessage() and the per-frame update of every display, which requests the draws
+      times = OverlayCallTimes();
+      auto start = Clock::now();
+      const float wall_dt = std::chrono::duration<float, std::nano>(start - last_frame).count();
+      last_frame = start;
+      for (int i = 0; i < count; i++) {
+        if (messages[i]) {
+          displays[i]->receive(messages[i]);
+        }
+        displays[i]->updateFrame(wall_dt);
+      }
+      const double message_ms = elapsedMs(start);
+      const OverlayCallTimes message_times = times;
+
+      // upload: drawOverlay() of the requested displays, layout and painting into the locked texture; the
+      // recreation of texture and material and the updates of the overlay elements are reported separately
+      start = Clock::now();
+      scheduler.frameStarted(Ogre::FrameEvent());
+      const double draw_ms = elapsedMs(start);
+      timings.message.push_back(message_ms - message_times.material - message_times.overlay);
+      timings.upload.push_back(draw_ms - (times.material - message_times.material) -
+                               (times.overlay - message_times.overlay));
+      timings.material.push_back(times.material);
+      timings.overlay.push_back(times.overlay);
+
+      start = Clock::now();
+      window.renderFrame();
+      timings.frame.push_back(elapsedMs(start));
+
+      // the displays queue their status updates
+      app.processEvents();
+    }
+    return timings;
+  }
+
+  void report(int count, const Timings & timings)
+  {
+    std::printf("\n%d text displays, %zu frames, times in ms\n", count, timings.frame.size());
+    std::printf("%-10s %9s %9s %9s %9s\n", "phase", "p50", "p90", "p99", "max");
+    printRow("message", timings.message);
+    printRow("upload", timings.upload);
+    printRow("material", timings.material);
+    printRow("overlay", timings.overlay);
+    printRow("render", timings.frame);
+  }
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    return 1;
+  }
+
+  QApplication app(argc, argv);
+  rviz_2d_overlay_plugins::benchmark::RenderWindow window(options.width, options.height);
+  // all requested draws run in the timed call of the scheduler instead of being deferred to later frames
+  rviz_2d_overlay_plugins::OverlayFrameScheduler::instance().setBudget(std::chrono::hours(1));
+
+  if (!options.ramp) {
+    report(options.overlays, run(options, options.overlays, app, window));
+    return 0;
+  }
+
+  // doubles the number of displays until the frame time of the slowest 10 % exceeds the budget
+  for (int count = std::max(1, options.overlays); count <= 4096; count *= 2) {
+    const Timings timings = run(options, count, app, window);
+    report(count, timings);
+    std::vector<double> total(timings.frame.size());
+    for (size_t i = 0; i < total.size(); i++) {
+      total[i] = timings.message[i] + timings.upload[i] + timings.material[i] + timings.overlay[i] +
+                 timings.frame[i];
+    }
+    if (percentile(total, 0.9) > options.budget_ms) {
+      std::printf("\nsaturated at %d text displays: p90 frame time %.3f ms exceeds the budget of %.3f ms\n",
+                  count, percentile(total, 0.9), options.budget_ms);
+      return 0;
+    }
+  }
+  std::printf("\nnot saturated with 4096 text displays\n");
+  return 0;
+}
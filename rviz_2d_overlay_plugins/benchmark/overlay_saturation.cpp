@@ -0,0 +1,576 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Finds the message rate at which each display type saturates, without an rviz session.
+//
+// The text, pie chart, plotter and multi gauge displays are run like in rviz, but without a display context. Every
+// frame they are passed the messages due at the current rate like from their subscriptions, then the frame is
+// rendered and the OverlayFrameScheduler runs their draws with its usual budget. The rate is doubled until the
+// frame time exceeds the frame period or draws miss their deadline. The messages follow the settings of
+// overlay_load_generator. Needs an X server, a virtual one and software rendering are sufficient:
+//   LIBGL_ALWAYS_SOFTWARE=1 xvfb-run -s "-screen 0 1920x1080x24" \
+//     ros2 run rviz_2d_overlay_plugins overlay_saturation --displays 8 --types text,gauge
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <QApplication>
+#include <ros_babel_fish/babel_fish.hpp>
+#include <rviz_2d_overlay_msgs/msg/overlay_text.hpp>
+#include <std_msgs/msg/float32.hpp>
+#include <std_msgs/msg/float32_multi_array.hpp>
+
+#include "display_harness.hpp"
+#include "multi_gauge_display.hpp"
+#include "overlay_frame_scheduler.hpp"
+#include "overlay_text_display.hpp"
+#include "pie_chart_display.h"
+#include "plotter_2d_display.hpp"
+
+namespace
+{
+  using rviz_2d_overlay_msgs::msg::OverlayText;
+  using rviz_2d_overlay_plugins::benchmark::Clock;
+  using rviz_2d_overlay_plugins::benchmark::elapsedMs;
+  using rviz_2d_overlay_plugins::benchmark::enableDetached;
+  using rviz_2d_overlay_plugins::benchmark::percentile;
+
+  // different messages passed to every display in turn, so every message changes the display
+  constexpr size_t MESSAGE_POOL_SIZE = 64;
+
+  struct Options
+  {
+    std::vector<std::string> types = {"text", "pie", "plotter", "gauge"};
+    int displays = 8;
+    int width = 1280;
+    int height = 720;
+    double fps = 30.0;
+    // seconds per rate
+    double step = 2.0;
+    double rate = 10.0;
+    double max_rate = 10240.0;
+    // like the parameters of overlay_load_generator
+    int text_size = 80;
+    double markup_density = 0.0;
+    double churn = 0.2;
+    int array_size = 8;
+  };
+
+  struct StepResult
+  {
+    double received_rate = 0.0;
+    std::vector<double> frame;
+    uint64_t deadline_misses = 0;
+  };
+
+  // the displays of one type, initialized without a display context
+  class DisplayLoad
+  {
+  public:
+    virtual ~DisplayLoad() = default;
+    // passes message number index to every display like its subscription does
+    virtual void deliver(uint64_t index) = 0;
+    // the per-frame update of every display, which requests the draws
+    virtual void updateFrame(float wall_dt) = 0;
+  };
+
+  // position of display index, spread over the window
+  int displayLeft(const Options & options, int index)
+  {
+    return 10 + (index * 97) % std::max(1, options.width - 300);
+  }
+
+  int displayTop(const Options & options, int index)
+  {
+    return 10 + (index * 61) % std::max(1, options.height - 200);
+  }
+
+  class SaturationTextDisplay : public rviz_2d_overlay_plugins::OverlayTextDisplay
+  {
+  public:
+    SaturationTextDisplay()
+    {
+      initializeOverlay();
+      enableDetached(*this);
+      onEnable();
+    }
+
+    void receive(const OverlayText::ConstSharedPtr & msg)
+    {
+      incomingMessage(msg);
+    }
+
+    void updateFrame(float wall_dt)
+    {
+      update(wall_dt, wall_dt);
+    }
+  };
+
+  class SaturationPieChartDisplay : public rviz_2d_overlay_plugins::PieChartDisplay
+  {
+  public:
+    SaturationPieChartDisplay(int left, int top)
+    {
+      initializeOverlay();
+      left_property_->setValue(left);
+      top_property_->setValue(top);
+      enableDetached(*this);
+      onEnable();
+    }
+
+    void receive(const std_msgs::msg::Float32::ConstSharedPtr & msg)
+    {
+      incomingMessage(msg);
+    }
+
+    void updateFrame(float wall_dt)
+    {
+      update(wall_dt, wall_dt);
+    }
+  };
+
+  class SaturationPlotterDisplay : public rviz_2d_overlay_plugins::Plotter2DDisplay
+  {
+  public:
+    SaturationPlotterDisplay(int left, int top)
+    {
+      initializeOverlay();
+      topic_field_property_->setString("data");
+      left_property_->setValue(left);
+      top_property_->setValue(top);
+      enableDetached(*this);
+      onEnable();
+    }
+
+    void receive(const ros_babel_fish::CompoundMessage::ConstSharedPtr & msg)
+    {
+      incomingMessage(msg);
+    }
+
+    void updateFrame(float wall_dt)
+    {
+      update(wall_dt, wall_dt);
+    }
+  };
+
+  class SaturationGaugeDisplay : public rviz_2d_overlay_plugins::MultiGaugeDisplay
+  {
+  public:
+    SaturationGaugeDisplay(int left, int top)
+    {
+      initializeOverlay();
+      left_property_->setValue(left);
+      top_property_->setValue(top);
+      enableDetached(*this);
+      onEnable();
+    }
+
+    void receive(const ros_babel_fish::CompoundMessage::ConstSharedPtr & msg)
+    {
+      incomingMessage(msg);
+    }
+
+    void updateFrame(float wall_dt)
+    {
+      update(wall_dt, wall_dt);
+    }
+  };
+
+  // the displays of one type and the messages passed to all of them in turn
+  template<typename Display, typename MessagePtr>
+  class PooledDisplayLoad : public DisplayLoad
+  {
+  public:
+    void deliver(uint64_t index) override
+    {
+      for (size_t i = 0; i < displays_.size(); i++) {
+        const std::vector<MessagePtr> & pool = messages_.size() == 1 ? messages_.front() : messages_[i];
+        displays_[i]->receive(pool[index % pool.size()]);
+      }
+    }
+
+    void updateFrame(float wall_dt) override
+    {
+      for (auto & display : displays_) {
+        display->updateFrame(wall_dt);
+      }
+    }
+
+    std::vector<std::unique_ptr<Display>> displays_;
+    // one pool per display, or a single one shared by all displays
+    std::vector<std::vector<MessagePtr>> messages_;
+  };
+
+  // random words like overlay_load_generator, a churn fraction of them is replaced from message to message
+  class TextGenerator
+  {
+  public:
+    TextGenerator(const Options & options, unsigned int seed)
+    : options_(options), rng_(seed)
+    {
+      size_t length = 0;
+      while (length < static_cast<size_t>(std::max(1, options.text_size))) {
+        words_.push_back(randomWord());
+        markup_.push_back(randomMarkup());
+        length += words_.back().size() + 1;
+      }
+    }
+
+    size_t wordCount() const
+    {
+      return words_.size();
+    }
+
+    std::string next()
+    {
+      std::bernoulli_distribution churn(options_.churn);
+      for (size_t i = 0; i < words_.size(); i++) {
+        if (churn(rng_)) {
+          words_[i] = randomWord();
+          markup_[i] = randomMarkup();
+        }
+      }
+      std::string text;
+      for (size_t i = 0; i < words_.size(); i++) {
+        if (i > 0) {
+          text += i % 8 == 0 ? '\n' : ' ';
+        }
+        if (markup_[i]) {
+          text += "<span style=\"color: #ff8000;\"><b>" + words_[i] + "</b></span>";
+        } else {
+          text += words_[i];
+        }
+      }
+      return text;
+    }
+
+  private:
+    std::string randomWord()
+    {
+      std::uniform_int_distribution<int> length(2, 9);
+      std::uniform_int_distribution<int> letter('a', 'z');
+      std::string word(length(rng_), ' ');
+      for (auto & c : word) {
+        c = static_cast<char>(letter(rng_));
+      }
+      return word;
+    }
+
+    bool randomMarkup()
+    {
+      return std::bernoulli_distribution(options_.markup_density)(rng_);
+    }
+
+    const Options & options_;
+    std::mt19937 rng_;
+    std::vector<std::string> words_;
+    std::vector<bool> markup_;
+  };
+
+  std::unique_ptr<DisplayLoad> makeTextLoad(const Options & options)
+  {
+    auto load = std::make_unique<PooledDisplayLoad<SaturationTextDisplay, OverlayText::ConstSharedPtr>>();
+    for (int i = 0; i < options.displays; i++) {
+      load->displays_.push_back(std::make_unique<SaturationTextDisplay>());
+      // the texts and positions differ per display
+      TextGenerator generator(options, 42 + i);
+      std::vector<OverlayText::ConstSharedPtr> pool;
+      for (size_t m = 0; m < MESSAGE_POOL_SIZE; m++) {
+        auto msg = std::make_shared<OverlayText>();
+        msg->width = 400;
+        msg->height = 20 * (1 + generator.wordCount() / 8);
+        msg->horizontal_distance = displayLeft(options, i);
+        msg->vertical_distance = displayTop(options, i);
+        msg->horizontal_alignment = OverlayText::LEFT;
+        msg->vertical_alignment = OverlayText::TOP;
+        msg->text_size = 10.0f;
+        msg->fg_color.r = 0.94f;
+        msg->fg_color.g = 0.83f;
+        msg->fg_color.b = 0.07f;
+        msg->fg_color.a = 1.0f;
+        msg->text = generator.next();
+        pool.push_back(msg);
+      }
+      load->messages_.push_back(pool);
+    }
+    return load;
+  }
+
+  // values sweeping the default range of the gauges and the plotter
+  float poolValue(size_t index)
+  {
+    return static_cast<float>(index) / static_cast<float>(MESSAGE_POOL_SIZE);
+  }
+
+  std::unique_ptr<DisplayLoad> makePieChartLoad(const Options & options)
+  {
+    auto load =
+      std::make_unique<PooledDisplayLoad<SaturationPieChartDisplay, std_msgs::msg::Float32::ConstSharedPtr>>();
+    for (int i = 0; i < options.displays; i++) {
+      load->displays_.push_back(
+        std::make_unique<SaturationPieChartDisplay>(displayLeft(options, i), displayTop(options, i)));
+    }
+    std::vector<std_msgs::msg::Float32::ConstSharedPtr> pool;
+    for (size_t m = 0; m < MESSAGE_POOL_SIZE; m++) {
+      auto msg = std::make_shared<std_msgs::msg::Float32>();
+      msg->data = poolValue(m);
+      pool.push_back(msg);
+    }
+    load->messages_.push_back(pool);
+    return load;
+  }
+
+  std::unique_ptr<DisplayLoad> makePlotterLoad(const Options & options)
+  {
+    auto load =
+      std::make_unique<PooledDisplayLoad<SaturationPlotterDisplay, ros_babel_fish::CompoundMessage::ConstSharedPtr>>();
+    for (int i = 0; i < options.displays; i++) {
+      load->displays_.push_back(
+        std::make_unique<SaturationPlotterDisplay>(displayLeft(options, i), displayTop(options, i)));
+    }
+    // the plotter subscribes through babel fish, the messages are created the same way
+    auto fish = ros_babel_fish::BabelFish::make_shared();
+    std::vector<ros_babel_fish::CompoundMessage::ConstSharedPtr> pool;
+    for (size_t m = 0; m < MESSAGE_POOL_SIZE; m++) {
+      ros_babel_fish::CompoundMessage::SharedPtr msg = fish->create_message_shared("std_msgs/msg/Float32");
+      std::static_pointer_cast<std_msgs::msg::Float32>(msg->type_erased_message())->data = poolValue(m);
+      pool.push_back(msg);
+    }
+    load->messages_.push_back(pool);
+    return load;
+  }
+
+  std::unique_ptr<DisplayLoad> makeGaugeLoad(const Options & options)
+  {
+    auto load =
+      std::make_unique<PooledDisplayLoad<SaturationGaugeDisplay, ros_babel_fish::CompoundMessage::ConstSharedPtr>>();
+    for (int i = 0; i < options.displays; i++) {
+      load->displays_.push_back(
+        std::make_unique<SaturationGaugeDisplay>(displayLeft(options, i), displayTop(options, i)));
+    }
+    auto fish = ros_babel_fish::BabelFish::make_shared();
+    std::vector<ros_babel_fish::CompoundMessage::ConstSharedPtr> pool;
+    for (size_t m = 0; m < MESSAGE_POOL_SIZE; m++) {
+      ros_babel_fish::CompoundMessage::SharedPtr msg = fish->create_message_shared("std_msgs/msg/Float32MultiArray");
+      auto & data = std::static_pointer_cast<std_msgs::msg::Float32MultiArray>(msg->type_erased_message())->data;
+      for (int e = 0; e < options.array_size; e++) {
+        data.push_back(poolValue((m + e * 7) % MESSAGE_POOL_SIZE));
+      }
+      pool.push_back(msg);
+    }
+    load->messages_.push_back(pool);
+    return load;
+  }
+
+  std::unique_ptr<DisplayLoad> makeLoad(const std::string & type, const Options & options)
+  {
+    if (type == "text") {
+      return makeTextLoad(options);
+    } else if (type == "pie") {
+      return makePieChartLoad(options);
+    } else if (type == "plotter") {
+      return makePlotterLoad(options);
+    } else if (type == "gauge") {
+      return makeGaugeLoad(options);
+    }
+    return nullptr;
+  }
+
+  // runs the displays for one step at the given rate per display
+  StepResult runStep(const Options & options, double rate, DisplayLoad & load, QApplication & app,
+                     rviz_2d_overlay_plugins::benchmark::RenderWindow & window)
+  {
+    rviz_2d_overlay_plugins::OverlayFrameScheduler & scheduler =
+      rviz_2d_overlay_plugins::OverlayFrameScheduler::instance();
+    const uint64_t previous_misses = scheduler.deadlineMisses();
+    const auto frame_period =
+      std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.fps));
+
+    StepResult result;
+    uint64_t delivered = 0;
+    const auto begin = Clock::now();
+    auto last_frame = begin;
+    double seconds = 0.0;
+    while (seconds < options.step) {
+      const auto start = Clock::now();
+      seconds = std::chrono::duration<double>(start - begin).count();
+      // the messages received since the last frame, all of them are processed like by the executor
+      for (const auto due = static_cast<uint64_t>(seconds * rate); delivered < due; delivered++) {
+        load.deliver(delivered);
+      }
+      load.updateFrame(std::chrono::duration<float, std::nano>(start - last_frame).count());
+      last_frame = start;
+      window.renderFrame();
+      result.frame.push_back(elapsedMs(start));
+
+      // the displays queue their status updates
+      app.processEvents();
+      // like the render panel, a frame starts once the frame period is over
+      std::this_thread::sleep_until(start + frame_period);
+    }
+    result.received_rate = delivered / std::max(seconds, 1e-9);
+    result.deadline_misses = scheduler.deadlineMisses() - previous_misses;
+    return result;
+  }
+
+  std::vector<std::string> splitTypes(const std::string & types)
+  {
+    std::vector<std::string> result;
+    std::stringstream ss(types);
+    std::string type;
+    while (std::getline(ss, type, ',')) {
+      if (!type.empty()) {
+        result.push_back(type);
+      }
+    }
+    return result;
+  }
+
+  bool parseOptions(int argc, char ** argv, Options & options)
+  {
+    for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      const bool has_value = i + 1 < argc;
+      if (arg == "--types" && has_value) {
+        options.types = splitTypes(argv[++i]);
+      } else if (arg == "--displays" && has_value) {
+        options.displays = std::atoi(argv[++i]);
+      } else if (arg == "--fps" && has_value) {
+        options.fps = std::atof(argv[++i]);
+      } else if (arg == "--step" && has_value) {
+        options.step = std::atof(argv[++i]);
+      } else if (arg == "--rate" && has_value) {
+        options.rate = std::atof(argv[++i]);
+      } else if (arg == "--max-rate" && has_value) {
+        options.max_rate = std::atof(argv[++i]);
+      } else if (arg == "--text-size" && has_value) {
+        options.text_size = std::atoi(argv[++i]);
+      } else if (arg == "--markup-density" && has_value) {
+        options.markup_density = std::clamp(std::atof(argv[++i]), 0.0, 1.0);
+      } else if (arg == "--churn" && has_value) {
+        options.churn = std::clamp(std::atof(argv[++i]), 0.0, 1.0);
+      } else if (arg == "--array-size" && has_value) {
+        options.array_size = std::atoi(argv[++i]);
+      } else {
+        std::fprintf(stderr,
+                     "usage: %s [--types text,pie,plotter,gauge] [--displays N] [--fps F] [--step S]\n"
+                     "          [--rate HZ] [--max-rate HZ] [--text-size N] [--markup-density F] [--churn F]\n"
+                     "          [--array-size N]\n", argv[0]);
+        return false;
+      }
+    }
+    for (const auto & type : options.types) {
+      if (type != "text" && type != "pie" && type != "plotter" && type != "gauge") {
+        std::fprintf(stderr, "unknown display type '%s', use text, pie, plotter or gauge\n", type.c_str());
+        return false;
+      }
+    }
+    if (options.displays < 1 || options.fps <= 0.0 || options.step <= 0.0 || options.rate <= 0.0 ||
+        options.array_size < 1) {
+      std::fprintf(stderr, "--displays, --fps, --step, --rate and --array-size must be positive\n");
+      return false;
+    }
+    return true;
+  }
+
+  struct Saturation
+  {
+    std::string type;
+    // highest rate per display within the frame period and without deadline misses, 0 if none
+    double sustained_rate = 0.0;
+    // rate and p90 frame time of the first saturated step, 0 if not saturated
+    double saturated_rate = 0.0;
+    double saturated_frame_ms = 0.0;
+  };
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    return 1;
+  }
+
+  QApplication app(argc, argv);
+  rviz_2d_overlay_plugins::benchmark::RenderWindow window(options.width, options.height);
+  const double frame_period_ms = 1000.0 / options.fps;
+
+  std::vector<Saturation> results;
+  for (const auto & type : options.types) {
+    std::unique_ptr<DisplayLoad> load = makeLoad(type, options);
+    Saturation saturation;
+    saturation.type = type;
+    std::printf("\n%s: %d displays, frame period %.3f ms, times in ms\n", type.c_str(), options.displays,
+                frame_period_ms);
+    std::printf("%10s %10s %9s %9s %9s %7s\n", "rate Hz", "recv Hz", "p50", "p90", "max", "misses");
+    // doubles the rate per display until the frame time of the slowest 10 % exceeds the frame period
+    for (double rate = options.rate; rate <= options.max_rate; rate *= 2.0) {
+      const StepResult step = runStep(options, rate, *load, app, window);
+      const double p90 = percentile(step.frame, 0.9);
+      std::printf("%10.1f %10.1f %9.3f %9.3f %9.3f %7lu\n", rate, step.received_rate,
+                  percentile(step.frame, 0.5), p90,
+                  step.frame.empty() ? 0.0 : *std::max_element(step.frame.begin(), step.frame.end()),
+                  static_cast<unsigned long>(step.deadline_misses));
+      if (p90 > frame_period_ms || step.deadline_misses > 0) {
+        saturation.saturated_rate = rate;
+        saturation.saturated_frame_ms = p90;
+        break;
+      }
+      saturation.sustained_rate = rate;
+    }
+    results.push_back(saturation);
+  }
+
+  std::printf("\n%-8s %14s %14s %14s\n", "display", "sustained Hz", "saturated Hz", "p90 frame ms");
+  for (const auto & saturation : results) {
+    if (saturation.saturated_rate > 0.0) {
+      std::printf("%-8s %14.1f %14.1f %14.3f\n", saturation.type.c_str(), saturation.sustained_rate,
+                  saturation.saturated_rate, saturation.saturated_frame_ms);
+    } else {
+      std::printf("%-8s %14.1f %14s %14s\n", saturation.type.c_str(), saturation.sustained_rate,
+                  "-", "-");
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,168 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+// Measures the layout and paint time of the text of an OverlayTextDisplay for short numeric strings, the typical
+// content of a text overlay, with and without markup. Text with markup goes through the rich text layout of
+// both the text and its shadow, plain text through the plain text fast path.
+//
+// Needs no X server, the offscreen platform is sufficient:
+//   QT_QPA_PLATFORM=offscreen ros2 run rviz_2d_overlay_plugins overlay_text_layout --messages 20000
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <QGuiApplication>
+#include <QImage>
+#include <QPainter>
+
+#include "font_cache.hpp"
+#include "overlay_text_layout.hpp"
+
+namespace
+{
+  using Clock = std::chrono::steady_clock;
+
+  struct Options
+  {
+    int messages = 10000;
+    int width = 128;
+    int height = 32;
+    int text_size = 12;
+  };
+
+  double elapsedUs(Clock::time_point start)
+  {
+    return std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+  }
+
+  double percentile(std::vector<double> values, double p)
+  {
+    if (values.empty()) {
+      return 0.0;
+    }
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(p * values.size()));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+  }
+
+  bool parseOptions(int argc, char ** argv, Options & options)
+  {
+    for (int i = 1; i < argc; i++) {
+      const std::string arg = argv[i];
+      const bool has_value = i + 1 < argc;
+      if (arg == "--messages" && has_value) {
+        options.messages = std::atoi(argv[++i]);
+      } else if (arg == "--size" && i + 2 < argc) {
+        options.width = std::atoi(argv[++i]);
+        options.height = std::atoi(argv[++i]);
+      } else if (arg == "--text-size" && has_value) {
+        options.text_size = std::atoi(argv[++i]);
+      } else {
+        std::fprintf(stderr, "usage: %s [--messages N] [--size W H] [--text-size N]\n", argv[0]);
+        return false;
+      }
+    }
+    return true;
+  }
+
+  std::vector<std::string> makeMessages(const Options & options, bool markup)
+  {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> speed(0.0, 40.0);
+    std::vector<std::string> messages;
+    messages.reserve(options.messages);
+    char text[64];
+    for (int i = 0; i < options.messages; i++) {
+      std::snprintf(text, sizeof(text), "%.2f m/s", speed(rng));
+      // the display wrapped every text like this before the plain text fast path
+      messages.push_back(markup ? "<span style=\"color: rgba(25, 255, 240, 255);\">" + std::string(text) + "</span>"
+                                : std::string(text));
+    }
+    return messages;
+  }
+
+  // lays out and paints every message like the display does for a new message, times in microseconds
+  void run(const char * name, const Options & options, const std::vector<std::string> & messages)
+  {
+    QImage hud(options.width, options.height, QImage::Format_ARGB32_Premultiplied);
+    rviz_2d_overlay_plugins::OverlayTextLayout layout;
+    std::vector<double> layout_times;
+    std::vector<double> paint_times;
+    layout_times.reserve(messages.size());
+    paint_times.reserve(messages.size());
+    const std::shared_ptr<const rviz_2d_overlay_plugins::ResolvedFont> font =
+      rviz_2d_overlay_plugins::FontCache::instance().get("Liberation Sans", options.text_size, QFont::Bold);
+    for (const std::string & message : messages) {
+      hud.fill(QColor(0, 0, 0, 128));
+      QPainter painter(&hud);
+      painter.setRenderHint(QPainter::Antialiasing, true);
+      painter.setFont(font->font);
+      auto start = Clock::now();
+      layout.layout(message, options.width, options.height, *font, painter.transform());
+      layout_times.push_back(elapsedUs(start));
+      start = Clock::now();
+      layout.draw(painter, 0, QColor(25, 255, 240), Qt::black, 2);
+      paint_times.push_back(elapsedUs(start));
+      painter.end();
+    }
+    std::printf("%-6s %-8s %9.2f %9.2f %9.2f\n", name, "layout",
+                percentile(layout_times, 0.5), percentile(layout_times, 0.9), percentile(layout_times, 0.99));
+    std::printf("%-6s %-8s %9.2f %9.2f %9.2f\n", name, "paint",
+                percentile(paint_times, 0.5), percentile(paint_times, 0.9), percentile(paint_times, 0.99));
+  }
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  Options options;
+  if (!parseOptions(argc, argv, options)) {
+    return 1;
+  }
+
+  QGuiApplication app(argc, argv);
+
+  std::printf("%d messages, %dx%d texture, times in us\n", options.messages, options.width, options.height);
+  std::printf("%-6s %-8s %9s %9s %9s\n", "text", "phase", "p50", "p90", "p99");
+  run("rich", options, makeMessages(options, true));
+  run("plain", options, makeMessages(options, false));
+  return 0;
+}
@@ -0,0 +1,89 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_FIELD_FORMATTER_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_FIELD_FORMATTER_HPP
+
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <ros_babel_fish/babel_fish.hpp>
+
+#include "message_field_access.hpp"
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Formats messages according to a template referencing message fields.
+   *
+   * Fields are referenced by their path in braces, optionally followed by a format specification, e.g.
+   * "v={twist.linear.x:.2f} m/s". The specification is [flags][width][.precision][type] with the flags "+- 0#"
+   * and the types f, e, g, d, x, X, o and s. Numeric arrays are formatted element wise as "[a, b, c]".
+   * Braces are escaped by doubling them.
+   *
+   * The template is parsed once and the fields are resolved with the first message of a type; formatting a message
+ * only appends to the given output string. */
+  class FieldFormatter
+  {
+  public:
+    /** @throws std::invalid_argument if the template or one of its format specifications is malformed. */
+    explicit FieldFormatter(const std::string & format);
+
+    /** @brief Replaces the content of out with the formatted message, reusing its capacity.
+     *
+     * @throws ros_babel_fish::BabelFishException if a field does not exist or cannot be formatted. */
+    void format(const ros_babel_fish::CompoundMessage & msg, std::string & out);
+
+  private:
+    struct Segment
+    {
+      // printed verbatim if there is no field
+      std::string literal;
+      std::optional<FieldAccessor> field;
+      // printf format of a single value, empty for the default representation
+      std::string printf_format;
+      bool integer_conversion = false;
+    };
+
+    static Segment parseField(const std::string & field);
+    void appendValue(double value, const Segment & segment, std::string & out);
+
+    std::vector<Segment> segments_;
+    // element values of array fields, kept to reuse the allocation
+    std::vector<double> values_;
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_FIELD_FORMATTER_HPP
@@ -0,0 +1,101 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_FONT_CACHE_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_FONT_CACHE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+
+#include <QFont>
+#include <QFontMetrics>
+#include <QString>
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief A font together with its metrics, resolved once. */
+  struct ResolvedFont
+  {
+    explicit ResolvedFont(const QFont & font);
+
+    QFont font;
+    QFontMetrics metrics;
+  };
+
+  /** @brief Process-wide cache of the fonts used to draw the overlays, keyed by family, point size and weight.
+   *
+   * Every text path of the displays takes its fonts from here, so a font and its metrics are only resolved
+   * the first time they are used. The least recently used fonts are dropped once the capacity is exceeded. */
+  class FontCache
+  {
+  public:
+    static FontCache & instance();
+
+    /** @brief Returns the font, resolving it if it is not cached.
+     *
+     * @param family font family, the application font if empty */
+    std::shared_ptr<const ResolvedFont> get(const QString & family, int point_size, int weight = QFont::Normal);
+    /** @brief Shorthand for get(family, point_size, weight)->font. */
+    QFont font(const QString & family, int point_size, int weight = QFont::Normal);
+
+    /** @brief Number of cached fonts, 64 by default. */
+    void setCapacity(size_t capacity);
+    size_t capacity() const;
+    size_t size() const;
+    /** @brief Number of fonts resolved because they were not cached. */
+    uint64_t misses() const;
+
+  private:
+    using Key = std::tuple<QString, int, int>;
+    using Entry = std::pair<Key, std::shared_ptr<const ResolvedFont>>;
+
+    FontCache() = default;
+    void evict();
+
+    mutable std::mutex mutex_;
+    // most recently used first
+    std::list<Entry> entries_;
+    std::map<Key, std::list<Entry>::iterator> index_;
+    size_t capacity_ = 64;
+    uint64_t misses_ = 0;
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_FONT_CACHE_HPP
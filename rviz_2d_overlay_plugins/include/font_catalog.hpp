@@ -0,0 +1,71 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_FONT_CATALOG_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_FONT_CATALOG_HPP
+
+#include <future>
+
+#include <QStringList>
+#include <rviz_common/properties/enum_property.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Process-wide list of the installed font families.
+   *
+   * The font database is queried once on a background thread, started by the first call of instance().
+   * Displays only add their default font to the font property and fill in the families when the
+   * property editor is opened the first time, so creating a display does not depend on the number
+   * of installed fonts. */
+  class FontCatalog
+  {
+  public:
+    /** @brief Returns the catalog and starts loading the families, needs an existing QGuiApplication. */
+    static FontCatalog & instance();
+
+    /** @brief Sorted font families, blocks until they are loaded. */
+    const QStringList & families() const;
+    bool ready() const;
+    /** @brief Replaces the options of the property with the font families, the selected font is kept. */
+    void fillOptions(rviz_common::properties::EnumProperty & property) const;
+
+  private:
+    FontCatalog();
+
+    std::shared_future<QStringList> families_;
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_FONT_CATALOG_HPP
@@ -0,0 +1,106 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_GAUGE_UTILS_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_GAUGE_UTILS_HPP
+
+#include <QColor>
+#include <QPainter>
+#include <QRect>
+#include <QString>
+
+namespace rviz_2d_overlay_plugins
+{
+  enum class GaugeShape : int {
+    CIRCLE = 0,
+    HORIZONTAL_BAR = 1,
+    VERTICAL_BAR = 2,
+  };
+
+  /** @brief Appearance of a circular gauge, as configured by the gauge display properties. */
+  struct GaugeStyle
+  {
+    QColor fg_color;
+    QColor bg_color;
+    QColor max_color;
+    QColor med_color;
+    double fg_alpha;
+    double fg_alpha2;
+    double bg_alpha;
+    double min_value;
+    double max_value;
+    double max_color_threshold;
+    double med_color_threshold;
+    bool auto_color_change;
+    bool clockwise_rotate;
+    int text_size;
+  };
+
+  /** @brief Foreground color for the given value, blending towards the max/med colors if
+   * auto color change is enabled. The alpha of the returned color is not set. */
+  QColor gaugeValueColor(const GaugeStyle & style, double value);
+
+  /** @brief Draws the static parts of a gauge (outer ring and value indicator ring) into cell.
+   *
+   * The cell includes the caption area of height caption_offset at its bottom.
+   * The background is expected to be filled already. */
+  void drawGaugeRing(
+    QPainter & painter, const QRect & cell, int caption_offset,
+    const QColor & value_color, const GaugeStyle & style);
+
+  /** @brief Draws the value arc, the value text and optionally the caption into cell. */
+  void drawGaugeValue(
+    QPainter & painter, const QRect & cell, int caption_offset,
+    const QColor & value_color, double value, const QString & caption, const GaugeStyle & style);
+
+  /** @brief Value as displayed by the gauges, with two decimals. */
+  QString formatGaugeValue(double value);
+
+  /** @brief Area inside the frame of a bar gauge occupying bar. */
+  QRect barGaugeInnerRect(const QRect & bar);
+
+  /** @brief Part of the inner bar area covered by value.
+   *
+   * Horizontal bars grow from the left, vertical bars from the bottom, unless clockwise
+   * rotation is set in style, which reverses the direction. */
+  QRect barGaugeFillRect(const QRect & inner, double value, bool vertical, const GaugeStyle & style);
+
+  /** @brief Draws frame and fill of a bar gauge. The background is expected to be filled already. */
+  void drawBarGauge(
+    QPainter & painter, const QRect & bar, bool vertical,
+    const QColor & value_color, double value, const GaugeStyle & style);
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_GAUGE_UTILS_HPP
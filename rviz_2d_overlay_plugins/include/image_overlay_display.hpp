@@ -0,0 +1,175 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_IMAGE_OVERLAY_DISPLAY_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_IMAGE_OVERLAY_DISPLAY_HPP
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "ros_babel_fish_topic_display.hpp"
+#ifndef Q_MOC_RUN
+  #include <rviz_common/properties/int_property.hpp>
+  #include <rviz_common/properties/string_property.hpp>
+  #include <sensor_msgs/msg/compressed_image.hpp>
+  #include "image_utils.hpp"
+  #include "latest_task_worker.hpp"
+  #include "overlay_frame_scheduler.hpp"
+  #include "overlay_texture_budget.hpp"
+  #include "property_batch.hpp"
+  #include "overlay_utils.hpp"
+#endif
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Shows a sensor_msgs/Image, sensor_msgs/CompressedImage or rviz_2d_overlay_msgs/OverlayImage as overlay.
+   *
+   * Images are not painted with QPainter, their rows are copied from the message into the locked texture.
+   * RGBA and BGRA images are uploaded to a texture of the same pixel format without any conversion.
+   * Images larger than the overlay are reduced with an area filter on a worker thread first, smaller
+   * images are stretched by the panel. OverlayImage messages carry their own size and position, the
+   * size and position properties are only used for the sensor_msgs types.
+   *
+   * Compressed images are decoded by a pool of worker threads into recycled buffers. Every worker only keeps
+   * the newest pending message and a decoded frame is dropped if a newer one is shown already, so only the
+   * latest frame is uploaded. */
+  class ImageOverlayDisplay
+    : public RosBabelFishTopicDisplay
+  {
+    Q_OBJECT
+  public:
+    ImageOverlayDisplay();
+    ~ImageOverlayDisplay() override;
+    void load(const rviz_common::Config & config) override;
+    void setTopic(const QString & topic, const QString & datatype) override;
+    // methods for OverlayPickerTool
+    virtual bool isInRegion(int x, int y);
+    virtual void movePosition(int x, int y);
+    virtual void setPosition(int x, int y);
+    virtual int getX() const { return placement_.horizontal_distance; };
+    virtual int getY() const { return placement_.vertical_distance; };
+
+  protected:
+    struct Placement
+    {
+      // requested size of the overlay, 0 for the image size
+      int width = 0;
+      int height = 0;
+      int horizontal_distance = 0;
+      int vertical_distance = 0;
+      HorizontalAlignment horizontal_alignment = HorizontalAlignment::LEFT;
+      VerticalAlignment vertical_alignment = VerticalAlignment::TOP;
+    };
+
+    struct Frame
+    {
+      // keeps the pixels of view alive, either the received message or the downscaled copy
+      std::shared_ptr<const void> storage;
+      ImageView view;
+      // size of the overlay on screen
+      uint32_t panel_width = 0;
+      uint32_t panel_height = 0;
+      uint64_t sequence = 0;
+    };
+
+    void onInitialize() override;
+    void onEnable() override;
+    void onDisable() override;
+    void update(float wall_dt, float ros_dt) override;
+    /** @brief Upload work, run by the OverlayFrameScheduler. */
+    virtual void drawOverlay();
+    void updateTopic() override;
+    void processMessage(ros_babel_fish::CompoundMessage::ConstSharedPtr msg) override;
+
+    /** @brief Makes the latest image the next frame, downscaling it on the worker if it is larger than the overlay. */
+    void scheduleFrame();
+    /** @brief Computes the overlay size of the frame and downscales it if it is larger than the overlay. */
+    static Frame fitFrame(const Frame & source, const Placement & placement);
+    /** @brief Decodes a compressed image, run on a decoder thread. */
+    void decodeFrame(const sensor_msgs::msg::CompressedImage & image, uint64_t sequence, const Placement & placement);
+    /** @brief Reports the error in the Image status with the next update, an empty error removes the status. */
+    void setImageError(const QString & error);
+    void applyPosition();
+
+    std::unique_ptr<rviz_common::properties::StringProperty> topic_message_type_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> width_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> height_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> left_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> top_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> decode_threads_property_;
+
+    std::unique_ptr<rviz_common::properties::IntProperty> draw_priority_property_;
+
+    rviz_2d_overlay_plugins::OverlayObject::SharedPtr overlay_;
+    ScheduledDraw::SharedPtr scheduled_draw_;
+    std::unique_ptr<LatestTaskWorker> worker_;
+    std::vector<std::unique_ptr<LatestTaskWorker>> decoders_;
+    size_t next_decoder_;
+    std::shared_ptr<ImagePool> image_pool_;
+
+    std::string message_type_;
+    // placement from the properties, replaced by the placement of OverlayImage messages
+    Placement property_placement_;
+    Placement placement_;
+    // latest received image at its original size
+    Frame source_;
+    // next or currently shown frame
+    Frame frame_;
+    uint64_t sequence_;
+    // frames up to this sequence were received before disabling or deleting the overlay
+    uint64_t discarded_sequence_;
+    bool frame_changed_;
+    // an OverlayImage with the DELETE action was received
+    bool deleted_;
+    QString image_error_;
+    bool image_error_changed_;
+    uint64_t reported_deadline_misses_;
+    ReportedTextureUsage reported_texture_usage_;
+    PropertyBatch property_batch_;
+
+    std::mutex mutex_;
+
+  protected Q_SLOTS:
+    void updateDrawPriority();
+    void updateTopicMessageType();
+    void updateSize();
+    void updateLeft();
+    void updateTop();
+    void updateDecodeThreads();
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_IMAGE_OVERLAY_DISPLAY_HPP
@@ -0,0 +1,112 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_IMAGE_UTILS_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_IMAGE_UTILS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <OgrePixelFormat.h>
+#include <QImage>
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Pixel layouts images can be shown in, named by their byte order in memory. */
+  enum class ImageFormat : uint8_t
+  {
+    BGRA8,
+    RGBA8,
+    MONO8,
+  };
+
+  /** @brief Non-owning view of the pixels of an image, e.g. the data of a sensor_msgs/Image. */
+  struct ImageView
+  {
+    const uint8_t * data = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // bytes per row, at least width times the bytes per pixel
+    size_t step = 0;
+    ImageFormat format = ImageFormat::BGRA8;
+  };
+
+  /** @brief Maps a sensor_msgs/image_encodings name to the image format, false if it is not supported. */
+  bool imageFormatFromEncoding(const std::string & encoding, ImageFormat & format);
+  uint32_t bytesPerPixel(ImageFormat format);
+  /** @brief Texture format the image is uploaded to, matching formats are copied without conversion. */
+  Ogre::PixelFormat texturePixelFormat(ImageFormat format);
+
+  /** @brief Views the pixels of the image, false if its format has no ImageFormat counterpart. */
+  bool imageViewFromQImage(const QImage & image, ImageView & view);
+
+  /** @brief Copies the image into the locked pixel box of a texture of the same size.
+   *
+   * Rows are copied one by one to respect the row pitch of the texture. If the texture has the pixel format
+   * of texturePixelFormat(), BGRA and RGBA rows are copied as they are, mono images are expanded to opaque gray. */
+  void copyToPixelBox(const ImageView & image, const Ogre::PixelBox & box);
+
+  /** @brief Reduces the image to width x height with an area filter, every target pixel is the average of the
+   * source pixels it covers.
+   *
+   * The filter is separable and works in 8 bit fixed point, its inner loops run over contiguous rows so the
+   * compiler can vectorize them. The target keeps the format of the source and is stored without padding.
+   * The target size must not exceed the source size. */
+  void downscaleArea(const ImageView & source, uint32_t width, uint32_t height, std::vector<uint8_t> & target);
+
+  /** @brief Recycles the images decoded on worker threads.
+   *
+   * An image goes back to the pool when its last reference is released, QImageReader::read() decodes into
+   * its memory again if the size and format did not change. */
+  class ImagePool : public std::enable_shared_from_this<ImagePool>
+  {
+  public:
+    explicit ImagePool(size_t max_free = 4);
+    std::shared_ptr<QImage> acquire();
+
+  private:
+    void release(QImage * image);
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<QImage>> free_;
+    size_t max_free_;
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_IMAGE_UTILS_HPP
@@ -0,0 +1,77 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_LATEST_TASK_WORKER_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_LATEST_TASK_WORKER_HPP
+
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Runs tasks one after another on a background thread, keeping only the latest pending task.
+   *
+   * A task submitted while the previous one still waits replaces it, so a worker that falls behind
+   * the incoming messages skips to the newest one instead of building up a queue. */
+  class LatestTaskWorker
+  {
+  public:
+    LatestTaskWorker();
+    /** @brief Waits for the running task, a pending task is dropped. */
+    ~LatestTaskWorker();
+    LatestTaskWorker(const LatestTaskWorker &) = delete;
+    LatestTaskWorker & operator=(const LatestTaskWorker &) = delete;
+
+    void submit(std::function<void()> task);
+    /** @brief Number of tasks replaced by a newer one before they started. */
+    uint64_t dropped() const;
+
+  private:
+    void run();
+
+    mutable std::mutex mutex_;
+    std::condition_variable condition_;
+    std::function<void()> pending_;
+    uint64_t dropped_ = 0;
+    bool stop_ = false;
+    // started last, after all members it uses are initialized
+    std::thread thread_;
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_LATEST_TASK_WORKER_HPP
@@ -0,0 +1,180 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_LOG_CONSOLE_DISPLAY_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_LOG_CONSOLE_DISPLAY_HPP
+
+#include <deque>
+#include <mutex>
+
+#include "ros_babel_fish_topic_display.hpp"
+#ifndef Q_MOC_RUN
+  #include <QImage>
+  #include <rviz_common/properties/bool_property.hpp>
+  #include <rviz_common/properties/color_property.hpp>
+  #include <rviz_common/properties/enum_property.hpp>
+  #include <rviz_common/properties/float_property.hpp>
+  #include <rviz_common/properties/int_property.hpp>
+  #include <rviz_common/properties/string_property.hpp>
+  #include "font_cache.hpp"
+  #include "font_catalog.hpp"
+  #include "overlay_frame_scheduler.hpp"
+  #include "overlay_texture_budget.hpp"
+  #include "property_batch.hpp"
+  #include "overlay_utils.hpp"
+#endif
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Scrolling console showing the last lines of a std_msgs/String or rcl_interfaces/Log topic.
+   *
+   * Every line is rasterized once into its own image when it arrives. New lines scroll a CPU copy of
+   * the texture and only the new lines are composited before the copy is uploaded. Lines are only
+   * rasterized again if the width, font or colors change. */
+  class LogConsoleDisplay
+    : public RosBabelFishTopicDisplay
+  {
+    Q_OBJECT
+  public:
+    LogConsoleDisplay();
+    ~LogConsoleDisplay() override;
+    void load(const rviz_common::Config & config) override;
+    // methods for OverlayPickerTool
+    virtual bool isInRegion(int x, int y);
+    virtual void movePosition(int x, int y);
+    virtual void setPosition(int x, int y);
+    virtual int getX() const { return left_; };
+    virtual int getY() const { return top_; };
+
+  protected:
+    struct Line
+    {
+      QString text;
+      uint8_t level;
+      // rasterized text, null until the line is drawn the first time
+      QImage image;
+    };
+
+    void onInitialize() override;
+    void onEnable() override;
+    void onDisable() override;
+    void reset() override;
+    void update(float wall_dt, float ros_dt) override;
+    /** @brief Raster and upload work, run by the OverlayFrameScheduler. */
+    virtual void drawOverlay();
+    void updateTopic() override;
+    void processMessage(ros_babel_fish::CompoundMessage::ConstSharedPtr msg) override;
+
+    /** @brief Appends the text, split into lines, to the pending lines. */
+    void appendLines(const QString & text, uint8_t level);
+    /** @brief Rasterizes the text of the line into its image. */
+    void rasterizeLine(Line & line);
+    QColor levelColor(uint8_t level) const;
+    const Line & lineAt(size_t index) const;
+    /** @brief Composites all lines into the console image. */
+    void composeAll();
+    /** @brief Scrolls the console image by the lines pushed out and composites the newest count lines.
+     *
+     * @param previous_size number of lines shown before the new lines were added. */
+    void scrollAndCompose(size_t previous_size, size_t count);
+    /** @brief Copies the rows [first_row, end_row) of the console image into the texture. */
+    void uploadConsole(int first_row, int end_row);
+    /** @brief Frees the console and line images, they are rasterized again with the next draw. */
+    void releaseCaches();
+
+    std::unique_ptr<rviz_common::properties::StringProperty> topic_message_type_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> line_count_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> width_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> left_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> top_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> text_size_property_;
+    std::unique_ptr<rviz_common::properties::EnumProperty> font_property_;
+    std::unique_ptr<rviz_common::properties::EnumProperty> min_level_property_;
+    std::unique_ptr<rviz_common::properties::BoolProperty> show_name_property_;
+    std::unique_ptr<rviz_common::properties::ColorProperty> fg_color_property_;
+    std::unique_ptr<rviz_common::properties::ColorProperty> bg_color_property_;
+    std::unique_ptr<rviz_common::properties::FloatProperty> bg_alpha_property_;
+
+    std::unique_ptr<rviz_common::properties::IntProperty> draw_priority_property_;
+
+    rviz_2d_overlay_plugins::OverlayObject::SharedPtr overlay_;
+    ScheduledDraw::SharedPtr scheduled_draw_;
+
+    // ring buffer of the shown lines, the oldest line is at ring_begin_
+    std::vector<Line> ring_;
+    size_t ring_begin_;
+    size_t ring_size_;
+    // lines received since the last update, bounded by the number of shown lines
+    std::deque<Line> pending_lines_;
+    // CPU copy of the texture content
+    QImage console_;
+
+    std::shared_ptr<const ResolvedFont> font_;
+    QColor fg_color_;
+    QColor bg_color_;
+    size_t line_count_;
+    int width_;
+    int line_height_;
+    int left_;
+    int top_;
+    uint8_t min_level_;
+    bool show_name_;
+    // width, font or colors changed, every line has to be rasterized again
+    bool relayout_required_;
+    // background changed, the lines have to be composited again
+    bool redraw_required_;
+    uint64_t reported_deadline_misses_;
+    ReportedTextureUsage reported_texture_usage_;
+    PropertyBatch property_batch_;
+
+    std::mutex mutex_;
+
+  protected Q_SLOTS:
+    void updateDrawPriority();
+    void updateTopicMessageType();
+    void updateLineCount();
+    void updateWidth();
+    void updateLeft();
+    void updateTop();
+    void updateFont();
+    void fillFontOptions();
+    void updateMinLevel();
+    void updateShowName();
+    void updateFGColor();
+    void updateBGColor();
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_LOG_CONSOLE_DISPLAY_HPP
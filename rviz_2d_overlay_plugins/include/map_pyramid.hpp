@@ -0,0 +1,124 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_MAP_PYRAMID_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_MAP_PYRAMID_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <OgrePixelFormat.h>
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Colors of the occupancy values as BGRA pixels, indexed by the value read as uint8_t, -1 is 255. */
+  using OccupancyPalette = std::array<uint32_t, 256>;
+
+  enum class OccupancyColorScheme : uint8_t
+  {
+    // free cells white, occupied cells black
+    MAP,
+    // free cells transparent, costs from blue to red, inscribed cyan and lethal purple
+    COSTMAP,
+  };
+
+  OccupancyPalette occupancyPalette(OccupancyColorScheme scheme, double alpha);
+
+  /** @brief Pixel rectangle [x0, x1) x [y0, y1). */
+  struct MapRect
+  {
+    uint32_t x0 = 0;
+    uint32_t y0 = 0;
+    uint32_t x1 = 0;
+    uint32_t y1 = 0;
+
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+    void unite(const MapRect & other);
+  };
+
+  /** @brief Occupancy grid with a pyramid of colored levels, each half the size of the previous one.
+   *
+   * Level 0 holds the occupancy values and is colored through the palette while it is copied into a texture,
+   * the levels above hold BGRA pixels averaging 2 x 2 pixels of the level below. Showing the map at another
+   * size only selects another level. Patches update the values and the pixels above them in every level.
+   * Rows are stored top down, the first row of the grid is the bottom row of the image. */
+  class MapPyramid
+  {
+  public:
+    /** @brief Replaces the grid and builds all levels, data holds width * height values in grid order. */
+    void setGrid(const int8_t * data, uint32_t width, uint32_t height);
+    /** @brief Replaces the values of a width x height block at x, y in grid coordinates.
+     *
+     * @param dirty united with the changed rectangle in level 0 image coordinates
+     * @return false if the block does not fit into the grid, nothing is changed then */
+    bool applyPatch(const int8_t * data, uint32_t x, uint32_t y, uint32_t width, uint32_t height, MapRect & dirty);
+    /** @brief Colors the grid with another palette, all levels are built again. */
+    void setPalette(const OccupancyPalette & palette);
+    void clear();
+    bool empty() const;
+
+    size_t levelCount() const;
+    uint32_t width(size_t level) const;
+    uint32_t height(size_t level) const;
+    /** @brief The smallest level at least as large as the panel, level 0 if the grid is smaller. */
+    size_t levelFor(uint32_t panel_width, uint32_t panel_height) const;
+    /** @brief Converts a rectangle of level 0 into the rectangle of the level covering it. */
+    static MapRect levelRect(const MapRect & rect, size_t level);
+    /** @brief Copies the rectangle of the level into the box, a PF_BYTE_BGRA region of the same size. */
+    void copyToPixelBox(size_t level, const MapRect & rect, const Ogre::PixelBox & box) const;
+
+  private:
+    struct Level
+    {
+      uint32_t width = 0;
+      uint32_t height = 0;
+      std::vector<uint32_t> pixels;
+    };
+
+    /** @brief Builds the pixels of all levels above the rectangle of level 0. */
+    void rebuild(const MapRect & rect);
+
+    OccupancyPalette palette_ = occupancyPalette(OccupancyColorScheme::MAP, 1.0);
+    uint32_t width_ = 0;
+    uint32_t height_ = 0;
+    std::vector<uint8_t> values_;
+    // levels 1 and above
+    std::vector<Level> levels_;
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_MAP_PYRAMID_HPP
@@ -0,0 +1,111 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_MESSAGE_FIELD_ACCESS_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_MESSAGE_FIELD_ACCESS_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <ros_babel_fish/babel_fish.hpp>
+#include <rosidl_typesupport_introspection_cpp/message_introspection.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Splits a field path like "twist.linear.x" at the dots. */
+  std::vector<std::string> splitFieldPath(const std::string & field_path);
+
+  /** @brief Reads the field at a path like "twist.linear.x" from messages of one type.
+   *
+   * The field names are looked up once per message type in the introspection of the type. Messages are then read
+   * at the offset of the field inside the C++ message, without looking up fields by name. */
+  class FieldAccessor
+  {
+  public:
+    enum class Kind
+    {
+      Number,
+      Bool,
+      String,
+      Time,
+      Duration,
+      // numeric or boolean elements
+      Array
+    };
+
+    explicit FieldAccessor(const std::string & field_path = std::string());
+
+    /** @brief Resolves the path for messages of the given type, e.g. "geometry_msgs/msg/Twist".
+     *
+     * Does nothing if the path is resolved for this type already.
+     * @throws ros_babel_fish::BabelFishException if a field does not exist or cannot be read. */
+    void resolve(const std::string & message_type);
+
+    const std::string & path() const;
+    /** @brief The type the path is resolved for, empty if it is not resolved. */
+    const std::string & messageType() const;
+    Kind kind() const;
+
+    /** @brief The string of a string field, without a copy.
+     *
+     * @throws ros_babel_fish::BabelFishException if the field is not a string. */
+    const std::string & stringValue(const ros_babel_fish::CompoundMessage & msg) const;
+    /** @brief The value of a numeric, boolean, time or duration field.
+     *
+     * @throws ros_babel_fish::BabelFishException if the field is not convertible. */
+    double value(const ros_babel_fish::CompoundMessage & msg) const;
+    /** @brief Appends the value of a scalar field, or every element of a numeric array field.
+     *
+     * @throws ros_babel_fish::BabelFishException if the field is not convertible. */
+    void appendValues(const ros_babel_fish::CompoundMessage & msg, std::vector<double> & values) const;
+
+  private:
+    const void * field(const ros_babel_fish::CompoundMessage & msg) const;
+
+    std::string path_;
+    std::vector<std::string> field_names_;
+    std::string message_type_;
+    // keeps the library of the introspection loaded
+    std::shared_ptr<const ros_babel_fish::MessageTypeSupport> type_support_;
+    const rosidl_typesupport_introspection_cpp::MessageMember * member_ = nullptr;
+    size_t offset_ = 0;
+    Kind kind_ = Kind::Number;
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_MESSAGE_FIELD_ACCESS_HPP
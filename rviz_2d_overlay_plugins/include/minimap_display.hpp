@@ -0,0 +1,159 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_MINIMAP_DISPLAY_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_MINIMAP_DISPLAY_HPP
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <map_msgs/msg/occupancy_grid_update.hpp>
+#include <nav_msgs/msg/occupancy_grid.hpp>
+#ifndef Q_MOC_RUN
+  #include <OgreQuaternion.h>
+  #include <OgreVector3.h>
+  #include <rviz_common/ros_topic_display.hpp>
+  #include <rviz_common/properties/bool_property.hpp>
+  #include <rviz_common/properties/color_property.hpp>
+  #include <rviz_common/properties/enum_property.hpp>
+  #include <rviz_common/properties/float_property.hpp>
+  #include <rviz_common/properties/int_property.hpp>
+  #include <rviz_common/properties/tf_frame_property.hpp>
+  #include "map_pyramid.hpp"
+  #include "overlay_frame_scheduler.hpp"
+  #include "overlay_texture_budget.hpp"
+  #include "property_batch.hpp"
+  #include "overlay_utils.hpp"
+#endif
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Minimap of a nav_msgs/OccupancyGrid with a marker at the pose of the robot.
+   *
+   * The map is kept in a MapPyramid, the texture is the smallest level covering the panel, so resizing the
+   * panel never resamples the whole map. map_msgs/OccupancyGridUpdate patches of the `<topic>_updates` topic
+   * only upload the texture region they cover. The robot marker is a small overlay of its own on top of the
+   * map, following the robot only moves the marker panel and it is only repainted when the heading changes. */
+  class MinimapDisplay
+    : public rviz_common::RosTopicDisplay<nav_msgs::msg::OccupancyGrid>
+  {
+    Q_OBJECT
+  public:
+    MinimapDisplay();
+    ~MinimapDisplay() override;
+    void load(const rviz_common::Config & config) override;
+    // methods for OverlayPickerTool
+    virtual bool isInRegion(int x, int y);
+    virtual void movePosition(int x, int y);
+    virtual void setPosition(int x, int y);
+    virtual int getX() const { return left_; };
+    virtual int getY() const { return top_; };
+
+  protected:
+    void onInitialize() override;
+    void onEnable() override;
+    void onDisable() override;
+    void reset() override;
+    void subscribe() override;
+    void unsubscribe() override;
+    void update(float wall_dt, float ros_dt) override;
+    /** @brief Upload work, run by the OverlayFrameScheduler. */
+    virtual void drawOverlay();
+    void updateTopic() override;
+    void processMessage(nav_msgs::msg::OccupancyGrid::ConstSharedPtr msg) override;
+    void processUpdate(map_msgs::msg::OccupancyGridUpdate::ConstSharedPtr update);
+
+    /** @brief Moves the marker to the pose of the robot frame, false if the pose is unknown. */
+    bool updateMarkerPose();
+    void drawMarker();
+    void applyPosition();
+    /** @brief Size of the map on screen, keeping the aspect ratio of the map. */
+    void panelSize(int & width, int & height) const;
+
+    std::unique_ptr<rviz_common::properties::EnumProperty> color_scheme_property_;
+    std::unique_ptr<rviz_common::properties::FloatProperty> alpha_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> width_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> left_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> top_property_;
+    std::unique_ptr<rviz_common::properties::BoolProperty> show_robot_property_;
+    std::unique_ptr<rviz_common::properties::TfFrameProperty> robot_frame_property_;
+    std::unique_ptr<rviz_common::properties::ColorProperty> robot_color_property_;
+
+    std::unique_ptr<rviz_common::properties::IntProperty> draw_priority_property_;
+
+    rviz_2d_overlay_plugins::OverlayObject::SharedPtr overlay_;
+    rviz_2d_overlay_plugins::OverlayObject::SharedPtr marker_;
+    ScheduledDraw::SharedPtr scheduled_draw_;
+    rclcpp::Subscription<map_msgs::msg::OccupancyGridUpdate>::SharedPtr update_subscription_;
+
+    MapPyramid pyramid_;
+    std::string map_frame_;
+    double resolution_;
+    Ogre::Vector3 origin_position_;
+    Ogre::Quaternion origin_orientation_;
+    // the whole texture has to be uploaded, e.g. for a new map or panel size
+    bool upload_required_;
+    // changed region of level 0 since the last upload
+    MapRect dirty_;
+    // level of the pyramid in the texture
+    size_t level_;
+
+    int width_;
+    int left_;
+    int top_;
+    bool show_robot_;
+    QColor robot_color_;
+    // heading of the painted marker in whole degrees on screen, clockwise
+    int marker_heading_;
+    bool marker_required_;
+    uint64_t reported_deadline_misses_;
+    ReportedTextureUsage reported_texture_usage_;
+    PropertyBatch property_batch_;
+
+    std::mutex mutex_;
+
+  protected Q_SLOTS:
+    void updateDrawPriority();
+    void updatePalette();
+    void updateWidth();
+    void updateLeft();
+    void updateTop();
+    void updateShowRobot();
+    void updateRobotColor();
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_MINIMAP_DISPLAY_HPP
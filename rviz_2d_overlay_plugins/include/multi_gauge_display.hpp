@@ -0,0 +1,189 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_MULTI_GAUGE_DISPLAY_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_MULTI_GAUGE_DISPLAY_HPP
+
+#include <map>
+#include <mutex>
+
+#include "message_field_access.hpp"
+#include "ros_babel_fish_topic_display.hpp"
+#ifndef Q_MOC_RUN
+  #include <QImage>
+  #include <rviz_common/properties/bool_property.hpp>
+  #include <rviz_common/properties/color_property.hpp>
+  #include <rviz_common/properties/float_property.hpp>
+  #include <rviz_common/properties/int_property.hpp>
+  #include <rviz_common/properties/string_property.hpp>
+  #include "gauge_utils.hpp"
+  #include "overlay_frame_scheduler.hpp"
+  #include "overlay_texture_budget.hpp"
+  #include "property_batch.hpp"
+  #include "overlay_utils.hpp"
+#endif
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Grid of circular gauges, all driven by a single message.
+   *
+   * Every configured field is either a scalar, resulting in one gauge, or a numeric array,
+   * resulting in one gauge per element. All gauges share one overlay texture. The static
+   * rings are rendered once per color and only cells whose quantized value changed are
+   * repainted and uploaded. */
+  class MultiGaugeDisplay
+    : public RosBabelFishTopicDisplay
+  {
+    Q_OBJECT
+  public:
+    MultiGaugeDisplay();
+    ~MultiGaugeDisplay() override;
+    void load(const rviz_common::Config & config) override;
+    // methods for OverlayPickerTool
+    virtual bool isInRegion(int x, int y);
+    virtual void movePosition(int x, int y);
+    virtual void setPosition(int x, int y);
+    virtual int getX() const { return left_; };
+    virtual int getY() const { return top_; };
+
+  protected:
+    void onInitialize() override;
+    /** @brief Everything onInitialize() does besides setting the topic message type, which needs the display
+     * context. Benchmarks run the display without one. */
+    void initializeOverlay();
+    void onEnable() override;
+    void onDisable() override;
+    void update(float wall_dt, float ros_dt) override;
+    /** @brief Raster and upload work, run by the OverlayFrameScheduler. */
+    virtual void drawOverlay();
+    void updateTopic() override;
+    void processMessage(ros_babel_fish::CompoundMessage::ConstSharedPtr msg) override;
+
+    /** @brief Resizes the texture to fit all gauges and repaints every cell. */
+    virtual void drawAll();
+    /** @brief Repaints the given cell, only the cell region of the texture is locked. */
+    virtual void drawCell(size_t index);
+    /** @brief Background and rings of a single cell for the given value color. */
+    const QImage & ringLayer(const QColor & value_color);
+    int64_t quantize(double value) const;
+    QRect cellRect(size_t index) const;
+    void markStyleChanged();
+
+    std::unique_ptr<rviz_common::properties::StringProperty> topic_message_type_property_;
+    std::unique_ptr<rviz_common::properties::StringProperty> topic_fields_property_;
+    std::unique_ptr<rviz_common::properties::StringProperty> captions_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> columns_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> size_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> left_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> top_property_;
+    std::unique_ptr<rviz_common::properties::FloatProperty> value_resolution_property_;
+    std::unique_ptr<rviz_common::properties::ColorProperty> fg_color_property_;
+    std::unique_ptr<rviz_common::properties::FloatProperty> fg_alpha_property_;
+    std::unique_ptr<rviz_common::properties::FloatProperty> fg_alpha2_property_;
+    std::unique_ptr<rviz_common::properties::ColorProperty> bg_color_property_;
+    std::unique_ptr<rviz_common::properties::FloatProperty> bg_alpha_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> text_size_property_;
+    std::unique_ptr<rviz_common::properties::BoolProperty> show_caption_property_;
+    std::unique_ptr<rviz_common::properties::FloatProperty> max_value_property_;
+    std::unique_ptr<rviz_common::properties::FloatProperty> min_value_property_;
+    std::unique_ptr<rviz_common::properties::BoolProperty> auto_color_change_property_;
+    std::unique_ptr<rviz_common::properties::ColorProperty> max_color_property_;
+    std::unique_ptr<rviz_common::properties::ColorProperty> med_color_property_;
+    std::unique_ptr<rviz_common::properties::FloatProperty> max_color_threshold_property_;
+    std::unique_ptr<rviz_common::properties::FloatProperty> med_color_threshold_property_;
+    std::unique_ptr<rviz_common::properties::BoolProperty> clockwise_rotate_property_;
+
+    std::unique_ptr<rviz_common::properties::IntProperty> draw_priority_property_;
+
+    rviz_2d_overlay_plugins::OverlayObject::SharedPtr overlay_;
+    ScheduledDraw::SharedPtr scheduled_draw_;
+    GaugeStyle style_;
+
+    std::vector<FieldAccessor> topic_fields_;
+    QStringList captions_;
+    QStringList default_captions_;
+    // latest values, written by processMessage
+    std::vector<double> values_;
+    // scratch buffer reused for every message
+    std::vector<double> incoming_values_;
+    // quantized values currently painted into the texture
+    std::vector<int64_t> drawn_values_;
+    // static ring layers, keyed by the value color
+    std::map<QRgb, QImage> ring_layers_;
+
+    int columns_;
+    int cell_size_;
+    int caption_offset_;
+    int left_;
+    int top_;
+    double value_resolution_;
+    bool show_caption_;
+    bool layout_required_;
+    bool values_changed_;
+    uint64_t reported_deadline_misses_;
+    ReportedTextureUsage reported_texture_usage_;
+    PropertyBatch property_batch_;
+
+    std::mutex mutex_;
+
+  protected Q_SLOTS:
+    void updateDrawPriority();
+    void updateTopicMessageType();
+    void updateTopicFields();
+    void updateCaptions();
+    void updateColumns();
+    void updateSize();
+    void updateLeft();
+    void updateTop();
+    void updateValueResolution();
+    void updateFGColor();
+    void updateFGAlpha();
+    void updateFGAlpha2();
+    void updateBGColor();
+    void updateBGAlpha();
+    void updateTextSize();
+    void updateShowCaption();
+    void updateMinValue();
+    void updateMaxValue();
+    void updateAutoColorChange();
+    void updateMaxColor();
+    void updateMedColor();
+    void updateMaxColorThreshold();
+    void updateMedColorThreshold();
+    void updateClockwiseRotate();
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_MULTI_GAUGE_DISPLAY_HPP
@@ -0,0 +1,128 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_FRAME_SCHEDULER_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_FRAME_SCHEDULER_HPP
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include <OgreFrameListener.h>
+#include <rviz_common/display.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Raster and upload work of an overlay display, executed by the OverlayFrameScheduler.
+   *
+   * The display requests a draw whenever its overlay is outdated, the scheduler calls the draw
+   * function at the start of one of the next frames. */
+  class ScheduledDraw
+  {
+  public:
+    using SharedPtr = std::shared_ptr<ScheduledDraw>;
+
+    /** @brief Creates the task and registers it with the scheduler.
+     *
+     * @param draw called from the render thread, must not throw. */
+    static SharedPtr create(std::function<void()> draw, int priority = 0);
+
+    /** @brief Marks the overlay outdated, can be called from any thread. */
+    void requestDraw();
+    bool drawPending() const;
+    /** @brief Higher priorities are drawn first if the frame budget does not suffice for all overlays. */
+    void setPriority(int priority);
+    int priority() const;
+    /** @brief Number of times a requested draw was deferred past the scheduler deadline. */
+    uint64_t deadlineMisses() const;
+
+  private:
+    explicit ScheduledDraw(std::function<void()> draw, int priority);
+
+    friend class OverlayFrameScheduler;
+
+    std::function<void()> draw_;
+    std::atomic<int> priority_;
+    std::atomic<bool> pending_;
+    // steady clock time of the first request since the last draw
+    std::atomic<int64_t> pending_since_ns_;
+    std::atomic<uint64_t> deadline_misses_;
+    // the current request was already counted as a miss
+    bool missed_;
+  };
+
+  /** @brief Executes the draws of all overlay displays within a per-frame time budget.
+   *
+   * At the start of every frame the pending draws are run ordered by overdue requests first,
+   * then priority and then the time since the request. Once the budget is spent, the remaining
+   * draws are deferred to the next frame; at least one draw runs per frame. The budget is read
+   * from the environment variable RVIZ_2D_OVERLAY_FRAME_BUDGET_MS, 8 ms by default. */
+  class OverlayFrameScheduler : public Ogre::FrameListener
+  {
+  public:
+    static OverlayFrameScheduler & instance();
+
+    void setBudget(std::chrono::microseconds budget);
+    std::chrono::microseconds budget() const;
+    /** @brief Requests pending for longer than the deadline count as deadline miss and are drawn first. */
+    void setDeadline(std::chrono::microseconds deadline);
+    std::chrono::microseconds deadline() const;
+    /** @brief Total number of deadline misses of all overlays. */
+    uint64_t deadlineMisses() const;
+
+    bool frameStarted(const Ogre::FrameEvent & event) override;
+
+  private:
+    OverlayFrameScheduler();
+
+    friend class ScheduledDraw;
+    void add(const ScheduledDraw::SharedPtr & draw);
+
+    std::vector<std::weak_ptr<ScheduledDraw>> draws_;
+    // scratch buffer of the pending draws, reused every frame
+    std::vector<ScheduledDraw::SharedPtr> pending_;
+    std::chrono::microseconds budget_;
+    std::chrono::microseconds deadline_;
+    uint64_t deadline_misses_;
+    bool listening_;
+  };
+
+  /** @brief Shows the deadline misses of the draw as warning in the status of the display. */
+  void reportDeadlineMisses(rviz_common::Display & display, const ScheduledDraw & draw, uint64_t & reported_misses);
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_FRAME_SCHEDULER_HPP
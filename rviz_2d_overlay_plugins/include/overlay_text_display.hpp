@@ -37,6 +37,7 @@
 #define RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_TEXT_DISPLAY_HPP
 
 #include "rviz_2d_overlay_msgs/msg/overlay_text.hpp"
+#include "rviz_2d_overlay_msgs/msg/overlay_text_patch.hpp"
 #ifndef Q_MOC_RUN
     #include <OgreColourValue.h>
     #include <OgreMaterial.h>
@@ -49,6 +50,12 @@
     #include <rviz_common/ros_topic_display.hpp>
     #include <std_msgs/msg/color_rgba.h>
 
+    #include "font_cache.hpp"
+    #include "font_catalog.hpp"
+    #include "overlay_frame_scheduler.hpp"
+    #include "overlay_text_layout.hpp"
+    #include "overlay_texture_budget.hpp"
+    #include "property_batch.hpp"
     #include "overlay_utils.hpp"
 #endif
 
@@ -58,9 +65,14 @@ namespace rviz_2d_overlay_plugins {
       public:
         OverlayTextDisplay();
         virtual ~OverlayTextDisplay();
+        virtual void load(const rviz_common::Config &config) override;
 
       protected:
         rviz_2d_overlay_plugins::OverlayObject::SharedPtr overlay_;
+        ScheduledDraw::SharedPtr scheduled_draw_;
+        uint64_t reported_deadline_misses_;
+        ReportedTextureUsage reported_texture_usage_;
+        PropertyBatch property_batch_;
 
         int texture_width_;
         int texture_height_;
@@ -75,18 +87,56 @@ namespace rviz_2d_overlay_plugins {
         int text_size_;
         int line_width_;
         std::string text_;
-        QStringList font_families_;
         std::string font_;
         int horizontal_dist_;
         int vertical_dist_;
         HorizontalAlignment horizontal_alignment_;
         VerticalAlignment vertical_alignment_;
+        // id of the last OverlayText, patches for other ids are ignored
+        uint32_t text_id_;
+        bool text_received_;
+        rclcpp::Subscription<rviz_2d_overlay_msgs::msg::OverlayTextPatch>::SharedPtr patch_subscription_;
+
+        // layout of the text and its shadow, kept until the text, font, text size or width changes
+        OverlayTextLayout text_layout_;
+        bool require_layout_;
+        // the ticker scrolls a single line of text through the panel by moving the texture coordinates
+        bool ticker_;
+        double ticker_speed_;
+        double ticker_offset_;
+        // width of the texture holding the line and a gap, 0 while the line fits into the panel
+        int ticker_width_;
 
         virtual void onInitialize() override;
+        // everything onInitialize() does besides subscribing, benchmarks run the display without a display context
+        void initializeOverlay();
         virtual void onEnable() override;
         virtual void onDisable() override;
         virtual void update(float wall_dt, float ros_dt) override;
         virtual void reset() override;
+        // renders the text into the texture, run by the OverlayFrameScheduler
+        virtual void drawOverlay();
+        virtual void updateTopic() override;
+        virtual void subscribe() override;
+        virtual void unsubscribe() override;
+        // applies the current distances and alignments to the overlay panel
+        void updateOverlayPosition();
+        // shows the part of the ticker texture at the current offset, or the whole texture without a ticker
+        void updateTickerCoordinates();
+        // the font and its metrics from the FontCache
+        std::shared_ptr<const ResolvedFont> textFont() const;
+        // the setters only mark what the change requires: the position, a repaint or a new layout
+        void createOverlay();
+        void setAction(uint8_t action);
+        void setText(const std::string &text);
+        void setTextureSize(int width, int height);
+        void setTextSize(int text_size);
+        void setFont(const std::string &font);
+        void setLineWidth(int line_width);
+        void setFGColor(const QColor &color);
+        void setBGColor(const QColor &color);
+        void setPlacement(int horizontal_dist, int vertical_dist, HorizontalAlignment horizontal_alignment,
+                          VerticalAlignment vertical_alignment);
 
         bool require_update_texture_;
         // properties are raw pointers since they are owned by Qt
@@ -108,6 +158,9 @@ namespace rviz_2d_overlay_plugins {
         rviz_common::properties::ColorProperty *fg_color_property_;
         rviz_common::properties::FloatProperty *fg_alpha_property_;
         rviz_common::properties::EnumProperty *font_property_;
+        rviz_common::properties::BoolProperty *ticker_property_;
+        rviz_common::properties::FloatProperty *ticker_speed_property_;
+        rviz_common::properties::IntProperty *draw_priority_property_;
 
       protected Q_SLOTS:
         void updateOvertakePositionProperties();
@@ -127,10 +180,15 @@ namespace rviz_2d_overlay_plugins {
         void updateBGColor();
         void updateBGAlpha();
         void updateFont();
+        void fillFontOptions();
         void updateLineWidth();
+        void updateTicker();
+        void updateTickerSpeed();
+        void updateDrawPriority();
 
       private:
         void processMessage(rviz_2d_overlay_msgs::msg::OverlayText::ConstSharedPtr msg) override;
+        void processPatch(rviz_2d_overlay_msgs::msg::OverlayTextPatch::ConstSharedPtr patch);
     };
 } // namespace rviz_2d_overlay_plugins
 
@@ -0,0 +1,86 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_TEXT_LAYOUT_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_TEXT_LAYOUT_HPP
+
+#include <string>
+
+#include <QColor>
+#include <QPainter>
+#include <QStaticText>
+#include <QTransform>
+
+#include "font_cache.hpp"
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Cached layout of the text of an OverlayText and its shadow.
+   *
+   * Text with markup is laid out as rich text twice, the shadow without the color styles of the text.
+   * Plain text, e.g. a short number, skips the HTML parsing: it is laid out once as plain text and the same
+   * layout is drawn for the shadow and the text. Text without its own color is painted in the pen color,
+   * so colors can change without a new layout. */
+  class OverlayTextLayout
+  {
+  public:
+    /** @brief True if the text contains neither tags nor entities. */
+    static bool isPlainText(const std::string & text);
+
+    /** @brief Lays out the text for the font and the transform of the painter drawing it.
+     *
+     * The text is wrapped at width, a negative width only breaks it at newlines. The metrics of the font,
+     * resolved once by the FontCache, give the height of wrapped rich text. */
+    void layout(const std::string & text, int width, int height, const ResolvedFont & font,
+                const QTransform & transform);
+    /** @brief Draws the shadow one pixel down right and the text above it, starting at top. */
+    void draw(QPainter & painter, int top, const QColor & text_color, const QColor & shadow_color,
+              int line_width) const;
+    /** @brief Size of the laid out text. */
+    int width() const;
+    int height() const;
+    bool isPlain() const;
+
+  private:
+    QStaticText text_;
+    // only used for rich text
+    QStaticText shadow_;
+    int width_ = 0;
+    int height_ = 0;
+    bool plain_ = false;
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_TEXT_LAYOUT_HPP
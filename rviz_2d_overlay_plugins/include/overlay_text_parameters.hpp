@@ -0,0 +1,69 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_TEXT_PARAMETERS_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_TEXT_PARAMETERS_HPP
+
+#include <string>
+
+#include <rclcpp/rclcpp.hpp>
+#include <rviz_2d_overlay_msgs/msg/overlay_text.hpp>
+#include <std_msgs/msg/color_rgba.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Sets the color from a single letter code: r, g, b, k, w, p, anything else is yellow.
+   *
+   * Alpha is set to 1. */
+  void setColorFromCode(const std::string & code, std_msgs::msg::ColorRGBA & color);
+
+  /** @brief Converts "left", "center", "right", "top" or "bottom" to the OverlayText alignment constant. */
+  uint8_t alignmentFromString(const std::string & alignment);
+
+  /** @brief Applies a formatting parameter of OverlayText nodes to the message.
+   *
+   * @param key parameter name without prefix, e.g. "fg_color" or "width".
+   * @return false if key is not a formatting parameter. */
+  bool applyOverlayTextParameter(
+    rviz_2d_overlay_msgs::msg::OverlayText & msg, const std::string & key,
+    const rclcpp::Parameter & param);
+
+  /** @brief Declares the formatting parameters, each prefixed by prefix, and applies their values to the message. */
+  void declareOverlayTextParameters(
+    rclcpp::Node & node, const std::string & prefix,
+    rviz_2d_overlay_msgs::msg::OverlayText & msg);
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_TEXT_PARAMETERS_HPP
@@ -0,0 +1,113 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_TEXTURE_BUDGET_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_TEXTURE_BUDGET_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <rviz_common/display.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+  class OverlayObject;
+
+  /** @brief Accounts the texture memory of all overlay objects and keeps it within a budget.
+   *
+   * If the textures exceed the budget, first the textures of hidden overlays are released, then
+   * downscalable overlays are reduced to a lower resolution, lowest priority and largest texture first.
+   * Downscaled overlays get their full resolution back once it fits into the budget again.
+   * Independent of the budget, overlays that are hidden or off screen for longer than the hidden release delay
+   * lose their texture.
+   * The budget is read from the environment variable RVIZ_2D_OVERLAY_TEXTURE_BUDGET_MB, 256 MB by default,
+   * 0 disables the budget. */
+  class OverlayTextureBudget
+  {
+  public:
+    static OverlayTextureBudget & instance();
+
+    void setBudget(size_t bytes);
+    size_t budget() const;
+    /** @brief Texture memory of all overlays in bytes. */
+    size_t usage() const;
+    /** @brief Textures of overlays not on screen for this long are released, 30 s by default. */
+    void setHiddenReleaseDelay(std::chrono::milliseconds delay);
+    std::chrono::milliseconds hiddenReleaseDelay() const;
+    /** @brief Number of textures released because the budget was exceeded or the overlay was hidden. */
+    uint64_t releases() const;
+
+    /** @brief Releases textures of long hidden overlays and downscales textures until the usage fits the budget.
+     *
+     * Run by the OverlayFrameScheduler at the start of every frame. Owners of affected overlays are
+     * notified through the texture lost callback of the overlay. */
+    void enforce();
+
+  private:
+    OverlayTextureBudget();
+
+    friend class OverlayObject;
+    void add(OverlayObject * overlay);
+    void remove(OverlayObject * overlay);
+    void releaseHiddenTextures();
+
+    // texture memory of the overlay once it is painted with its current texture scale
+    static size_t plannedBytes(const OverlayObject & overlay, double scale);
+    static void notifyTextureLost(OverlayObject & overlay);
+
+    std::vector<OverlayObject *> overlays_;
+    // scratch buffer of the overlays that can be downscaled, reused every frame
+    std::vector<OverlayObject *> candidates_;
+    size_t budget_;
+    std::chrono::milliseconds hidden_release_delay_;
+    uint64_t releases_;
+  };
+
+  /** @brief Last texture memory shown in the status of a display. */
+  struct ReportedTextureUsage
+  {
+    size_t overlay_bytes = 0;
+    size_t total_bytes = 0;
+    double scale = 1.0;
+  };
+
+  /** @brief Shows the texture memory of the overlay and of all overlays in the status of the display. */
+  void reportTextureUsage(rviz_common::Display & display, const OverlayObject & overlay, ReportedTextureUsage & reported);
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_OVERLAY_TEXTURE_BUDGET_HPP
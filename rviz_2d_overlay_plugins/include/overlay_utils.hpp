@@ -49,6 +49,8 @@
 #include <Overlay/OgrePanelOverlayElement.h>
 #include <QColor>
 #include <QImage>
+#include <chrono>
+#include <functional>
 #include <memory>
 #include <string>
 
@@ -60,12 +62,22 @@ namespace rviz_2d_overlay_plugins {
     class ScopedPixelBuffer {
       public:
         ScopedPixelBuffer(Ogre::HardwarePixelBufferSharedPtr pixel_buffer);
+        /**
+         * Locks only the given region of the pixel buffer, e.g. a single cell of a texture atlas.
+         * Use getRegionQImage() to paint into the locked region.
+         */
+        ScopedPixelBuffer(Ogre::HardwarePixelBufferSharedPtr pixel_buffer, const Ogre::Box &region);
         virtual ~ScopedPixelBuffer();
         virtual Ogre::HardwarePixelBufferSharedPtr getPixelBuffer();
         virtual QImage getQImage(unsigned int width, unsigned int height);
         virtual QImage getQImage(OverlayObject &overlay);
         virtual QImage getQImage(unsigned int width, unsigned int height, QColor &bg_color);
         virtual QImage getQImage(OverlayObject &overlay, QColor &bg_color);
+        /**
+         * Returns a QImage covering the locked region, respecting the row pitch of the texture.
+         * The content of the region is undefined and has to be overwritten completely.
+         */
+        virtual QImage getRegionQImage();
 
       protected:
         Ogre::HardwarePixelBufferSharedPtr pixel_buffer_;
@@ -88,6 +100,9 @@ namespace rviz_2d_overlay_plugins {
      *
      * This class is supposed to be instantiated in the onInitalize method of the
      * rviz_common::Display class.
+     *
+     * The texture memory of all overlay objects is accounted by the OverlayTextureBudget, which may
+     * release the texture of a hidden overlay or reduce the texture resolution to stay within its budget.
      */
     class OverlayObject {
       public:
@@ -100,22 +115,80 @@ namespace rviz_2d_overlay_plugins {
         virtual void hide();
         virtual void show();
         virtual bool isTextureReady() const;
-        virtual void updateTextureSize(unsigned int width, unsigned int height);
+        /**
+         * Creates the texture if it does not exist or its size or pixel format changed. QImage based painting
+         * requires the default format, displays uploading raw pixels may choose the format of their data.
+         */
+        virtual void updateTextureSize(unsigned int width, unsigned int height,
+                                       Ogre::PixelFormat format = Ogre::PF_A8R8G8B8);
         virtual ScopedPixelBuffer getBuffer();
+        virtual ScopedPixelBuffer getBuffer(const Ogre::Box &region);
         virtual void setPosition(double hor_dist, double ver_dist,
                                  HorizontalAlignment hor_alignment = HorizontalAlignment::LEFT,
                                  VerticalAlignment ver_alignment = VerticalAlignment::TOP);
         virtual void setDimensions(double width, double height);
+        /**
+         * Selects the part of the texture shown on the panel, e.g. a single cell of a texture atlas.
+         * Changing the texture coordinates does not require repainting or uploading the texture.
+         * Coordinates outside of [0, 1] are clamped to the edge unless texture wrapping is enabled.
+         */
+        virtual void setTextureCoordinates(double u1, double v1, double u2, double v2);
+        /** Repeats the texture for coordinates outside of [0, 1], e.g. for a scrolling ticker. Off by default. */
+        virtual void setTextureWrapping(bool wrapping);
         virtual bool isVisible() const;
+        /**
+         * True if the overlay is shown and its panel lies at least partly inside the viewport the overlays were
+         * last rendered to. Displays skip painting and uploading while their overlay is not on screen.
+         */
+        virtual bool isOnScreen() const;
+        /** Size of the texture as requested by updateTextureSize(), independent of the texture scale. */
         virtual unsigned int getTextureWidth() const;
         virtual unsigned int getTextureHeight() const;
+        /** Memory allocated for the texture in bytes. */
+        virtual size_t getTextureBytes() const;
+        /** Destroys the texture, the next updateTextureSize() creates it again. */
+        virtual void releaseTexture();
+
+        /** Overlays with a higher z-order are rendered on top of others, the default is 100. */
+        virtual void setZOrder(unsigned short z_order);
+        /** Overlays with a lower priority are downscaled first if the texture budget is exceeded. */
+        virtual void setPriority(int priority);
+        virtual int getPriority() const;
+        /**
+         * Allows the texture budget to reduce the resolution of the texture. The owner has to paint the whole
+         * texture with every draw and scale its painter by getTextureScale().
+         */
+        virtual void setDownscalable(bool downscalable);
+        virtual bool isDownscalable() const;
+        /** Ratio of the texture resolution to the requested texture size, applied with the next updateTextureSize(). */
+        virtual void setTextureScale(double scale);
+        virtual double getTextureScale() const;
+        /**
+         * Called when the texture budget released or rescaled the texture, the owner has to repaint the overlay
+         * starting with updateTextureSize().
+         */
+        virtual void setTextureLostCallback(std::function<void()> callback);
 
       protected:
+        friend class OverlayTextureBudget;
+
+        void applyTextureWrapping();
+
         const std::string name_;
         Ogre::Overlay *overlay_;
         Ogre::PanelOverlayElement *panel_;
         Ogre::MaterialPtr panel_material_;
         Ogre::TexturePtr texture_;
+        unsigned int requested_width_;
+        unsigned int requested_height_;
+        int priority_;
+        bool downscalable_;
+        double texture_scale_;
+        bool texture_wrapping_;
+        std::function<void()> texture_lost_callback_;
+        // tracked by the texture budget to release the texture of long hidden overlays
+        bool off_screen_;
+        std::chrono::steady_clock::time_point off_screen_since_;
     };
 } // namespace rviz_2d_overlay_plugins
 
@@ -38,7 +38,11 @@
 #include <std_msgs/msg/float32.hpp>
 #ifndef Q_MOC_RUN
 #include <rviz_common/ros_topic_display.hpp>
+#include "overlay_frame_scheduler.hpp"
+#include "overlay_texture_budget.hpp"
+#include "property_batch.hpp"
 #include "overlay_utils.hpp"
+#include "gauge_utils.hpp"
 #include <OgreColourValue.h>
 #include <OgreTexture.h>
 #include <OgreMaterial.h>
@@ -46,6 +50,7 @@
 #include <rviz_common/properties/float_property.hpp>
 #include <rviz_common/properties/color_property.hpp>
 #include <rviz_common/properties/color_property.hpp>
+#include <rviz_common/properties/enum_property.hpp>
 #endif
 
 namespace rviz_2d_overlay_plugins
@@ -57,6 +62,7 @@ namespace rviz_2d_overlay_plugins
   public:
     PieChartDisplay();
     virtual ~PieChartDisplay();
+    virtual void load(const rviz_common::Config & config) override;
     
     // methods for OverlayPickerTool
     virtual bool isInRegion(int x, int y);
@@ -69,9 +75,32 @@ namespace rviz_2d_overlay_plugins
     virtual void onEnable();
     virtual void onDisable();
     virtual void onInitialize();
+    // creates the overlay and applies all properties, called by benchmarks that have no display context
+    void initializeOverlay();
     virtual void processMessage(std_msgs::msg::Float32::ConstSharedPtr msg);
     virtual void drawPlot(double val);
+    // bar shapes only repaint the strip between the drawn and the new value
+    virtual void drawBarDelta(double val);
+    void drawBarLabels(QPainter & painter, const QColor & value_color, double val, const GaugeStyle & style);
+    // paints the gauge at the origin of painter, without background
+    void paintGauge(QPainter & painter, double val);
+    // smooth value changes: the gauge is pre-rendered for evenly spaced values into a texture
+    // atlas, animating only changes the texture coordinates of the overlay panel
+    virtual void updateAnimation(double wall_dt);
+    virtual void drawAnimationAtlas();
+    virtual void drawAnimationAtlasCell(int index, double val);
+    void showAnimationAtlasCell(int index);
+    QRect atlasCell(int index) const;
+    double atlasStepValue(int index) const;
+    GaugeStyle gaugeStyle() const;
+    int textureWidth() const;
+    int textureHeight() const;
+    QRect barRect() const;
+    QRect valueLabelRect() const;
     virtual void update(float wall_dt, float ros_dt);
+    // raster and upload work, run by the OverlayFrameScheduler
+    virtual void drawOverlay();
+    virtual void updateTopic() override;
     // properties
     rviz_common::properties::IntProperty* size_property_;
     rviz_common::properties::IntProperty* left_property_;
@@ -91,6 +120,11 @@ namespace rviz_2d_overlay_plugins
     rviz_common::properties::FloatProperty* max_color_threshold_property_;
     rviz_common::properties::FloatProperty* med_color_threshold_property_;
     rviz_common::properties::BoolProperty* clockwise_rotate_property_;
+    rviz_common::properties::EnumProperty* shape_property_;
+    rviz_common::properties::BoolProperty* smooth_property_;
+    rviz_common::properties::FloatProperty* smoothing_time_property_;
+    rviz_common::properties::IntProperty* animation_steps_property_;
+    rviz_common::properties::IntProperty* draw_priority_property_;
 
     int left_;
     int top_;
@@ -112,9 +146,28 @@ namespace rviz_2d_overlay_plugins
     double med_color_threshold_;
     float data_;
     bool update_required_;
+    bool value_update_required_;
     bool first_time_;
     rviz_2d_overlay_plugins::OverlayObject::SharedPtr overlay_;
+    ScheduledDraw::SharedPtr scheduled_draw_;
+    uint64_t reported_deadline_misses_;
+    ReportedTextureUsage reported_texture_usage_;
+    PropertyBatch property_batch_;
     bool clockwise_rotate_;
+    GaugeShape shape_;
+    // state of the bar currently in the texture
+    QRect drawn_fill_;
+    QRgb drawn_color_;
+    bool smooth_;
+    double smoothing_time_;
+    int animation_steps_;
+    int atlas_steps_;
+    int atlas_columns_;
+    double animated_value_;
+    double animation_target_;
+    bool animation_settled_;
+    // wall time in seconds since the animation was advanced the last time
+    double animation_dt_;
     
     std::mutex mutex_;
                        
@@ -137,6 +190,11 @@ namespace rviz_2d_overlay_plugins
     void updateMaxColorThreshold();
     void updateMedColorThreshold();
     void updateClockwiseRotate();
+    void updateShape();
+    void updateSmooth();
+    void updateSmoothingTime();
+    void updateAnimationSteps();
+    void updateDrawPriority();
 
   private:
   };
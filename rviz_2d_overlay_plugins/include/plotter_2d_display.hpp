@@ -38,10 +38,15 @@
 
 #include <mutex>
 
+#include "message_field_access.hpp"
 #include "ros_babel_fish_topic_display.hpp"
+#include "rviz_2d_overlay_msgs/msg/sample_block.hpp"
 #include "std_msgs/msg/float32.hpp"
 #ifndef Q_MOC_RUN
   #include <rviz_common/display.hpp>
+  #include "overlay_frame_scheduler.hpp"
+  #include "overlay_texture_budget.hpp"
+  #include "property_batch.hpp"
   #include "overlay_utils.hpp"
   #include <OgreColourValue.h>
   #include <OgreTexture.h>
@@ -64,6 +69,7 @@ namespace rviz_2d_overlay_plugins
   public:
     Plotter2DDisplay();
     virtual ~Plotter2DDisplay();
+    virtual void load(const rviz_common::Config & config) override;
     // methods for OverlayPickerTool
     virtual bool isInRegion(int x, int y);
     virtual void movePosition(int x, int y);
@@ -79,9 +85,24 @@ namespace rviz_2d_overlay_plugins
     virtual void onDisable();
     virtual void initializeBuffer();
     virtual void onInitialize();
-    virtual double recurseToField(const ros_babel_fish::Message & msg, size_t topic_field_idx);
+    /** @brief Everything onInitialize() does besides setting the topic message type, which needs the display
+     * context. Benchmarks run the display without one. */
+    void initializeOverlay();
+    /** @brief The value of the topic field, resolved for the type of the message if it changed. */
+    virtual double readField(const ros_babel_fish::CompoundMessage & msg);
     virtual void processMessage(ros_babel_fish::CompoundMessage::ConstSharedPtr msg) override;
+    /** @brief The channel of the block selected by the topic field, by name or index, the first one if empty. */
+    const rviz_2d_overlay_msgs::msg::SampleChannel * selectChannel(
+      const rviz_2d_overlay_msgs::msg::SampleBlock & block) const;
+    /** @brief Appends the samples to the ring buffer, only the newest buffer length samples are kept. */
+    void appendSamples(const double * values, size_t count);
+    /** @brief Sample i of the buffer, 0 is the oldest one. */
+    double sample(size_t i) const;
+    void updateScale();
     virtual void drawPlot();
+    /** @brief Resizes the texture and draws the plot, run by the OverlayFrameScheduler. */
+    virtual void drawOverlay();
+    virtual void updateTopic() override;
     ////////////////////////////////////////////////////////
     // properties
     ////////////////////////////////////////////////////////
@@ -109,11 +130,16 @@ namespace rviz_2d_overlay_plugins
     std::unique_ptr<rviz_common::properties::FloatProperty> min_value_property_;
     std::unique_ptr<rviz_common::properties::BoolProperty> auto_text_size_in_plot_property_;
     std::unique_ptr<rviz_common::properties::IntProperty> text_size_in_plot_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> draw_priority_property_;
 
     QString topic_message_type_;
     std::string topic_field_;
-    std::vector<std::string> topic_fields_;
+    FieldAccessor topic_field_accessor_;
     rviz_2d_overlay_plugins::OverlayObject::SharedPtr overlay_;
+    ScheduledDraw::SharedPtr scheduled_draw_;
+    uint64_t reported_deadline_misses_;
+    ReportedTextureUsage reported_texture_usage_;
+    PropertyBatch property_batch_;
     QColor fg_color_;
     QColor max_color_;
     QColor bg_color_;
@@ -132,7 +158,9 @@ namespace rviz_2d_overlay_plugins
     int text_size_in_plot_;
 
     int buffer_length_;
+    // ring buffer of the plotted samples, the oldest sample is at buffer_begin_
     std::vector<double> buffer_;
+    size_t buffer_begin_;
     uint16_t texture_width_;
     uint16_t texture_height_;
     int left_;
@@ -173,6 +201,7 @@ namespace rviz_2d_overlay_plugins
     void updateMaxValue();
     void updateTextSizeInPlot();
     void updateAutoTextSizeInPlot();
+    void updateDrawPriority();
 
   private:
   };
@@ -0,0 +1,90 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_PROPERTY_BATCH_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_PROPERTY_BATCH_HPP
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Defers expensive side effects of property changes while a batch is open.
+   *
+   * Displays route resubscriptions, font metrics and buffer reallocations through run(). Outside of a
+   * batch the action runs right away. Within a batch it runs once when the outermost Scope closes, so
+   * applying all properties in onInitialize() or load() does every expensive step once. */
+  class PropertyBatch
+  {
+  public:
+    /** @brief Opens a batch for its lifetime, scopes can be nested.
+     *
+     * With a timing label, the time spent in the scope including the deferred actions is logged at debug level. */
+    class Scope
+    {
+    public:
+      explicit Scope(PropertyBatch & batch, std::string timing_label = "");
+      ~Scope();
+      Scope(const Scope &) = delete;
+      Scope & operator=(const Scope &) = delete;
+
+    private:
+      PropertyBatch & batch_;
+      std::string timing_label_;
+      std::chrono::steady_clock::time_point start_;
+    };
+
+    /** @brief Runs the action now, or at the end of the current batch.
+     *
+     * Deferred actions run in the order of their first deferral, a later action with the same key replaces
+     * the earlier one. Actions have to read the property values when they run, not when they are deferred.
+     *
+     * @param key string literal identifying the side effect */
+    void run(const char * key, std::function<void()> action);
+    bool active() const;
+
+  private:
+    void commit();
+
+    int depth_ = 0;
+    std::vector<std::pair<const char *, std::function<void()>>> deferred_;
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_PROPERTY_BATCH_HPP
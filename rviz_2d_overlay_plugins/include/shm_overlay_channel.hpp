@@ -0,0 +1,155 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_SHM_OVERLAY_CHANNEL_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_SHM_OVERLAY_CHANNEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Byte order of the pixels of a shared memory frame. */
+  enum class ShmPixelFormat : uint32_t
+  {
+    RGBA8 = 0,
+    BGRA8 = 1,
+  };
+
+  /** @brief Frame of a shared memory channel, the pixels point into the mapped memory. */
+  struct ShmFrame
+  {
+    const uint8_t * data = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // bytes per row
+    uint32_t step = 0;
+    ShmPixelFormat format = ShmPixelFormat::RGBA8;
+    // number of the frame, counting from 1
+    uint64_t number = 0;
+  };
+
+  /** @brief Writes overlay frames into a POSIX shared memory ring, read by the ShmOverlayDisplay.
+   *
+   * The ring has a fixed number of slots sized for the largest frame. Every slot is guarded by a sequence
+   * lock: its sequence is odd while the writer fills the slot, readers copy the pixels and drop the frame if
+   * the sequence changed meanwhile. The writer never waits for readers, a reader that is too slow misses frames.
+   *
+   * Renders into the slot directly:
+   * @code
+   * ShmOverlayWriter writer("/robot_hud", 640, 480);
+   * uint32_t step;
+   * uint8_t * pixels = writer.beginFrame(640, 480, ShmPixelFormat::RGBA8, step);
+   * // ... render 480 rows of step bytes into pixels
+   * writer.endFrame();
+   * @endcode
+   * The writer owns the shared memory object and removes it when destroyed, unless another writer replaced it. */
+  class ShmOverlayWriter
+  {
+  public:
+    /** @brief Creates the channel, an existing channel of the same name is replaced.
+     *
+     * @param name shared memory object name, starting with '/'
+     * @throws std::system_error if the shared memory object can not be created or mapped */
+    ShmOverlayWriter(const std::string & name, uint32_t max_width, uint32_t max_height, uint32_t slot_count = 3);
+    ~ShmOverlayWriter();
+    ShmOverlayWriter(const ShmOverlayWriter &) = delete;
+    ShmOverlayWriter & operator=(const ShmOverlayWriter &) = delete;
+
+    /** @brief Returns the pixels of the next slot, readers skip the slot until endFrame().
+     *
+     * @param step set to the bytes per row of the slot
+     * @throws std::invalid_argument if the size exceeds the maximum size of the channel */
+    uint8_t * beginFrame(uint32_t width, uint32_t height, ShmPixelFormat format, uint32_t & step);
+    /** @brief Publishes the frame started by beginFrame(). */
+    void endFrame();
+    /** @brief Copies the frame into the next slot and publishes it. */
+    void write(const uint8_t * data, uint32_t width, uint32_t height, uint32_t step, ShmPixelFormat format);
+
+    uint32_t maxWidth() const;
+    uint32_t maxHeight() const;
+
+  private:
+    std::string name_;
+    void * memory_;
+    size_t size_;
+    // identity of the shared memory object, to tell it apart from the object of a replacing writer
+    uint64_t device_;
+    uint64_t inode_;
+    uint64_t frame_number_;
+    bool writing_;
+  };
+
+  /** @brief Reads the newest frame of a channel created by a ShmOverlayWriter. */
+  class ShmOverlayReader
+  {
+  public:
+    ShmOverlayReader();
+    ~ShmOverlayReader();
+    ShmOverlayReader(const ShmOverlayReader &) = delete;
+    ShmOverlayReader & operator=(const ShmOverlayReader &) = delete;
+
+    /** @brief Maps the channel, false with the reason in error if it does not exist or is invalid. */
+    bool open(const std::string & name, std::string & error);
+    void close();
+    bool isOpen() const;
+
+    /** @brief True if the writer removed or replaced the channel, it has to be opened again. */
+    bool isStale() const;
+    /** @brief True if the writer published a frame newer than the last one read. */
+    bool hasNewFrame() const;
+    /** @brief Starts reading the newest frame, false if there is no frame newer than the last one read.
+     *
+     * The pixels of the frame may be overwritten by the writer while they are read, they are only valid
+     * if endRead() returns true afterwards. */
+    bool beginRead(ShmFrame & frame);
+    /** @brief True if the frame was not overwritten since beginRead(), the frame counts as read then. */
+    bool endRead(const ShmFrame & frame);
+    /** @brief Number of the last frame read completely, 0 if none. */
+    uint64_t lastFrame() const;
+    /** @brief Makes the newest frame count as new again, e.g. to upload it again after the texture was lost. */
+    void forgetLastFrame();
+
+  private:
+    // kept open to notice when the writer removes the channel
+    int fd_;
+    void * memory_;
+    size_t size_;
+    uint64_t last_frame_;
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_SHM_OVERLAY_CHANNEL_HPP
@@ -0,0 +1,128 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#ifndef RVIZ_2D_OVERLAY_PLUGINS_SHM_OVERLAY_DISPLAY_HPP
+#define RVIZ_2D_OVERLAY_PLUGINS_SHM_OVERLAY_DISPLAY_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <rviz_common/display.hpp>
+#ifndef Q_MOC_RUN
+  #include <rviz_common/properties/int_property.hpp>
+  #include <rviz_common/properties/string_property.hpp>
+  #include "image_utils.hpp"
+  #include "overlay_frame_scheduler.hpp"
+  #include "overlay_texture_budget.hpp"
+  #include "property_batch.hpp"
+  #include "overlay_utils.hpp"
+  #include "shm_overlay_channel.hpp"
+#endif
+
+namespace rviz_2d_overlay_plugins
+{
+  /** @brief Shows the frames an external process writes into a shared memory channel with a ShmOverlayWriter.
+   *
+   * The newest frame is copied from the mapped memory straight into the locked texture, there is no
+   * message, serialization or intermediate copy. The channel is polled every frame, frames written
+   * faster than rviz renders are skipped. If the writer is not running yet or is restarted, the channel
+   * is opened again about once per second. */
+  class ShmOverlayDisplay
+    : public rviz_common::Display
+  {
+    Q_OBJECT
+  public:
+    ShmOverlayDisplay();
+    ~ShmOverlayDisplay() override;
+    void load(const rviz_common::Config & config) override;
+    // methods for OverlayPickerTool
+    virtual bool isInRegion(int x, int y);
+    virtual void movePosition(int x, int y);
+    virtual void setPosition(int x, int y);
+    virtual int getX() const { return left_; };
+    virtual int getY() const { return top_; };
+
+  protected:
+    void onInitialize() override;
+    void onEnable() override;
+    void onDisable() override;
+    void update(float wall_dt, float ros_dt) override;
+    /** @brief Upload work, run by the OverlayFrameScheduler. */
+    virtual void drawOverlay();
+
+    /** @brief Maps the channel, the result is shown in the Channel status. */
+    void openChannel();
+
+    std::unique_ptr<rviz_common::properties::StringProperty> channel_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> width_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> height_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> left_property_;
+    std::unique_ptr<rviz_common::properties::IntProperty> top_property_;
+
+    std::unique_ptr<rviz_common::properties::IntProperty> draw_priority_property_;
+
+    rviz_2d_overlay_plugins::OverlayObject::SharedPtr overlay_;
+    ScheduledDraw::SharedPtr scheduled_draw_;
+    ShmOverlayReader reader_;
+    // the newest frame, copied out of the channel and validated before it is uploaded
+    std::vector<uint8_t> frame_copy_;
+
+    std::string channel_;
+    // requested size of the overlay, 0 for the frame size
+    int width_;
+    int height_;
+    int left_;
+    int top_;
+    // size of the overlay on screen
+    int panel_width_;
+    int panel_height_;
+    // seconds since a frame was shown or the channel was opened the last time
+    float idle_time_;
+    uint64_t reported_deadline_misses_;
+    ReportedTextureUsage reported_texture_usage_;
+    PropertyBatch property_batch_;
+
+  protected Q_SLOTS:
+    void updateDrawPriority();
+    void updateChannel();
+    void updateSize();
+    void updateLeft();
+    void updateTop();
+  };
+}  // namespace rviz_2d_overlay_plugins
+
+#endif  // RVIZ_2D_OVERLAY_PLUGINS_SHM_OVERLAY_DISPLAY_HPP
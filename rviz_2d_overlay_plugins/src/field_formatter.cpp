@@ -0,0 +1,203 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "field_formatter.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+#include "message_field_access.hpp"
+
+namespace rviz_2d_overlay_plugins
+{
+  FieldFormatter::FieldFormatter(const std::string & format)
+  {
+    std::string literal;
+    size_t i = 0;
+    while (i < format.size()) {
+      const char c = format[i];
+      if (c == '{' && i + 1 < format.size() && format[i + 1] == '{') {
+        literal += '{';
+        i += 2;
+      } else if (c == '}' && i + 1 < format.size() && format[i + 1] == '}') {
+        literal += '}';
+        i += 2;
+      } else if (c == '{') {
+        const size_t end = format.find('}', i + 1);
+        if (end == std::string::npos) {
+          throw std::invalid_argument("Unterminated field at position " + std::to_string(i));
+        }
+        if (!literal.empty()) {
+          segments_.emplace_back();
+          segments_.back().literal.swap(literal);
+        }
+        segments_.push_back(parseField(format.substr(i + 1, end - i - 1)));
+        i = end + 1;
+      } else if (c == '}') {
+        throw std::invalid_argument("Single '}' at position " + std::to_string(i) + ", use '}}'");
+      } else {
+        literal += c;
+        i++;
+      }
+    }
+    if (!literal.empty()) {
+      segments_.emplace_back();
+      segments_.back().literal.swap(literal);
+    }
+  }
+
+  FieldFormatter::Segment FieldFormatter::parseField(const std::string & field)
+  {
+    Segment segment;
+    const size_t colon = field.find(':');
+    const std::string field_path = field.substr(0, colon);
+    if (splitFieldPath(field_path).empty()) {
+      throw std::invalid_argument("Empty field path in '{" + field + "}'");
+    }
+    segment.field.emplace(field_path);
+    if (colon == std::string::npos) {
+      return segment;
+    }
+
+    const std::string spec = field.substr(colon + 1);
+    size_t i = 0;
+    std::string flags;
+    while (i < spec.size() && std::string("+- 0#").find(spec[i]) != std::string::npos) {
+      flags += spec[i++];
+    }
+    const size_t width_begin = i;
+    while (i < spec.size() && std::isdigit(static_cast<unsigned char>(spec[i]))) {
+      i++;
+    }
+    std::string width = spec.substr(width_begin, i - width_begin);
+    std::string precision;
+    if (i < spec.size() && spec[i] == '.') {
+      const size_t precision_begin = i++;
+      while (i < spec.size() && std::isdigit(static_cast<unsigned char>(spec[i]))) {
+        i++;
+      }
+      precision = spec.substr(precision_begin, i - precision_begin);
+    }
+    char type = 'g';
+    if (i < spec.size()) {
+      type = spec[i++];
+    }
+    if (i != spec.size() || std::string("feEgGdxXos").find(type) == std::string::npos) {
+      throw std::invalid_argument("Invalid format specification '" + spec + "' of field '" + field_path + "'");
+    }
+
+    if (type == 's') {
+      // strings are inserted as they are, numbers get the default representation
+      return segment;
+    }
+    segment.integer_conversion = type == 'd' || type == 'x' || type == 'X' || type == 'o';
+    segment.printf_format = "%" + flags + width + (segment.integer_conversion ? "" : precision) +
+      (segment.integer_conversion ? "ll" : "") + type;
+    return segment;
+  }
+
+  void FieldFormatter::appendValue(double value, const Segment & segment, std::string & out)
+  {
+    char buffer[64];
+    int length;
+    if (segment.printf_format.empty()) {
+      // integral values without exponent, e.g. counters and enums
+      if (std::abs(value) < 1e15 && value == std::floor(value)) {
+        length = std::snprintf(buffer, sizeof(buffer), "%.0f", value);
+      } else {
+        length = std::snprintf(buffer, sizeof(buffer), "%g", value);
+      }
+    } else if (segment.integer_conversion) {
+      // the conversion is undefined for NaN, infinity and values beyond the range of long long
+      if (!std::isfinite(value) || value < -0x1p63 || value >= 0x1p63) {
+        length = std::snprintf(buffer, sizeof(buffer), "%g", value);
+      } else {
+        length = std::snprintf(buffer, sizeof(buffer), segment.printf_format.c_str(), static_cast<long long>(value));
+      }
+    } else {
+      length = std::snprintf(buffer, sizeof(buffer), segment.printf_format.c_str(), value);
+    }
+    if (length > 0) {
+      out.append(buffer, std::min<size_t>(static_cast<size_t>(length), sizeof(buffer) - 1));
+    }
+  }
+
+  void FieldFormatter::format(const ros_babel_fish::CompoundMessage & msg, std::string & out)
+  {
+    out.clear();
+    const std::string message_type = msg.name();
+    for (auto & segment : segments_) {
+      if (!segment.field) {
+        out += segment.literal;
+        continue;
+      }
+
+      FieldAccessor & field = *segment.field;
+      // the field is only looked up by name for the first message of a type
+      field.resolve(message_type);
+      switch (field.kind()) {
+        case FieldAccessor::Kind::String:
+          out += field.stringValue(msg);
+          break;
+        case FieldAccessor::Kind::Bool:
+          if (segment.printf_format.empty()) {
+            out += field.value(msg) != 0.0 ? "true" : "false";
+          } else {
+            appendValue(field.value(msg), segment, out);
+          }
+          break;
+        case FieldAccessor::Kind::Array:
+          values_.clear();
+          field.appendValues(msg, values_);
+          out += '[';
+          for (size_t i = 0; i < values_.size(); i++) {
+            if (i > 0) {
+              out += ", ";
+            }
+            appendValue(values_[i], segment, out);
+          }
+          out += ']';
+          break;
+        default:
+          appendValue(field.value(msg), segment, out);
+          break;
+      }
+    }
+  }
+}  // namespace rviz_2d_overlay_plugins
@@ -0,0 +1,116 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#include "font_cache.hpp"
+
+#include <algorithm>
+
+namespace rviz_2d_overlay_plugins
+{
+  ResolvedFont::ResolvedFont(const QFont & font)
+    : font(font), metrics(font)
+  {
+  }
+
+  FontCache & FontCache::instance()
+  {
+    static FontCache cache;
+    return cache;
+  }
+
+  std::shared_ptr<const ResolvedFont> FontCache::get(const QString & family, int point_size, int weight)
+  {
+    std::scoped_lock lock(mutex_);
+    Key key(family, point_size, weight);
+    const auto found = index_.find(key);
+    if (found != index_.end()) {
+      entries_.splice(entries_.begin(), entries_, found->second);
+      return found->second->second;
+    }
+
+    misses_++;
+    QFont font;
+    if (!family.isEmpty()) {
+      font.setFamily(family);
+    }
+    // QFont rejects sizes below 1 with a warning
+    font.setPointSize(std::max(1, point_size));
+    font.setWeight(weight);
+    auto resolved = std::make_shared<const ResolvedFont>(font);
+    entries_.emplace_front(key, resolved);
+    index_.emplace(std::move(key), entries_.begin());
+    evict();
+    return resolved;
+  }
+
+  QFont FontCache::font(const QString & family, int point_size, int weight)
+  {
+    return get(family, point_size, weight)->font;
+  }
+
+  void FontCache::setCapacity(size_t capacity)
+  {
+    std::scoped_lock lock(mutex_);
+    capacity_ = std::max<size_t>(1, capacity);
+    evict();
+  }
+
+  size_t FontCache::capacity() const
+  {
+    std::scoped_lock lock(mutex_);
+    return capacity_;
+  }
+
+  size_t FontCache::size() const
+  {
+    std::scoped_lock lock(mutex_);
+    return entries_.size();
+  }
+
+  uint64_t FontCache::misses() const
+  {
+    std::scoped_lock lock(mutex_);
+    return misses_;
+  }
+
+  void FontCache::evict()
+  {
+    // fonts still held by a display stay valid, they are only resolved again when requested the next time
+    while (entries_.size() > capacity_) {
+      index_.erase(entries_.back().first);
+      entries_.pop_back();
+    }
+  }
+}  // namespace rviz_2d_overlay_plugins
@@ -0,0 +1,77 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#include "font_catalog.hpp"
+
+#include <chrono>
+
+#include <QFontDatabase>
+
+namespace rviz_2d_overlay_plugins
+{
+  FontCatalog & FontCatalog::instance()
+  {
+    static FontCatalog catalog;
+    return catalog;
+  }
+
+  FontCatalog::FontCatalog()
+  {
+    // QFontDatabase is thread-safe, scanning the installed fonts does not block the GUI thread
+    families_ = std::async(std::launch::async, []() {
+      QFontDatabase database;
+      return database.families();
+    }).share();
+  }
+
+  const QStringList & FontCatalog::families() const
+  {
+    return families_.get();
+  }
+
+  bool FontCatalog::ready() const
+  {
+    return families_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  void FontCatalog::fillOptions(rviz_common::properties::EnumProperty & property) const
+  {
+    const QStringList & font_families = families();
+    property.clearOptions();
+    for (int i = 0; i < font_families.size(); i++) {
+      property.addOption(font_families[i], i);
+    }
+  }
+}  // namespace rviz_2d_overlay_plugins
@@ -0,0 +1,197 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "gauge_utils.hpp"
+#include "font_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <sstream>
+
+namespace rviz_2d_overlay_plugins
+{
+  namespace
+  {
+    const int outer_line_width = 5;
+    const int value_line_width = 10;
+    const int value_indicator_line_width = 2;
+    const int value_padding = 5;
+    const int value_aabb_offset = outer_line_width + value_padding + value_line_width / 2;
+    const int bar_frame_line_width = 2;
+    const int bar_padding = 2;
+  }  // namespace
+
+  QColor gaugeValueColor(const GaugeStyle & style, double value)
+  {
+    QColor fg_color(style.fg_color);
+
+    if (style.auto_color_change) {
+      double r
+        = std::min(1.0, fabs((value - style.min_value) / (style.max_value - style.min_value)));
+      if (r > 0.6) {
+        double r2 = (r - 0.6) / 0.4;
+        fg_color.setRed((style.max_color.red() - style.fg_color.red()) * r2
+                        + style.fg_color.red());
+        fg_color.setGreen((style.max_color.green() - style.fg_color.green()) * r2
+                          + style.fg_color.green());
+        fg_color.setBlue((style.max_color.blue() - style.fg_color.blue()) * r2
+                         + style.fg_color.blue());
+      }
+      if (style.max_color_threshold != 0) {
+        if (r > style.max_color_threshold) {
+          fg_color.setRed(style.max_color.red());
+          fg_color.setGreen(style.max_color.green());
+          fg_color.setBlue(style.max_color.blue());
+        }
+      }
+      if (style.med_color_threshold != 0) {
+        if (style.max_color_threshold > r && r > style.med_color_threshold) {
+          fg_color.setRed(style.med_color.red());
+          fg_color.setGreen(style.med_color.green());
+          fg_color.setBlue(style.med_color.blue());
+        }
+      }
+    }
+    return fg_color;
+  }
+
+  void drawGaugeRing(
+    QPainter & painter, const QRect & cell, int caption_offset,
+    const QColor & value_color, const GaugeStyle & style)
+  {
+    QColor fg_color(value_color);
+    QColor fg_color2(value_color);
+    fg_color.setAlpha(style.fg_alpha);
+    fg_color2.setAlpha(style.fg_alpha2);
+    const int width = cell.width();
+    const int height = cell.height();
+
+    painter.setPen(QPen(fg_color, outer_line_width, Qt::SolidLine));
+    painter.drawEllipse(cell.x() + outer_line_width / 2, cell.y() + outer_line_width / 2,
+                        width - outer_line_width,
+                        height - outer_line_width - caption_offset);
+
+    painter.setPen(QPen(fg_color2, value_indicator_line_width, Qt::SolidLine));
+    painter.drawEllipse(cell.x() + value_aabb_offset, cell.y() + value_aabb_offset,
+                        width - value_aabb_offset * 2,
+                        height - value_aabb_offset * 2 - caption_offset);
+  }
+
+  void drawGaugeValue(
+    QPainter & painter, const QRect & cell, int caption_offset,
+    const QColor & value_color, double value, const QString & caption, const GaugeStyle & style)
+  {
+    QColor fg_color(value_color);
+    fg_color.setAlpha(style.fg_alpha);
+    const int width = cell.width();
+    const int height = cell.height();
+
+    const double ratio = (value - style.min_value) / (style.max_value - style.min_value);
+    const double rotate_direction = style.clockwise_rotate ? -1.0 : 1.0;
+    const double ratio_angle = ratio * 360.0 * rotate_direction;
+    const double start_angle_offset = -90;
+    painter.setPen(QPen(fg_color, value_line_width, Qt::SolidLine));
+    painter.drawArc(QRectF(cell.x() + value_aabb_offset, cell.y() + value_aabb_offset,
+                           width - value_aabb_offset * 2,
+                           height - value_aabb_offset * 2 - caption_offset),
+                    start_angle_offset * 16,
+                    ratio_angle * 16);
+    painter.setFont(FontCache::instance().font(QString(), style.text_size, QFont::Bold));
+    painter.setPen(QPen(fg_color, value_line_width, Qt::SolidLine));
+    painter.drawText(cell.x(), cell.y(), width, height - caption_offset,
+                     Qt::AlignCenter | Qt::AlignVCenter,
+                     formatGaugeValue(value));
+
+    if (!caption.isEmpty()) {
+      painter.drawText(cell.x(), cell.y() + height - caption_offset, width, caption_offset,
+                       Qt::AlignCenter | Qt::AlignVCenter,
+                       caption);
+    }
+  }
+
+  QString formatGaugeValue(double value)
+  {
+    std::ostringstream s;
+    s << std::fixed << std::setprecision(2) << value;
+    return QString::fromStdString(s.str());
+  }
+
+  QRect barGaugeInnerRect(const QRect & bar)
+  {
+    const int inset = bar_frame_line_width + bar_padding;
+    return bar.adjusted(inset, inset, -inset, -inset);
+  }
+
+  QRect barGaugeFillRect(const QRect & inner, double value, bool vertical, const GaugeStyle & style)
+  {
+    const double ratio =
+      std::min(std::max((value - style.min_value) / (style.max_value - style.min_value), 0.0), 1.0);
+    if (vertical) {
+      const int extent = std::lround(ratio * inner.height());
+      if (style.clockwise_rotate) {
+        return QRect(inner.left(), inner.top(), inner.width(), extent);
+      }
+      return QRect(inner.left(), inner.bottom() + 1 - extent, inner.width(), extent);
+    }
+    const int extent = std::lround(ratio * inner.width());
+    if (style.clockwise_rotate) {
+      return QRect(inner.right() + 1 - extent, inner.top(), extent, inner.height());
+    }
+    return QRect(inner.left(), inner.top(), extent, inner.height());
+  }
+
+  void drawBarGauge(
+    QPainter & painter, const QRect & bar, bool vertical,
+    const QColor & value_color, double value, const GaugeStyle & style)
+  {
+    QColor fg_color(value_color);
+    QColor fg_color2(value_color);
+    fg_color.setAlpha(style.fg_alpha);
+    fg_color2.setAlpha(style.fg_alpha2);
+
+    painter.setPen(QPen(fg_color2, bar_frame_line_width, Qt::SolidLine));
+    painter.setBrush(Qt::NoBrush);
+    painter.drawRect(QRectF(bar).adjusted(bar_frame_line_width / 2.0, bar_frame_line_width / 2.0,
+                                          -bar_frame_line_width / 2.0, -bar_frame_line_width / 2.0));
+    // the fill is written without blending, so that incremental updates of the
+    // fill produce exactly the same pixels
+    painter.save();
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.fillRect(barGaugeFillRect(barGaugeInnerRect(bar), value, vertical, style), fg_color);
+    painter.restore();
+  }
+}  // namespace rviz_2d_overlay_plugins
@@ -0,0 +1,487 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#include "image_overlay_display.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <OgreHardwarePixelBuffer.h>
+#include <QBuffer>
+#include <QImageReader>
+#include <rviz_common/uniform_string_stream.hpp>
+#include <rviz_rendering/render_system.hpp>
+#include <sensor_msgs/msg/image.hpp>
+
+#include "rviz_2d_overlay_msgs/msg/overlay_image.hpp"
+
+namespace rviz_2d_overlay_plugins
+{
+  namespace
+  {
+    const char OVERLAY_IMAGE_TYPE[] = "rviz_2d_overlay_msgs/msg/OverlayImage";
+    const char COMPRESSED_IMAGE_TYPE[] = "sensor_msgs/msg/CompressedImage";
+
+    // size of the overlay on screen, a single requested dimension keeps the aspect ratio of the image
+    void panelSize(const ImageView & image, int width, int height, uint32_t & panel_width, uint32_t & panel_height)
+    {
+      if (width > 0 && height > 0) {
+        panel_width = width;
+        panel_height = height;
+      } else if (width > 0) {
+        panel_width = width;
+        panel_height = std::max(1L, std::lround(static_cast<double>(width) * image.height / image.width));
+      } else if (height > 0) {
+        panel_width = std::max(1L, std::lround(static_cast<double>(height) * image.width / image.height));
+        panel_height = height;
+      } else {
+        panel_width = image.width;
+        panel_height = image.height;
+      }
+    }
+  }  // namespace
+
+  ImageOverlayDisplay::ImageOverlayDisplay()
+    : next_decoder_(0), image_pool_(std::make_shared<ImagePool>()), sequence_(0), discarded_sequence_(0),
+      frame_changed_(false), deleted_(false), image_error_changed_(false), reported_deadline_misses_(0)
+  {
+    topic_message_type_property_ = std::make_unique<rviz_common::properties::StringProperty>(
+      "Topic Message Type", "sensor_msgs/msg/Image",
+      "Topic message type to subscribe to, sensor_msgs/msg/Image, sensor_msgs/msg/CompressedImage "
+      "or rviz_2d_overlay_msgs/msg/OverlayImage",
+      this, SLOT(updateTopicMessageType()));
+    width_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "width", 0,
+      "width of the overlay, 0 for the image width. Not used for OverlayImage",
+      this, SLOT(updateSize()));
+    width_property_->setMin(0);
+    height_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "height", 0,
+      "height of the overlay, 0 for the image height. Not used for OverlayImage",
+      this, SLOT(updateSize()));
+    height_property_->setMin(0);
+    left_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "left", 128,
+      "left of the overlay. Not used for OverlayImage",
+      this, SLOT(updateLeft()));
+    left_property_->setMin(0);
+    top_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "top", 128,
+      "top of the overlay. Not used for OverlayImage",
+      this, SLOT(updateTop()));
+    top_property_->setMin(0);
+    decode_threads_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "decode threads", 2,
+      "number of threads decoding compressed images, more threads keep up with larger images at higher rates",
+      this, SLOT(updateDecodeThreads()));
+    decode_threads_property_->setMin(1);
+    decode_threads_property_->setMax(8);
+    draw_priority_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "draw priority", 0,
+      "overlays with higher priority are drawn first if not all overlays can be drawn within a frame",
+      this, SLOT(updateDrawPriority()));
+  }
+
+  ImageOverlayDisplay::~ImageOverlayDisplay()
+  {
+    // a running downscale or decode writes into the members
+    worker_.reset();
+    decoders_.clear();
+    scheduled_draw_.reset();
+    onDisable();
+  }
+
+  void ImageOverlayDisplay::onInitialize()
+  {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": initialize");
+    RTDClass::onInitialize();
+    rviz_rendering::RenderSystem::get()->prepareOverlays(scene_manager_);
+    static int count = 0;
+    rviz_common::UniformStringStream ss;
+    ss << "ImageOverlayDisplayObject" << count++;
+    overlay_ = std::make_shared<OverlayObject>(ss.str());
+    scheduled_draw_ = ScheduledDraw::create([this]() {drawOverlay();});
+    worker_ = std::make_unique<LatestTaskWorker>();
+    overlay_->setTextureLostCallback([this]() {
+      std::scoped_lock lock(mutex_);
+      // the current frame is kept, it is uploaded again
+      frame_changed_ = true;
+    });
+    onEnable();
+    updateTopicMessageType();
+    updateSize();
+    updateLeft();
+    updateTop();
+    updateDecodeThreads();
+    updateDrawPriority();
+  }
+
+  void ImageOverlayDisplay::load(const rviz_common::Config & config)
+  {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": load config");
+    RTDClass::load(config);
+  }
+
+  void ImageOverlayDisplay::setTopic(const QString & topic, const QString & datatype)
+  {
+    topic_message_type_property_->setString(datatype);
+    RTDClass::setTopic(topic, datatype);
+  }
+
+  void ImageOverlayDisplay::updateTopic()
+  {
+    property_batch_.run("topic", [this]() {RTDClass::updateTopic();});
+  }
+
+  void ImageOverlayDisplay::onEnable()
+  {
+    subscribe();
+    if (overlay_) {
+      overlay_->show();
+    }
+  }
+
+  void ImageOverlayDisplay::onDisable()
+  {
+    unsubscribe();
+    if (overlay_) {
+      overlay_->hide();
+      overlay_->releaseTexture();
+    }
+    std::scoped_lock lock(mutex_);
+    // the messages are not kept alive while disabled, the next message is shown after enabling
+    source_ = Frame();
+    frame_ = Frame();
+    frame_changed_ = false;
+    discarded_sequence_ = sequence_;
+  }
+
+  void ImageOverlayDisplay::processMessage(ros_babel_fish::CompoundMessage::ConstSharedPtr msg)
+  {
+    std::scoped_lock lock(mutex_);
+
+    if (!isEnabled()) {
+      return;
+    }
+
+    // the babel fish message is the C++ message of the subscribed type, the image data is not copied
+    if (message_type_ == COMPRESSED_IMAGE_TYPE) {
+      if (decoders_.empty()) {
+        return;
+      }
+      auto compressed =
+        std::static_pointer_cast<const sensor_msgs::msg::CompressedImage>(msg->type_erased_message());
+      const uint64_t sequence = ++sequence_;
+      // a busy decoder replaces its pending message, the round robin spreads the messages over all decoders
+      decoders_[next_decoder_++ % decoders_.size()]->submit([this, compressed, sequence, placement = placement_]() {
+        decodeFrame(*compressed, sequence, placement);
+      });
+      return;
+    }
+
+    std::shared_ptr<const sensor_msgs::msg::Image> image;
+    if (message_type_ == OVERLAY_IMAGE_TYPE) {
+      auto overlay_image =
+        std::static_pointer_cast<const rviz_2d_overlay_msgs::msg::OverlayImage>(msg->type_erased_message());
+      if (overlay_image->action == rviz_2d_overlay_msgs::msg::OverlayImage::DELETE) {
+        deleted_ = true;
+        source_ = Frame();
+        frame_ = Frame();
+        discarded_sequence_ = sequence_;
+        return;
+      }
+      deleted_ = false;
+      placement_.width = overlay_image->width;
+      placement_.height = overlay_image->height;
+      placement_.horizontal_distance = overlay_image->horizontal_distance;
+      placement_.vertical_distance = overlay_image->vertical_distance;
+      placement_.horizontal_alignment = HorizontalAlignment{overlay_image->horizontal_alignment};
+      placement_.vertical_alignment = VerticalAlignment{overlay_image->vertical_alignment};
+      image = std::shared_ptr<const sensor_msgs::msg::Image>(overlay_image, &overlay_image->image);
+    } else {
+      image = std::static_pointer_cast<const sensor_msgs::msg::Image>(msg->type_erased_message());
+    }
+
+    ImageFormat format;
+    if (!imageFormatFromEncoding(image->encoding, format)) {
+      setImageError(
+        QString::fromStdString("Unsupported encoding '" + image->encoding + "', expected rgba8, bgra8 or mono8"));
+      return;
+    }
+    if (image->width == 0 || image->height == 0 || image->step < image->width * bytesPerPixel(format) ||
+        image->data.size() < static_cast<size_t>(image->step) * image->height) {
+      setImageError(
+        QString("Invalid image: size %1 x %2, step %3, %4 bytes of data")
+        .arg(image->width).arg(image->height).arg(image->step).arg(image->data.size()));
+      return;
+    }
+    setImageError(QString());
+
+    source_.storage = image;
+    source_.view = ImageView{image->data.data(), image->width, image->height, image->step, format};
+    source_.sequence = ++sequence_;
+    scheduleFrame();
+  }
+
+  void ImageOverlayDisplay::scheduleFrame()
+  {
+    if (!source_.storage) {
+      return;
+    }
+    uint32_t panel_width;
+    uint32_t panel_height;
+    panelSize(source_.view, placement_.width, placement_.height, panel_width, panel_height);
+    if (source_.view.width <= panel_width && source_.view.height <= panel_height) {
+      // smaller images are stretched by the panel
+      frame_ = fitFrame(source_, placement_);
+      frame_changed_ = true;
+      return;
+    }
+
+    // the task keeps the message alive until the downscaled copy is done
+    worker_->submit([this, source = source_, placement = placement_]() {
+      Frame frame = fitFrame(source, placement);
+      std::scoped_lock lock(mutex_);
+      // the display was disabled or a newer frame is shown already
+      if (source.sequence != source_.sequence || source.sequence < frame_.sequence) {
+        return;
+      }
+      frame_ = std::move(frame);
+      frame_changed_ = true;
+    });
+  }
+
+  ImageOverlayDisplay::Frame ImageOverlayDisplay::fitFrame(const Frame & source, const Placement & placement)
+  {
+    Frame frame = source;
+    panelSize(source.view, placement.width, placement.height, frame.panel_width, frame.panel_height);
+    const uint32_t width = std::min(source.view.width, frame.panel_width);
+    const uint32_t height = std::min(source.view.height, frame.panel_height);
+    if (width == source.view.width && height == source.view.height) {
+      return frame;
+    }
+    auto pixels = std::make_shared<std::vector<uint8_t>>();
+    downscaleArea(source.view, width, height, *pixels);
+    frame.storage = pixels;
+    frame.view.data = pixels->data();
+    frame.view.width = width;
+    frame.view.height = height;
+    frame.view.step = static_cast<size_t>(width) * bytesPerPixel(source.view.format);
+    return frame;
+  }
+
+  void ImageOverlayDisplay::decodeFrame(
+    const sensor_msgs::msg::CompressedImage & image, uint64_t sequence, const Placement & placement)
+  {
+    // the reader works on the message data, the format is detected from the content
+    QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char *>(image.data.data()), image.data.size());
+    QBuffer buffer(&data);
+    QImageReader reader(&buffer);
+    std::shared_ptr<QImage> decoded = image_pool_->acquire();
+    if (!reader.read(decoded.get())) {
+      std::scoped_lock lock(mutex_);
+      setImageError(QString::fromStdString("Decoding the " + image.format + " image failed: ") +
+                    reader.errorString());
+      return;
+    }
+
+    Frame source;
+    if (!imageViewFromQImage(*decoded, source.view)) {
+      // e.g. indexed or 16 bit PNGs
+      *decoded = decoded->convertToFormat(QImage::Format_RGBA8888);
+      imageViewFromQImage(*decoded, source.view);
+    }
+    source.storage = decoded;
+    source.sequence = sequence;
+    Frame frame = fitFrame(source, placement);
+
+    std::scoped_lock lock(mutex_);
+    setImageError(QString());
+    // only the newest frame is shown, frames received before disabling are dropped
+    if (sequence <= discarded_sequence_ || sequence < frame_.sequence) {
+      return;
+    }
+    source_ = std::move(source);
+    frame_ = std::move(frame);
+    frame_changed_ = true;
+  }
+
+  void ImageOverlayDisplay::setImageError(const QString & error)
+  {
+    if (error != image_error_) {
+      image_error_ = error;
+      image_error_changed_ = true;
+    }
+  }
+
+  void ImageOverlayDisplay::update(float /*wall_dt*/, float /*ros_dt*/)
+  {
+    reportDeadlineMisses(*this, *scheduled_draw_, reported_deadline_misses_);
+    reportTextureUsage(*this, *overlay_, reported_texture_usage_);
+    std::scoped_lock lock(mutex_);
+    // errors of the decoder threads are reported here, the property tree may only be changed on this thread
+    if (image_error_changed_) {
+      if (image_error_.isEmpty()) {
+        deleteStatus("Image");
+      } else {
+        setStatus(rviz_common::properties::StatusProperty::Error, "Image", image_error_);
+      }
+      image_error_changed_ = false;
+    }
+    if (deleted_ && overlay_->isVisible()) {
+      overlay_->hide();
+      overlay_->releaseTexture();
+    } else if (!deleted_ && !overlay_->isVisible()) {
+      overlay_->show();
+    }
+    // off screen only the latest frame is kept, it is uploaded once visible again
+    if (frame_changed_ && overlay_->isOnScreen()) {
+      scheduled_draw_->requestDraw();
+    }
+  }
+
+  void ImageOverlayDisplay::drawOverlay()
+  {
+    std::scoped_lock lock(mutex_);
+
+    if (!overlay_ || !overlay_->isVisible() || !frame_changed_ || !frame_.storage) {
+      return;
+    }
+    frame_changed_ = false;
+
+    overlay_->updateTextureSize(frame_.view.width, frame_.view.height, texturePixelFormat(frame_.view.format));
+    overlay_->setDimensions(frame_.panel_width, frame_.panel_height);
+    applyPosition();
+    rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer();
+    copyToPixelBox(frame_.view, buffer.getPixelBuffer()->getCurrentLock());
+  }
+
+  void ImageOverlayDisplay::applyPosition()
+  {
+    if (overlay_) {
+      overlay_->setPosition(placement_.horizontal_distance, placement_.vertical_distance,
+                            placement_.horizontal_alignment, placement_.vertical_alignment);
+    }
+  }
+
+  void ImageOverlayDisplay::updateTopicMessageType()
+  {
+    {
+      std::scoped_lock lock(mutex_);
+      message_type_ = topic_message_type_property_->getStdString();
+      // sensor_msgs/Image is placed by the properties
+      placement_ = property_placement_;
+    }
+    topic_property_->setMessageType(topic_message_type_property_->getString());
+    updateTopic();
+  }
+
+  void ImageOverlayDisplay::updateSize()
+  {
+    std::scoped_lock lock(mutex_);
+    property_placement_.width = width_property_->getInt();
+    property_placement_.height = height_property_->getInt();
+    if (message_type_ != OVERLAY_IMAGE_TYPE) {
+      placement_ = property_placement_;
+      // the latest image is downscaled again for the new size
+      scheduleFrame();
+    }
+  }
+
+  void ImageOverlayDisplay::updateLeft()
+  {
+    std::scoped_lock lock(mutex_);
+    property_placement_.horizontal_distance = left_property_->getInt();
+    if (message_type_ != OVERLAY_IMAGE_TYPE) {
+      placement_.horizontal_distance = property_placement_.horizontal_distance;
+      applyPosition();
+    }
+  }
+
+  void ImageOverlayDisplay::updateTop()
+  {
+    std::scoped_lock lock(mutex_);
+    property_placement_.vertical_distance = top_property_->getInt();
+    if (message_type_ != OVERLAY_IMAGE_TYPE) {
+      placement_.vertical_distance = property_placement_.vertical_distance;
+      applyPosition();
+    }
+  }
+
+  void ImageOverlayDisplay::updateDecodeThreads()
+  {
+    property_batch_.run("decode threads", [this]() {
+      std::vector<std::unique_ptr<LatestTaskWorker>> previous;
+      {
+        std::scoped_lock lock(mutex_);
+        previous.swap(decoders_);
+        for (int i = 0; i < decode_threads_property_->getInt(); i++) {
+          decoders_.push_back(std::make_unique<LatestTaskWorker>());
+        }
+      }
+      // joined without the lock, a running decode stores its frame before it finishes
+    });
+  }
+
+  void ImageOverlayDisplay::updateDrawPriority()
+  {
+    scheduled_draw_->setPriority(draw_priority_property_->getInt());
+    overlay_->setPriority(draw_priority_property_->getInt());
+  }
+
+  bool ImageOverlayDisplay::isInRegion(int x, int y)
+  {
+    // only placements relative to the top left corner can be picked
+    const int left = placement_.horizontal_distance;
+    const int top = placement_.vertical_distance;
+    return (top < y && top + static_cast<int>(frame_.panel_height) > y &&
+            left < x && left + static_cast<int>(frame_.panel_width) > x);
+  }
+
+  void ImageOverlayDisplay::movePosition(int x, int y)
+  {
+    placement_.vertical_distance = y;
+    placement_.horizontal_distance = x;
+  }
+
+  void ImageOverlayDisplay::setPosition(int x, int y)
+  {
+    top_property_->setValue(y);
+    left_property_->setValue(x);
+  }
+}  // namespace rviz_2d_overlay_plugins
+
+#include <pluginlib/class_list_macros.hpp>
+PLUGINLIB_EXPORT_CLASS( rviz_2d_overlay_plugins::ImageOverlayDisplay, rviz_common::Display )
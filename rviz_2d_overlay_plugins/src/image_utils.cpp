@@ -0,0 +1,277 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#include "image_utils.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace rviz_2d_overlay_plugins
+{
+  namespace
+  {
+    // weights of the area filter sum up to WEIGHT_ONE per axis
+    constexpr uint32_t WEIGHT_BITS = 8;
+    constexpr uint32_t WEIGHT_ONE = 1u << WEIGHT_BITS;
+
+    // source pixels covered by every target pixel along one axis and the fraction they cover
+    struct AreaWeights
+    {
+      std::vector<uint32_t> first;
+      std::vector<uint32_t> count;
+      // stride weights per target pixel, only the first count are used
+      std::vector<uint16_t> weights;
+      uint32_t stride = 0;
+    };
+
+    AreaWeights areaWeights(uint32_t source_size, uint32_t target_size)
+    {
+      AreaWeights result;
+      const double scale = static_cast<double>(source_size) / target_size;
+      result.stride = static_cast<uint32_t>(std::ceil(scale)) + 1;
+      result.first.resize(target_size);
+      result.count.resize(target_size);
+      result.weights.assign(static_cast<size_t>(target_size) * result.stride, 0);
+      for (uint32_t i = 0; i < target_size; i++) {
+        const double begin = i * scale;
+        const double end = std::min<double>((i + 1) * scale, source_size);
+        const uint32_t first = std::min(source_size - 1, static_cast<uint32_t>(begin));
+        const uint32_t last = std::max(first, std::min(source_size - 1, static_cast<uint32_t>(std::ceil(end)) - 1));
+        uint16_t * weights = &result.weights[static_cast<size_t>(i) * result.stride];
+        result.first[i] = first;
+        result.count[i] = last - first + 1;
+        // every weight is the difference of the rounded coverage up to the end and up to the start of its
+        // source pixel, so the weights are never negative and sum up to exactly WEIGHT_ONE
+        uint32_t previous = 0;
+        for (uint32_t j = first; j <= last; j++) {
+          const double covered = std::min<double>(j + 1, end) - begin;
+          const uint32_t cumulative = j == last ? WEIGHT_ONE :
+            std::min<uint32_t>(WEIGHT_ONE, static_cast<uint32_t>(std::lround(covered / scale * WEIGHT_ONE)));
+          weights[j - first] = static_cast<uint16_t>(cumulative - previous);
+          previous = cumulative;
+        }
+      }
+      return result;
+    }
+
+    // horizontal pass of a single row, the results are scaled by WEIGHT_ONE
+    void filterRow(const uint8_t * row, const AreaWeights & horizontal, uint32_t channels, uint16_t * filtered)
+    {
+      const size_t width = horizontal.first.size();
+      for (size_t x = 0; x < width; x++) {
+        const uint8_t * source = row + static_cast<size_t>(horizontal.first[x]) * channels;
+        const uint16_t * weights = &horizontal.weights[x * horizontal.stride];
+        const uint32_t count = horizontal.count[x];
+        for (uint32_t c = 0; c < channels; c++) {
+          uint32_t sum = 0;
+          for (uint32_t k = 0; k < count; k++) {
+            sum += source[k * channels + c] * weights[k];
+          }
+          filtered[x * channels + c] = static_cast<uint16_t>(sum);
+        }
+      }
+    }
+  }  // namespace
+
+  bool imageFormatFromEncoding(const std::string & encoding, ImageFormat & format)
+  {
+    if (encoding == "bgra8") {
+      format = ImageFormat::BGRA8;
+    } else if (encoding == "rgba8") {
+      format = ImageFormat::RGBA8;
+    } else if (encoding == "mono8" || encoding == "8UC1") {
+      format = ImageFormat::MONO8;
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  uint32_t bytesPerPixel(ImageFormat format)
+  {
+    return format == ImageFormat::MONO8 ? 1 : 4;
+  }
+
+  Ogre::PixelFormat texturePixelFormat(ImageFormat format)
+  {
+    // the byte order of PF_BYTE_* does not depend on the endianness, unlike the packed formats
+    return format == ImageFormat::RGBA8 ? Ogre::PF_BYTE_RGBA : Ogre::PF_BYTE_BGRA;
+  }
+
+  bool imageViewFromQImage(const QImage & image, ImageView & view)
+  {
+    switch (image.format()) {
+      case QImage::Format_RGBA8888:
+      case QImage::Format_RGBX8888:
+        view.format = ImageFormat::RGBA8;
+        break;
+      case QImage::Format_Grayscale8:
+        view.format = ImageFormat::MONO8;
+        break;
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+      // 0xAARRGGBB words, the alpha of RGB32 is always 0xff
+      case QImage::Format_ARGB32:
+      case QImage::Format_RGB32:
+        view.format = ImageFormat::BGRA8;
+        break;
+#endif
+      default:
+        return false;
+    }
+    view.data = image.constBits();
+    view.width = image.width();
+    view.height = image.height();
+    view.step = image.bytesPerLine();
+    return true;
+  }
+
+  void copyToPixelBox(const ImageView & image, const Ogre::PixelBox & box)
+  {
+    const size_t box_bytes_per_pixel = Ogre::PixelUtil::getNumElemBytes(box.format);
+    const size_t box_step = box.rowPitch * box_bytes_per_pixel;
+    const uint32_t width = std::min<uint32_t>(image.width, box.getWidth());
+    const uint32_t height = std::min<uint32_t>(image.height, box.getHeight());
+    uint8_t * target = static_cast<uint8_t *>(box.data);
+
+    if (image.format != ImageFormat::MONO8 && box.format == texturePixelFormat(image.format)) {
+      const size_t row_bytes = static_cast<size_t>(width) * 4;
+      if (box_step == image.step && width == image.width) {
+        std::memcpy(target, image.data, row_bytes * height);
+        return;
+      }
+      for (uint32_t y = 0; y < height; y++) {
+        std::memcpy(target + y * box_step, image.data + y * image.step, row_bytes);
+      }
+      return;
+    }
+
+    // conversion into a BGRA texture
+    for (uint32_t y = 0; y < height; y++) {
+      const uint8_t * source = image.data + y * image.step;
+      uint8_t * row = target + y * box_step;
+      if (image.format == ImageFormat::MONO8) {
+        for (uint32_t x = 0; x < width; x++) {
+          row[4 * x] = source[x];
+          row[4 * x + 1] = source[x];
+          row[4 * x + 2] = source[x];
+          row[4 * x + 3] = 255;
+        }
+      } else {
+        // RGBA into BGRA, swap red and blue
+        for (uint32_t x = 0; x < width; x++) {
+          row[4 * x] = source[4 * x + 2];
+          row[4 * x + 1] = source[4 * x + 1];
+          row[4 * x + 2] = source[4 * x];
+          row[4 * x + 3] = source[4 * x + 3];
+        }
+      }
+    }
+  }
+
+  void downscaleArea(const ImageView & source, uint32_t width, uint32_t height, std::vector<uint8_t> & target)
+  {
+    width = std::max(1u, std::min(width, source.width));
+    height = std::max(1u, std::min(height, source.height));
+    const uint32_t channels = bytesPerPixel(source.format);
+    const size_t row_values = static_cast<size_t>(width) * channels;
+    target.resize(row_values * height);
+
+    const AreaWeights horizontal = areaWeights(source.width, width);
+    const AreaWeights vertical = areaWeights(source.height, height);
+    std::vector<uint16_t> filtered(row_values);
+    std::vector<uint32_t> accumulated(row_values);
+    // a source row on the border of two target rows is filtered once for both
+    uint32_t filtered_row = source.height;
+
+    for (uint32_t y = 0; y < height; y++) {
+      std::fill(accumulated.begin(), accumulated.end(), 0u);
+      const uint16_t * weights = &vertical.weights[static_cast<size_t>(y) * vertical.stride];
+      for (uint32_t k = 0; k < vertical.count[y]; k++) {
+        const uint32_t row = vertical.first[y] + k;
+        if (row != filtered_row) {
+          filterRow(source.data + row * source.step, horizontal, channels, filtered.data());
+          filtered_row = row;
+        }
+        const uint32_t weight = weights[k];
+        for (size_t i = 0; i < row_values; i++) {
+          accumulated[i] += filtered[i] * weight;
+        }
+      }
+      uint8_t * target_row = &target[y * row_values];
+      for (size_t i = 0; i < row_values; i++) {
+        target_row[i] = static_cast<uint8_t>((accumulated[i] + (1u << (2 * WEIGHT_BITS - 1))) >> (2 * WEIGHT_BITS));
+      }
+    }
+  }
+
+  ImagePool::ImagePool(size_t max_free)
+    : max_free_(max_free)
+  {
+  }
+
+  std::shared_ptr<QImage> ImagePool::acquire()
+  {
+    std::unique_ptr<QImage> image;
+    {
+      std::scoped_lock lock(mutex_);
+      if (!free_.empty()) {
+        image = std::move(free_.back());
+        free_.pop_back();
+      }
+    }
+    if (!image) {
+      image = std::make_unique<QImage>();
+    }
+    // images released after the pool are deleted
+    std::weak_ptr<ImagePool> pool = weak_from_this();
+    return std::shared_ptr<QImage>(image.release(), [pool](QImage * released) {
+      if (auto locked = pool.lock()) {
+        locked->release(released);
+      } else {
+        delete released;
+      }
+    });
+  }
+
+  void ImagePool::release(QImage * image)
+  {
+    std::unique_ptr<QImage> owned(image);
+    std::scoped_lock lock(mutex_);
+    if (free_.size() < max_free_) {
+      free_.push_back(std::move(owned));
+    }
+  }
+}  // namespace rviz_2d_overlay_plugins
@@ -0,0 +1,91 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#include "latest_task_worker.hpp"
+
+#include <utility>
+
+namespace rviz_2d_overlay_plugins
+{
+  LatestTaskWorker::LatestTaskWorker()
+    : thread_(&LatestTaskWorker::run, this)
+  {
+  }
+
+  LatestTaskWorker::~LatestTaskWorker()
+  {
+    {
+      std::scoped_lock lock(mutex_);
+      stop_ = true;
+      pending_ = nullptr;
+    }
+    condition_.notify_one();
+    thread_.join();
+  }
+
+  void LatestTaskWorker::submit(std::function<void()> task)
+  {
+    {
+      std::scoped_lock lock(mutex_);
+      if (pending_) {
+        dropped_++;
+      }
+      pending_ = std::move(task);
+    }
+    condition_.notify_one();
+  }
+
+  uint64_t LatestTaskWorker::dropped() const
+  {
+    std::scoped_lock lock(mutex_);
+    return dropped_;
+  }
+
+  void LatestTaskWorker::run()
+  {
+    std::unique_lock lock(mutex_);
+    while (true) {
+      condition_.wait(lock, [this]() {return stop_ || pending_;});
+      if (stop_) {
+        return;
+      }
+      std::function<void()> task = std::move(pending_);
+      pending_ = nullptr;
+      lock.unlock();
+      task();
+      lock.lock();
+    }
+  }
+}  // namespace rviz_2d_overlay_plugins
@@ -0,0 +1,533 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "log_console_display.hpp"
+
+#include <cstring>
+
+#include <OgreHardwarePixelBuffer.h>
+#include <QFontMetrics>
+#include <QPainter>
+#include <rviz_common/logging.hpp>
+#include <rviz_common/uniform_string_stream.hpp>
+#include <rviz_rendering/render_system.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+  namespace
+  {
+    // severity levels of rcl_interfaces/msg/Log
+    constexpr uint8_t LOG_DEBUG = 10;
+    constexpr uint8_t LOG_INFO = 20;
+    constexpr uint8_t LOG_WARN = 30;
+    constexpr uint8_t LOG_ERROR = 40;
+    constexpr uint8_t LOG_FATAL = 50;
+
+    constexpr int LINE_MARGIN = 4;
+  }  // namespace
+
+  LogConsoleDisplay::LogConsoleDisplay()
+    : ring_(20), ring_begin_(0), ring_size_(0), line_count_(20), width_(640), line_height_(1), left_(128), top_(128),
+      min_level_(LOG_DEBUG), show_name_(true), relayout_required_(true), redraw_required_(true),
+      reported_deadline_misses_(0)
+  {
+    topic_message_type_property_ = std::make_unique<rviz_common::properties::StringProperty>(
+      "Topic Message Type", "rcl_interfaces/msg/Log",
+      "Topic message type to subscribe to, rcl_interfaces/msg/Log or std_msgs/msg/String",
+      this, SLOT(updateTopicMessageType()));
+    line_count_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "lines", 20,
+      "number of lines shown",
+      this, SLOT(updateLineCount()));
+    line_count_property_->setMin(1);
+    line_count_property_->setMax(500);
+    width_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "width", 640,
+      "width of the console, longer lines are cut off",
+      this, SLOT(updateWidth()));
+    width_property_->setMin(16);
+    left_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "left", 128,
+      "left of the console",
+      this, SLOT(updateLeft()));
+    left_property_->setMin(0);
+    top_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "top", 128,
+      "top of the console",
+      this, SLOT(updateTop()));
+    top_property_->setMin(0);
+    text_size_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "text size", 10,
+      "text size",
+      this, SLOT(updateFont()));
+    text_size_property_->setMin(1);
+    // the font families are only added when the property is expanded the first time
+    FontCatalog::instance();
+    font_property_ = std::make_unique<rviz_common::properties::EnumProperty>(
+      "font", "DejaVu Sans Mono",
+      "font",
+      this, SLOT(updateFont()));
+    font_property_->addOption("DejaVu Sans Mono", 0);
+    connect(font_property_.get(), SIGNAL(requestOptions(EnumProperty*)), this, SLOT(fillFontOptions()));
+    min_level_property_ = std::make_unique<rviz_common::properties::EnumProperty>(
+      "min level", "DEBUG",
+      "log messages below this severity are not shown",
+      this, SLOT(updateMinLevel()));
+    min_level_property_->addOption("DEBUG", LOG_DEBUG);
+    min_level_property_->addOption("INFO", LOG_INFO);
+    min_level_property_->addOption("WARN", LOG_WARN);
+    min_level_property_->addOption("ERROR", LOG_ERROR);
+    min_level_property_->addOption("FATAL", LOG_FATAL);
+    show_name_property_ = std::make_unique<rviz_common::properties::BoolProperty>(
+      "show logger name", true,
+      "prefix log messages with the name of the logger",
+      this, SLOT(updateShowName()));
+    fg_color_property_ = std::make_unique<rviz_common::properties::ColorProperty>(
+      "foreground color", QColor(25, 255, 240),
+      "color of strings and info messages, other severities have fixed colors",
+      this, SLOT(updateFGColor()));
+    bg_color_property_ = std::make_unique<rviz_common::properties::ColorProperty>(
+      "background color", QColor(0, 0, 0),
+      "background color",
+      this, SLOT(updateBGColor()));
+    bg_alpha_property_ = std::make_unique<rviz_common::properties::FloatProperty>(
+      "backround alpha", 0.5,
+      "alpha belnding value for background",
+      this, SLOT(updateBGColor()));
+    bg_alpha_property_->setMin(0.0);
+    bg_alpha_property_->setMax(1.0);
+    draw_priority_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "draw priority", 0,
+      "overlays with higher priority are drawn first if not all overlays can be drawn within a frame",
+      this, SLOT(updateDrawPriority()));
+  }
+
+  LogConsoleDisplay::~LogConsoleDisplay()
+  {
+    scheduled_draw_.reset();
+    onDisable();
+  }
+
+  void LogConsoleDisplay::onInitialize()
+  {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": initialize");
+    RTDClass::onInitialize();
+    rviz_rendering::RenderSystem::get()->prepareOverlays(scene_manager_);
+    static int count = 0;
+    rviz_common::UniformStringStream ss;
+    ss << "LogConsoleDisplayObject" << count++;
+    overlay_ = std::make_shared<OverlayObject>(ss.str());
+    scheduled_draw_ = ScheduledDraw::create([this]() {drawOverlay();});
+    overlay_->setTextureLostCallback([this]() {
+      std::scoped_lock lock(mutex_);
+      releaseCaches();
+    });
+    onEnable();
+    updateTopicMessageType();
+    updateLineCount();
+    updateWidth();
+    updateLeft();
+    updateTop();
+    updateFont();
+    updateMinLevel();
+    updateShowName();
+    updateFGColor();
+    updateBGColor();
+    updateDrawPriority();
+  }
+
+  void LogConsoleDisplay::load(const rviz_common::Config & config)
+  {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": load config");
+    RTDClass::load(config);
+  }
+
+  void LogConsoleDisplay::updateTopic()
+  {
+    property_batch_.run("topic", [this]() {RTDClass::updateTopic();});
+  }
+
+  void LogConsoleDisplay::onEnable()
+  {
+    redraw_required_ = true;
+    subscribe();
+    if (overlay_) {
+      overlay_->show();
+    }
+  }
+
+  void LogConsoleDisplay::onDisable()
+  {
+    unsubscribe();
+    if (overlay_) {
+      overlay_->hide();
+      overlay_->releaseTexture();
+    }
+    std::scoped_lock lock(mutex_);
+    releaseCaches();
+  }
+
+  void LogConsoleDisplay::releaseCaches()
+  {
+    // composeAll() creates the texture again for a console of a different size
+    console_ = QImage();
+    for (auto & line : ring_) {
+      line.image = QImage();
+    }
+    relayout_required_ = true;
+    redraw_required_ = true;
+  }
+
+  void LogConsoleDisplay::reset()
+  {
+    RTDClass::reset();
+    std::scoped_lock lock(mutex_);
+    ring_begin_ = 0;
+    ring_size_ = 0;
+    pending_lines_.clear();
+    redraw_required_ = true;
+  }
+
+  void LogConsoleDisplay::processMessage(ros_babel_fish::CompoundMessage::ConstSharedPtr msg)
+  {
+    using namespace ros_babel_fish;
+
+    std::scoped_lock lock(mutex_);
+
+    if (!isEnabled()) {
+      return;
+    }
+
+    try {
+      if (msg->containsKey("msg") && msg->containsKey("level")) {
+        const uint8_t level = (*msg)["level"].value<uint8_t>();
+        if (level < min_level_) {
+          return;
+        }
+        QString text = QString::fromStdString((*msg)["msg"].value<std::string>());
+        if (show_name_ && msg->containsKey("name")) {
+          text.prepend("[" + QString::fromStdString((*msg)["name"].value<std::string>()) + "] ");
+        }
+        appendLines(text, level);
+      } else if (msg->containsKey("data") && (*msg)["data"].type() == MessageTypes::String) {
+        appendLines(QString::fromStdString((*msg)["data"].value<std::string>()), 0);
+      } else {
+        setStatus(
+          rviz_common::properties::StatusProperty::Error,
+          "Topic",
+          QString("Error parsing: Expected a string data field or msg and level fields"));
+      }
+    } catch (BabelFishException & e) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Error,
+        "Topic",
+        QString::fromStdString(std::string{"Error parsing: "} + e.what()));
+    }
+  }
+
+  void LogConsoleDisplay::appendLines(const QString & text, uint8_t level)
+  {
+    for (const auto & line : text.split('\n')) {
+      pending_lines_.push_back(Line{line, level, QImage()});
+    }
+    // lines that would scroll out before they are drawn are dropped right away
+    while (pending_lines_.size() > line_count_) {
+      pending_lines_.pop_front();
+    }
+  }
+
+  QColor LogConsoleDisplay::levelColor(uint8_t level) const
+  {
+    if (level >= LOG_FATAL) {
+      return QColor(255, 0, 255);
+    } else if (level >= LOG_ERROR) {
+      return QColor(255, 60, 60);
+    } else if (level >= LOG_WARN) {
+      return QColor(255, 200, 0);
+    } else if (level >= LOG_INFO || level == 0) {
+      return fg_color_;
+    }
+    return QColor(150, 150, 150);
+  }
+
+  void LogConsoleDisplay::rasterizeLine(Line & line)
+  {
+    const QFontMetrics & metrics = font_->metrics;
+    const QString text = metrics.elidedText(line.text, Qt::ElideRight, width_ - 2 * LINE_MARGIN);
+    // only as wide as the text, the background is part of the console image
+    line.image = QImage(std::max(1, metrics.horizontalAdvance(text) + LINE_MARGIN), line_height_,
+                        QImage::Format_ARGB32_Premultiplied);
+    line.image.fill(Qt::transparent);
+    QPainter painter(&line.image);
+    painter.setRenderHint(QPainter::TextAntialiasing, true);
+    painter.setFont(font_->font);
+    painter.setPen(levelColor(line.level));
+    painter.drawText(QRect(LINE_MARGIN, 0, line.image.width() - LINE_MARGIN, line_height_),
+                     Qt::AlignLeft | Qt::AlignVCenter, text);
+    painter.end();
+  }
+
+  const LogConsoleDisplay::Line & LogConsoleDisplay::lineAt(size_t index) const
+  {
+    return ring_[(ring_begin_ + index) % ring_.size()];
+  }
+
+  void LogConsoleDisplay::update(float /*wall_dt*/, float /*ros_dt*/)
+  {
+    reportDeadlineMisses(*this, *scheduled_draw_, reported_deadline_misses_);
+    reportTextureUsage(*this, *overlay_, reported_texture_usage_);
+    std::scoped_lock lock(mutex_);
+    // off screen lines only queue up, bounded by the line count, and are rendered once visible again
+    if ((relayout_required_ || redraw_required_ || !pending_lines_.empty()) && overlay_->isOnScreen()) {
+      scheduled_draw_->requestDraw();
+    }
+  }
+
+  void LogConsoleDisplay::drawOverlay()
+  {
+    std::scoped_lock lock(mutex_);
+
+    if (!overlay_ || !overlay_->isVisible()) {
+      return;
+    }
+
+    if (relayout_required_) {
+      for (size_t i = 0; i < ring_size_; i++) {
+        rasterizeLine(ring_[(ring_begin_ + i) % ring_.size()]);
+      }
+      relayout_required_ = false;
+      redraw_required_ = true;
+    }
+
+    const size_t new_lines = pending_lines_.size();
+    const size_t previous_size = ring_size_;
+    for (auto & line : pending_lines_) {
+      rasterizeLine(line);
+      if (ring_size_ < ring_.size()) {
+        ring_[(ring_begin_ + ring_size_) % ring_.size()] = std::move(line);
+        ring_size_++;
+      } else {
+        ring_[ring_begin_] = std::move(line);
+        ring_begin_ = (ring_begin_ + 1) % ring_.size();
+      }
+    }
+    pending_lines_.clear();
+
+    if (redraw_required_ || new_lines >= ring_.size()) {
+      composeAll();
+      uploadConsole(0, console_.height());
+      redraw_required_ = false;
+    } else if (new_lines > 0) {
+      scrollAndCompose(previous_size, new_lines);
+      // without scrolling only the rows of the new lines changed
+      const bool scrolled = previous_size + new_lines > ring_.size();
+      uploadConsole(scrolled ? 0 : previous_size * line_height_, ring_size_ * line_height_);
+    }
+  }
+
+  void LogConsoleDisplay::composeAll()
+  {
+    const int height = line_count_ * line_height_;
+    if (console_.width() != width_ || console_.height() != height) {
+      console_ = QImage(width_, height, QImage::Format_ARGB32);
+      overlay_->updateTextureSize(width_, height);
+      overlay_->setPosition(left_, top_);
+      overlay_->setDimensions(overlay_->getTextureWidth(), overlay_->getTextureHeight());
+    }
+    console_.fill(bg_color_);
+    QPainter painter(&console_);
+    for (size_t i = 0; i < ring_size_; i++) {
+      painter.drawImage(0, i * line_height_, lineAt(i).image);
+    }
+    painter.end();
+  }
+
+  void LogConsoleDisplay::scrollAndCompose(size_t previous_size, size_t count)
+  {
+    // lines of the previous update that were pushed out at the top
+    const size_t scrolled = previous_size + count > ring_.size() ? previous_size + count - ring_.size() : 0;
+    if (scrolled > 0) {
+      const size_t offset = scrolled * line_height_ * console_.bytesPerLine();
+      std::memmove(console_.bits(), console_.bits() + offset, console_.sizeInBytes() - offset);
+    }
+
+    QPainter painter(&console_);
+    painter.setCompositionMode(QPainter::CompositionMode_Source);
+    painter.fillRect(0, (ring_size_ - count) * line_height_, width_, count * line_height_, bg_color_);
+    painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    for (size_t i = ring_size_ - count; i < ring_size_; i++) {
+      painter.drawImage(0, i * line_height_, lineAt(i).image);
+    }
+    painter.end();
+  }
+
+  void LogConsoleDisplay::uploadConsole(int first_row, int end_row)
+  {
+    end_row = std::min(end_row, console_.height());
+    if (first_row >= end_row) {
+      return;
+    }
+    rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer(
+      Ogre::Box(0, first_row, console_.width(), end_row));
+    QImage region = buffer.getRegionQImage();
+    for (int y = first_row; y < end_row; y++) {
+      std::memcpy(region.scanLine(y - first_row), console_.constScanLine(y), console_.width() * 4);
+    }
+  }
+
+  void LogConsoleDisplay::updateTopicMessageType()
+  {
+    topic_property_->setMessageType(topic_message_type_property_->getString());
+    updateTopic();
+  }
+
+  void LogConsoleDisplay::updateLineCount()
+  {
+    property_batch_.run("line count", [this]() {
+      std::scoped_lock lock(mutex_);
+      line_count_ = line_count_property_->getInt();
+      // keep the newest lines in a ring of the new size
+      std::vector<Line> ring(line_count_);
+      const size_t kept = std::min(ring_size_, line_count_);
+      for (size_t i = 0; i < kept; i++) {
+        ring[i] = std::move(ring_[(ring_begin_ + ring_size_ - kept + i) % ring_.size()]);
+      }
+      ring_.swap(ring);
+      ring_begin_ = 0;
+      ring_size_ = kept;
+      while (pending_lines_.size() > line_count_) {
+        pending_lines_.pop_front();
+      }
+      redraw_required_ = true;
+    });
+  }
+
+  void LogConsoleDisplay::updateWidth()
+  {
+    std::scoped_lock lock(mutex_);
+    width_ = width_property_->getInt();
+    relayout_required_ = true;
+  }
+
+  void LogConsoleDisplay::updateLeft()
+  {
+    left_ = left_property_->getInt();
+    if (overlay_) {
+      overlay_->setPosition(left_, top_);
+    }
+  }
+
+  void LogConsoleDisplay::updateTop()
+  {
+    top_ = top_property_->getInt();
+    if (overlay_) {
+      overlay_->setPosition(left_, top_);
+    }
+  }
+
+  void LogConsoleDisplay::updateFont()
+  {
+    property_batch_.run("font", [this]() {
+      std::scoped_lock lock(mutex_);
+      font_ = FontCache::instance().get(font_property_->getString(), text_size_property_->getInt());
+      line_height_ = font_->metrics.height();
+      relayout_required_ = true;
+    });
+  }
+
+  void LogConsoleDisplay::fillFontOptions()
+  {
+    // the families only have to be added once
+    disconnect(font_property_.get(), SIGNAL(requestOptions(EnumProperty*)), this, SLOT(fillFontOptions()));
+    FontCatalog::instance().fillOptions(*font_property_);
+  }
+
+  void LogConsoleDisplay::updateMinLevel()
+  {
+    std::scoped_lock lock(mutex_);
+    min_level_ = min_level_property_->getOptionInt();
+  }
+
+  void LogConsoleDisplay::updateShowName()
+  {
+    std::scoped_lock lock(mutex_);
+    show_name_ = show_name_property_->getBool();
+  }
+
+  void LogConsoleDisplay::updateFGColor()
+  {
+    std::scoped_lock lock(mutex_);
+    fg_color_ = fg_color_property_->getColor();
+    relayout_required_ = true;
+  }
+
+  void LogConsoleDisplay::updateBGColor()
+  {
+    std::scoped_lock lock(mutex_);
+    bg_color_ = bg_color_property_->getColor();
+    bg_color_.setAlpha(bg_alpha_property_->getFloat() * 255.0);
+    redraw_required_ = true;
+  }
+
+  void LogConsoleDisplay::updateDrawPriority()
+  {
+    scheduled_draw_->setPriority(draw_priority_property_->getInt());
+    overlay_->setPriority(draw_priority_property_->getInt());
+  }
+
+  bool LogConsoleDisplay::isInRegion(int x, int y)
+  {
+    const int width = overlay_ ? overlay_->getTextureWidth() : 0;
+    const int height = overlay_ ? overlay_->getTextureHeight() : 0;
+    return (top_ < y && top_ + height > y &&
+            left_ < x && left_ + width > x);
+  }
+
+  void LogConsoleDisplay::movePosition(int x, int y)
+  {
+    top_ = y;
+    left_ = x;
+  }
+
+  void LogConsoleDisplay::setPosition(int x, int y)
+  {
+    top_property_->setValue(y);
+    left_property_->setValue(x);
+  }
+}  // namespace rviz_2d_overlay_plugins
+
+#include <pluginlib/class_list_macros.hpp>
+PLUGINLIB_EXPORT_CLASS( rviz_2d_overlay_plugins::LogConsoleDisplay, rviz_common::Display )
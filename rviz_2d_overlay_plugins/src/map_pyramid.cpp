@@ -0,0 +1,269 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#include "map_pyramid.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace rviz_2d_overlay_plugins
+{
+  namespace
+  {
+    // levels are added until both sides fit into this size
+    constexpr uint32_t SMALLEST_LEVEL_SIZE = 32;
+
+    uint32_t bgra(int red, int green, int blue, int alpha)
+    {
+      const uint8_t bytes[4] = {static_cast<uint8_t>(blue), static_cast<uint8_t>(green),
+                                static_cast<uint8_t>(red), static_cast<uint8_t>(alpha)};
+      uint32_t pixel;
+      std::memcpy(&pixel, bytes, sizeof(pixel));
+      return pixel;
+    }
+
+    // average of every byte, rounded down, independent of the byte order
+    inline uint32_t average(uint32_t a, uint32_t b)
+    {
+      return (a & b) + (((a ^ b) & 0xfefefefeu) >> 1);
+    }
+
+    inline uint32_t average(uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+    {
+      return average(average(a, b), average(c, d));
+    }
+
+    uint32_t halve(uint32_t size)
+    {
+      return (size + 1) / 2;
+    }
+  }  // namespace
+
+  OccupancyPalette occupancyPalette(OccupancyColorScheme scheme, double alpha)
+  {
+    const int a = static_cast<int>(std::lround(std::clamp(alpha, 0.0, 1.0) * 255));
+    OccupancyPalette palette;
+    for (int value = 0; value < 256; value++) {
+      uint32_t & pixel = palette[value];
+      if (value == 255) {
+        // unknown
+        pixel = bgra(0x70, 0x89, 0x86, a);
+      } else if (value > 100) {
+        // not a valid occupancy
+        pixel = bgra(value > 127 ? 255 : 0, value > 127 ? (value - 128) * 2 : 255, 0, a);
+      } else if (scheme == OccupancyColorScheme::MAP) {
+        const int gray = 255 - value * 255 / 100;
+        pixel = bgra(gray, gray, gray, a);
+      } else if (value == 0) {
+        pixel = bgra(0, 0, 0, 0);
+      } else if (value == 100) {
+        // lethal
+        pixel = bgra(255, 0, 255, a);
+      } else if (value == 99) {
+        // inscribed
+        pixel = bgra(0, 255, 255, a);
+      } else {
+        const int cost = value * 255 / 98;
+        pixel = bgra(cost, 0, 255 - cost, a);
+      }
+    }
+    return palette;
+  }
+
+  void MapRect::unite(const MapRect & other)
+  {
+    if (other.empty()) {
+      return;
+    }
+    if (empty()) {
+      *this = other;
+      return;
+    }
+    x0 = std::min(x0, other.x0);
+    y0 = std::min(y0, other.y0);
+    x1 = std::max(x1, other.x1);
+    y1 = std::max(y1, other.y1);
+  }
+
+  void MapPyramid::setGrid(const int8_t * data, uint32_t width, uint32_t height)
+  {
+    width_ = width;
+    height_ = height;
+    values_.resize(static_cast<size_t>(width) * height);
+    for (uint32_t y = 0; y < height; y++) {
+      std::memcpy(&values_[static_cast<size_t>(height - 1 - y) * width], data + static_cast<size_t>(y) * width,
+                  width);
+    }
+
+    levels_.clear();
+    uint32_t level_width = width;
+    uint32_t level_height = height;
+    while (level_width > SMALLEST_LEVEL_SIZE || level_height > SMALLEST_LEVEL_SIZE) {
+      level_width = halve(level_width);
+      level_height = halve(level_height);
+      Level level;
+      level.width = level_width;
+      level.height = level_height;
+      level.pixels.resize(static_cast<size_t>(level_width) * level_height);
+      levels_.push_back(std::move(level));
+    }
+    rebuild(MapRect{0, 0, width, height});
+  }
+
+  bool MapPyramid::applyPatch(
+    const int8_t * data, uint32_t x, uint32_t y, uint32_t width, uint32_t height, MapRect & dirty)
+  {
+    if (static_cast<uint64_t>(x) + width > width_ || static_cast<uint64_t>(y) + height > height_) {
+      return false;
+    }
+    for (uint32_t row = 0; row < height; row++) {
+      std::memcpy(&values_[static_cast<size_t>(height_ - 1 - y - row) * width_ + x],
+                  data + static_cast<size_t>(row) * width, width);
+    }
+    const MapRect rect{x, height_ - y - height, x + width, height_ - y};
+    rebuild(rect);
+    dirty.unite(rect);
+    return true;
+  }
+
+  void MapPyramid::setPalette(const OccupancyPalette & palette)
+  {
+    palette_ = palette;
+    rebuild(MapRect{0, 0, width_, height_});
+  }
+
+  void MapPyramid::clear()
+  {
+    width_ = 0;
+    height_ = 0;
+    values_.clear();
+    levels_.clear();
+  }
+
+  bool MapPyramid::empty() const
+  {
+    return values_.empty();
+  }
+
+  size_t MapPyramid::levelCount() const
+  {
+    return empty() ? 0 : levels_.size() + 1;
+  }
+
+  uint32_t MapPyramid::width(size_t level) const
+  {
+    return level == 0 ? width_ : levels_[level - 1].width;
+  }
+
+  uint32_t MapPyramid::height(size_t level) const
+  {
+    return level == 0 ? height_ : levels_[level - 1].height;
+  }
+
+  size_t MapPyramid::levelFor(uint32_t panel_width, uint32_t panel_height) const
+  {
+    size_t level = 0;
+    while (level < levels_.size() && levels_[level].width >= panel_width && levels_[level].height >= panel_height) {
+      level++;
+    }
+    return level;
+  }
+
+  MapRect MapPyramid::levelRect(const MapRect & rect, size_t level)
+  {
+    // repeated halving with rounding up equals a single division rounding up
+    const uint32_t scale = 1u << level;
+    return MapRect{rect.x0 >> level, rect.y0 >> level, (rect.x1 + scale - 1) >> level, (rect.y1 + scale - 1) >> level};
+  }
+
+  void MapPyramid::rebuild(const MapRect & rect)
+  {
+    if (levels_.empty() || rect.empty()) {
+      return;
+    }
+    // level 1 is colored and reduced from the values in one pass
+    {
+      Level & level = levels_[0];
+      const MapRect target = levelRect(rect, 1);
+      for (uint32_t y = target.y0; y < target.y1; y++) {
+        const uint8_t * row0 = &values_[static_cast<size_t>(2 * y) * width_];
+        const uint8_t * row1 = &values_[static_cast<size_t>(std::min(2 * y + 1, height_ - 1)) * width_];
+        uint32_t * out = &level.pixels[static_cast<size_t>(y) * level.width];
+        for (uint32_t x = target.x0; x < target.x1; x++) {
+          const uint32_t x0 = 2 * x;
+          const uint32_t x1 = std::min(x0 + 1, width_ - 1);
+          out[x] = average(palette_[row0[x0]], palette_[row0[x1]], palette_[row1[x0]], palette_[row1[x1]]);
+        }
+      }
+    }
+    for (size_t index = 1; index < levels_.size(); index++) {
+      const Level & below = levels_[index - 1];
+      Level & level = levels_[index];
+      const MapRect target = levelRect(rect, index + 1);
+      for (uint32_t y = target.y0; y < target.y1; y++) {
+        const uint32_t * row0 = &below.pixels[static_cast<size_t>(2 * y) * below.width];
+        const uint32_t * row1 = &below.pixels[static_cast<size_t>(std::min(2 * y + 1, below.height - 1)) * below.width];
+        uint32_t * out = &level.pixels[static_cast<size_t>(y) * level.width];
+        for (uint32_t x = target.x0; x < target.x1; x++) {
+          const uint32_t x0 = 2 * x;
+          const uint32_t x1 = std::min(x0 + 1, below.width - 1);
+          out[x] = average(row0[x0], row0[x1], row1[x0], row1[x1]);
+        }
+      }
+    }
+  }
+
+  void MapPyramid::copyToPixelBox(size_t level, const MapRect & rect, const Ogre::PixelBox & box) const
+  {
+    const size_t box_step = box.rowPitch * Ogre::PixelUtil::getNumElemBytes(box.format);
+    uint8_t * target = static_cast<uint8_t *>(box.data);
+    const uint32_t width = rect.x1 - rect.x0;
+    for (uint32_t y = rect.y0; y < rect.y1; y++) {
+      uint8_t * out = target + (y - rect.y0) * box_step;
+      if (level == 0) {
+        // palette lookup kernel
+        const uint8_t * values = &values_[static_cast<size_t>(y) * width_ + rect.x0];
+        uint32_t * pixels = reinterpret_cast<uint32_t *>(out);
+        for (uint32_t x = 0; x < width; x++) {
+          pixels[x] = palette_[values[x]];
+        }
+      } else {
+        const Level & source = levels_[level - 1];
+        std::memcpy(out, &source.pixels[static_cast<size_t>(y) * source.width + rect.x0], width * sizeof(uint32_t));
+      }
+    }
+  }
+}  // namespace rviz_2d_overlay_plugins
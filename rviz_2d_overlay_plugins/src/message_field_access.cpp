@@ -0,0 +1,316 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "message_field_access.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <sstream>
+
+#include <builtin_interfaces/msg/duration.hpp>
+#include <builtin_interfaces/msg/time.hpp>
+#include <rosidl_typesupport_introspection_cpp/field_types.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+  namespace
+  {
+    using rosidl_typesupport_introspection_cpp::MessageMember;
+    using rosidl_typesupport_introspection_cpp::MessageMembers;
+
+    std::shared_ptr<const ros_babel_fish::MessageTypeSupport> messageTypeSupport(const std::string & message_type)
+    {
+      // one fish for all accessors, the type supports it loads stay cached
+      static std::mutex mutex;
+      static ros_babel_fish::BabelFish fish;
+
+      std::string name = message_type;
+      for (size_t pos = name.find("::"); pos != std::string::npos; pos = name.find("::", pos + 1)) {
+        name.replace(pos, 2, "/");
+      }
+      std::scoped_lock lock(mutex);
+      auto type_support = fish.get_message_type_support(name);
+      if (!type_support) {
+        throw ros_babel_fish::BabelFishException("No type support found for '" + message_type + "'");
+      }
+      return type_support;
+    }
+
+    const MessageMembers & nestedMembers(const MessageMember & member)
+    {
+      return *static_cast<const MessageMembers *>(member.members_->data);
+    }
+
+    bool isNumeric(uint8_t type_id)
+    {
+      namespace types = rosidl_typesupport_introspection_cpp;
+      return type_id != types::ROS_TYPE_STRING && type_id != types::ROS_TYPE_WSTRING &&
+             type_id != types::ROS_TYPE_MESSAGE;
+    }
+
+    double numberValue(const void * data, uint8_t type_id)
+    {
+      namespace types = rosidl_typesupport_introspection_cpp;
+
+      switch (type_id) {
+        case types::ROS_TYPE_FLOAT:
+          return *static_cast<const float *>(data);
+        case types::ROS_TYPE_DOUBLE:
+          return *static_cast<const double *>(data);
+        case types::ROS_TYPE_LONG_DOUBLE:
+          return static_cast<double>(*static_cast<const long double *>(data));
+        case types::ROS_TYPE_BOOLEAN:
+          return *static_cast<const bool *>(data);
+        case types::ROS_TYPE_CHAR:
+        case types::ROS_TYPE_OCTET:
+        case types::ROS_TYPE_UINT8:
+          return *static_cast<const uint8_t *>(data);
+        case types::ROS_TYPE_INT8:
+          return *static_cast<const int8_t *>(data);
+        case types::ROS_TYPE_UINT16:
+          return *static_cast<const uint16_t *>(data);
+        case types::ROS_TYPE_INT16:
+          return *static_cast<const int16_t *>(data);
+        case types::ROS_TYPE_UINT32:
+          return *static_cast<const uint32_t *>(data);
+        case types::ROS_TYPE_INT32:
+          return *static_cast<const int32_t *>(data);
+        case types::ROS_TYPE_UINT64:
+          return static_cast<double>(*static_cast<const uint64_t *>(data));
+        case types::ROS_TYPE_INT64:
+          return static_cast<double>(*static_cast<const int64_t *>(data));
+        default:
+          return 0.0;
+      }
+    }
+
+    size_t elementSize(uint8_t type_id)
+    {
+      namespace types = rosidl_typesupport_introspection_cpp;
+
+      switch (type_id) {
+        case types::ROS_TYPE_FLOAT:
+          return sizeof(float);
+        case types::ROS_TYPE_DOUBLE:
+          return sizeof(double);
+        case types::ROS_TYPE_LONG_DOUBLE:
+          return sizeof(long double);
+        case types::ROS_TYPE_UINT16:
+        case types::ROS_TYPE_INT16:
+          return sizeof(uint16_t);
+        case types::ROS_TYPE_UINT32:
+        case types::ROS_TYPE_INT32:
+          return sizeof(uint32_t);
+        case types::ROS_TYPE_UINT64:
+        case types::ROS_TYPE_INT64:
+          return sizeof(uint64_t);
+        default:
+          return sizeof(uint8_t);
+      }
+    }
+  }  // namespace
+
+  std::vector<std::string> splitFieldPath(const std::string & field_path)
+  {
+    std::stringstream ss(field_path);
+    std::string sub_field;
+    std::vector<std::string> field_names;
+    while (std::getline(ss, sub_field, '.')) {
+      field_names.push_back(sub_field);
+    }
+    return field_names;
+  }
+
+  FieldAccessor::FieldAccessor(const std::string & field_path)
+  : path_(field_path), field_names_(splitFieldPath(field_path))
+  {
+  }
+
+  void FieldAccessor::resolve(const std::string & message_type)
+  {
+    using ros_babel_fish::BabelFishException;
+    namespace types = rosidl_typesupport_introspection_cpp;
+
+    if (message_type == message_type_) {
+      return;
+    }
+    message_type_.clear();
+    if (field_names_.empty()) {
+      throw BabelFishException("Empty field path");
+    }
+    auto type_support = messageTypeSupport(message_type);
+
+    const MessageMembers * members =
+      static_cast<const MessageMembers *>(type_support->introspection_type_support_handle.data);
+    const MessageMember * member = nullptr;
+    size_t offset = 0;
+    for (const auto & field_name : field_names_) {
+      if (member) {
+        if (member->type_id_ != types::ROS_TYPE_MESSAGE || member->is_array_) {
+          throw BabelFishException("Field '" + field_name + "' not found, parent is not a compound message");
+        }
+        members = &nestedMembers(*member);
+      }
+      member = nullptr;
+      for (uint32_t i = 0; i < members->member_count_; i++) {
+        if (field_name == members->members_[i].name_) {
+          member = &members->members_[i];
+          break;
+        }
+      }
+      if (!member) {
+        throw BabelFishException("Field '" + field_name + "' not found in message");
+      }
+      offset += member->offset_;
+    }
+
+    Kind kind = Kind::Number;
+    if (member->is_array_) {
+      if (!isNumeric(member->type_id_)) {
+        throw BabelFishException("Array field '" + path_ + "' found, but its elements are not numeric");
+      }
+      kind = Kind::Array;
+    } else if (member->type_id_ == types::ROS_TYPE_STRING) {
+      kind = Kind::String;
+    } else if (member->type_id_ == types::ROS_TYPE_BOOLEAN) {
+      kind = Kind::Bool;
+    } else if (member->type_id_ == types::ROS_TYPE_MESSAGE) {
+      const MessageMembers & nested = nestedMembers(*member);
+      const bool builtin = std::strcmp(nested.message_namespace_, "builtin_interfaces::msg") == 0;
+      if (builtin && std::strcmp(nested.message_name_, "Time") == 0) {
+        kind = Kind::Time;
+      } else if (builtin && std::strcmp(nested.message_name_, "Duration") == 0) {
+        kind = Kind::Duration;
+      } else {
+        throw BabelFishException(
+          "Field '" + path_ + "' found, but not convertable to floating point representation");
+      }
+    } else if (!isNumeric(member->type_id_)) {
+      throw BabelFishException("Field '" + path_ + "' found, but not convertable to floating point representation");
+    }
+
+    type_support_ = std::move(type_support);
+    member_ = member;
+    offset_ = offset;
+    kind_ = kind;
+    message_type_ = message_type;
+  }
+
+  const std::string & FieldAccessor::path() const
+  {
+    return path_;
+  }
+
+  const std::string & FieldAccessor::messageType() const
+  {
+    return message_type_;
+  }
+
+  FieldAccessor::Kind FieldAccessor::kind() const
+  {
+    return kind_;
+  }
+
+  const void * FieldAccessor::field(const ros_babel_fish::CompoundMessage & msg) const
+  {
+    if (message_type_.empty()) {
+      throw ros_babel_fish::BabelFishException("Field '" + path_ + "' is not resolved");
+    }
+    // the babel fish message wraps the C++ message of its type
+    return static_cast<const uint8_t *>(msg.type_erased_message().get()) + offset_;
+  }
+
+  const std::string & FieldAccessor::stringValue(const ros_babel_fish::CompoundMessage & msg) const
+  {
+    const void * data = field(msg);
+    if (kind_ != Kind::String) {
+      throw ros_babel_fish::BabelFishException("Field '" + path_ + "' found, but it is not a string");
+    }
+    return *static_cast<const std::string *>(data);
+  }
+
+  double FieldAccessor::value(const ros_babel_fish::CompoundMessage & msg) const
+  {
+    const void * data = field(msg);
+    switch (kind_) {
+      case Kind::Number:
+      case Kind::Bool:
+        return numberValue(data, member_->type_id_);
+      case Kind::Time:
+      {
+        const auto & time = *static_cast<const builtin_interfaces::msg::Time *>(data);
+        return time.sec + time.nanosec * 1e-9;
+      }
+      case Kind::Duration:
+      {
+        const auto & duration = *static_cast<const builtin_interfaces::msg::Duration *>(data);
+        return duration.sec + duration.nanosec * 1e-9;
+      }
+      default:
+        throw ros_babel_fish::BabelFishException(
+          "Field '" + path_ + "' found, but not convertable to floating point representation");
+    }
+  }
+
+  void FieldAccessor::appendValues(const ros_babel_fish::CompoundMessage & msg, std::vector<double> & values) const
+  {
+    if (kind_ != Kind::Array) {
+      values.push_back(value(msg));
+      return;
+    }
+
+    const void * data = field(msg);
+    const size_t size = member_->size_function(data);
+    if (size == 0) {
+      return;
+    }
+    if (member_->type_id_ == rosidl_typesupport_introspection_cpp::ROS_TYPE_BOOLEAN) {
+      // std::vector<bool> does not store its elements as bools
+      for (size_t i = 0; i < size; i++) {
+        bool element;
+        member_->fetch_function(data, i, &element);
+        values.push_back(element);
+      }
+      return;
+    }
+    // fixed, bounded and unbounded arrays of numbers store their elements contiguously
+    const auto * elements = static_cast<const uint8_t *>(member_->get_const_function(data, 0));
+    const size_t element_size = elementSize(member_->type_id_);
+    for (size_t i = 0; i < size; i++) {
+      values.push_back(numberValue(elements + i * element_size, member_->type_id_));
+    }
+  }
+}  // namespace rviz_2d_overlay_plugins
@@ -0,0 +1,464 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#include "minimap_display.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include <OgreHardwarePixelBuffer.h>
+#include <QPainter>
+#include <rviz_common/frame_manager_iface.hpp>
+#include <rviz_common/uniform_string_stream.hpp>
+#include <rviz_rendering/render_system.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+  namespace
+  {
+    // side of the marker texture and panel
+    constexpr int MARKER_SIZE = 24;
+  }  // namespace
+
+  MinimapDisplay::MinimapDisplay()
+    : resolution_(0.0), origin_position_(Ogre::Vector3::ZERO), origin_orientation_(Ogre::Quaternion::IDENTITY),
+      upload_required_(false), level_(0), width_(0), left_(0), top_(0), show_robot_(true), marker_heading_(0),
+      marker_required_(false), reported_deadline_misses_(0)
+  {
+    color_scheme_property_ = std::make_unique<rviz_common::properties::EnumProperty>(
+      "color scheme", "map",
+      "colors of the occupancy values",
+      this, SLOT(updatePalette()));
+    color_scheme_property_->addOption("map", static_cast<int>(OccupancyColorScheme::MAP));
+    color_scheme_property_->addOption("costmap", static_cast<int>(OccupancyColorScheme::COSTMAP));
+    alpha_property_ = std::make_unique<rviz_common::properties::FloatProperty>(
+      "alpha", 0.7,
+      "alpha value of the map",
+      this, SLOT(updatePalette()));
+    alpha_property_->setMin(0.0);
+    alpha_property_->setMax(1.0);
+    width_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "width", 256,
+      "width of the minimap, the height follows the aspect ratio of the map",
+      this, SLOT(updateWidth()));
+    width_property_->setMin(16);
+    left_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "left", 128,
+      "left of the minimap",
+      this, SLOT(updateLeft()));
+    left_property_->setMin(0);
+    top_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "top", 128,
+      "top of the minimap",
+      this, SLOT(updateTop()));
+    top_property_->setMin(0);
+    show_robot_property_ = std::make_unique<rviz_common::properties::BoolProperty>(
+      "show robot", true,
+      "show a marker at the pose of the robot frame",
+      this, SLOT(updateShowRobot()));
+    robot_frame_property_ = std::make_unique<rviz_common::properties::TfFrameProperty>(
+      "robot frame", "base_link",
+      "frame of the robot marker",
+      show_robot_property_.get(), nullptr, false);
+    robot_color_property_ = std::make_unique<rviz_common::properties::ColorProperty>(
+      "robot color", QColor(25, 255, 240),
+      "color of the robot marker",
+      show_robot_property_.get(), SLOT(updateRobotColor()), this);
+    draw_priority_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "draw priority", 0,
+      "overlays with higher priority are drawn first if not all overlays can be drawn within a frame",
+      this, SLOT(updateDrawPriority()));
+  }
+
+  MinimapDisplay::~MinimapDisplay()
+  {
+    scheduled_draw_.reset();
+    onDisable();
+  }
+
+  void MinimapDisplay::onInitialize()
+  {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": initialize");
+    RTDClass::onInitialize();
+    rviz_rendering::RenderSystem::get()->prepareOverlays(scene_manager_);
+    static int count = 0;
+    rviz_common::UniformStringStream ss;
+    ss << "MinimapDisplayObject" << count++;
+    overlay_ = std::make_shared<OverlayObject>(ss.str());
+    marker_ = std::make_shared<OverlayObject>(ss.str() + "Marker");
+    // the default z-order of overlays is 100
+    marker_->setZOrder(101);
+    scheduled_draw_ = ScheduledDraw::create([this]() {drawOverlay();});
+    overlay_->setTextureLostCallback([this]() {
+      std::scoped_lock lock(mutex_);
+      upload_required_ = !pyramid_.empty();
+    });
+    marker_->setTextureLostCallback([this]() {
+      std::scoped_lock lock(mutex_);
+      marker_required_ = true;
+    });
+    robot_frame_property_->setFrameManager(context_->getFrameManager());
+    onEnable();
+    updatePalette();
+    updateWidth();
+    updateLeft();
+    updateTop();
+    updateShowRobot();
+    updateRobotColor();
+    updateDrawPriority();
+  }
+
+  void MinimapDisplay::load(const rviz_common::Config & config)
+  {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": load config");
+    RTDClass::load(config);
+  }
+
+  void MinimapDisplay::updateTopic()
+  {
+    property_batch_.run("topic", [this]() {RTDClass::updateTopic();});
+  }
+
+  void MinimapDisplay::subscribe()
+  {
+    RTDClass::subscribe();
+    if (!isEnabled() || topic_property_->isEmpty()) {
+      return;
+    }
+    try {
+      update_subscription_ =
+        rviz_ros_node_.lock()->get_raw_node()->create_subscription<map_msgs::msg::OccupancyGridUpdate>(
+        topic_property_->getTopicStd() + "_updates", rclcpp::QoS(10),
+        [this](map_msgs::msg::OccupancyGridUpdate::ConstSharedPtr update) {processUpdate(update);});
+      deleteStatus("Update Topic");
+    } catch (const rclcpp::exceptions::InvalidTopicNameError & e) {
+      setStatus(rviz_common::properties::StatusProperty::Error, "Update Topic",
+                QString("Error subscribing: ") + e.what());
+    }
+  }
+
+  void MinimapDisplay::unsubscribe()
+  {
+    RTDClass::unsubscribe();
+    update_subscription_.reset();
+  }
+
+  void MinimapDisplay::onEnable()
+  {
+    subscribe();
+    if (overlay_) {
+      overlay_->show();
+    }
+    std::scoped_lock lock(mutex_);
+    // latched maps are not sent again, the map is kept while disabled
+    upload_required_ = !pyramid_.empty();
+    marker_required_ = true;
+  }
+
+  void MinimapDisplay::onDisable()
+  {
+    unsubscribe();
+    if (overlay_) {
+      overlay_->hide();
+      overlay_->releaseTexture();
+    }
+    if (marker_) {
+      marker_->hide();
+      marker_->releaseTexture();
+    }
+  }
+
+  void MinimapDisplay::reset()
+  {
+    RTDClass::reset();
+    {
+      std::scoped_lock lock(mutex_);
+      pyramid_.clear();
+      dirty_ = MapRect();
+      upload_required_ = false;
+      overlay_->releaseTexture();
+      marker_->hide();
+    }
+    // a latched map is not sent again by itself, like the map display resubscribe to receive it. updateTopic()
+    // would reset the display again
+    unsubscribe();
+    subscribe();
+  }
+
+  void MinimapDisplay::processMessage(nav_msgs::msg::OccupancyGrid::ConstSharedPtr msg)
+  {
+    if (msg->info.width == 0 || msg->info.height == 0 ||
+        msg->data.size() != static_cast<size_t>(msg->info.width) * msg->info.height)
+    {
+      setStatus(rviz_common::properties::StatusProperty::Error, "Map",
+                QString("Data size %1 does not match the size %2 x %3")
+                .arg(msg->data.size()).arg(msg->info.width).arg(msg->info.height));
+      return;
+    }
+    deleteStatus("Map");
+
+    std::scoped_lock lock(mutex_);
+    pyramid_.setGrid(msg->data.data(), msg->info.width, msg->info.height);
+    map_frame_ = msg->header.frame_id;
+    resolution_ = msg->info.resolution;
+    const auto & origin = msg->info.origin;
+    origin_position_ = Ogre::Vector3(origin.position.x, origin.position.y, origin.position.z);
+    origin_orientation_ = Ogre::Quaternion(
+      origin.orientation.w, origin.orientation.x, origin.orientation.y, origin.orientation.z);
+    dirty_ = MapRect();
+    upload_required_ = true;
+  }
+
+  void MinimapDisplay::processUpdate(map_msgs::msg::OccupancyGridUpdate::ConstSharedPtr update)
+  {
+    std::scoped_lock lock(mutex_);
+    // patches arriving before the map are covered by the map
+    if (pyramid_.empty()) {
+      return;
+    }
+    if (update->x < 0 || update->y < 0 ||
+        update->data.size() != static_cast<size_t>(update->width) * update->height ||
+        !pyramid_.applyPatch(update->data.data(), update->x, update->y, update->width, update->height, dirty_))
+    {
+      setStatus(rviz_common::properties::StatusProperty::Error, "Update",
+                QString("Update of %1 x %2 cells at %3, %4 does not fit into the map")
+                .arg(update->width).arg(update->height).arg(update->x).arg(update->y));
+      return;
+    }
+    deleteStatus("Update");
+  }
+
+  void MinimapDisplay::panelSize(int & width, int & height) const
+  {
+    width = width_;
+    height = pyramid_.empty() ? width_ :
+      std::max(1L, std::lround(static_cast<double>(width_) * pyramid_.height(0) / pyramid_.width(0)));
+  }
+
+  void MinimapDisplay::update(float /*wall_dt*/, float /*ros_dt*/)
+  {
+    reportDeadlineMisses(*this, *scheduled_draw_, reported_deadline_misses_);
+    reportTextureUsage(*this, *overlay_, reported_texture_usage_);
+    std::scoped_lock lock(mutex_);
+    if (show_robot_ && !pyramid_.empty() && updateMarkerPose()) {
+      marker_->show();
+    } else {
+      marker_->hide();
+    }
+    if ((upload_required_ || !dirty_.empty() || marker_required_) && overlay_->isOnScreen()) {
+      scheduled_draw_->requestDraw();
+    }
+  }
+
+  bool MinimapDisplay::updateMarkerPose()
+  {
+    Ogre::Vector3 map_position;
+    Ogre::Quaternion map_orientation;
+    Ogre::Vector3 robot_position;
+    Ogre::Quaternion robot_orientation;
+    const std::string robot_frame = robot_frame_property_->getFrameStd();
+    if (!context_->getFrameManager()->getTransform(map_frame_, map_position, map_orientation) ||
+        !context_->getFrameManager()->getTransform(robot_frame, robot_position, robot_orientation))
+    {
+      setStatus(rviz_common::properties::StatusProperty::Warn, "Robot",
+                QString::fromStdString("No transform from " + robot_frame + " to " + map_frame_));
+      return false;
+    }
+    deleteStatus("Robot");
+
+    // pose of the robot in cells of the grid
+    const Ogre::Quaternion to_grid = origin_orientation_.Inverse() * map_orientation.Inverse();
+    const Ogre::Vector3 cell =
+      origin_orientation_.Inverse() * (map_orientation.Inverse() * (robot_position - map_position) - origin_position_) /
+      resolution_;
+    const double heading = (to_grid * robot_orientation).getRoll().valueRadians();
+
+    int panel_width;
+    int panel_height;
+    panelSize(panel_width, panel_height);
+    const double x = cell.x * panel_width / pyramid_.width(0);
+    const double y = panel_height - cell.y * panel_height / pyramid_.height(0);
+    if (x < 0 || y < 0 || x > panel_width || y > panel_height) {
+      return false;
+    }
+    marker_->setPosition(left_ + std::lround(x) - MARKER_SIZE / 2, top_ + std::lround(y) - MARKER_SIZE / 2);
+    // the grid is shown with y up, clockwise on screen
+    const int marker_heading = (static_cast<int>(std::lround(-heading * 180.0 / M_PI)) % 360 + 360) % 360;
+    if (marker_heading != marker_heading_) {
+      marker_heading_ = marker_heading;
+      marker_required_ = true;
+    }
+    return true;
+  }
+
+  void MinimapDisplay::drawOverlay()
+  {
+    std::scoped_lock lock(mutex_);
+
+    if (!overlay_ || !overlay_->isVisible() || pyramid_.empty()) {
+      return;
+    }
+
+    if (upload_required_) {
+      int panel_width;
+      int panel_height;
+      panelSize(panel_width, panel_height);
+      level_ = pyramid_.levelFor(panel_width, panel_height);
+      overlay_->updateTextureSize(pyramid_.width(level_), pyramid_.height(level_), Ogre::PF_BYTE_BGRA);
+      overlay_->setDimensions(panel_width, panel_height);
+      applyPosition();
+      rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer();
+      pyramid_.copyToPixelBox(
+        level_, MapRect{0, 0, pyramid_.width(level_), pyramid_.height(level_)},
+        buffer.getPixelBuffer()->getCurrentLock());
+      upload_required_ = false;
+      dirty_ = MapRect();
+    } else if (!dirty_.empty()) {
+      // only the region covered by the patches is uploaded
+      const MapRect rect = MapPyramid::levelRect(dirty_, level_);
+      rviz_2d_overlay_plugins::ScopedPixelBuffer buffer =
+        overlay_->getBuffer(Ogre::Box(rect.x0, rect.y0, rect.x1, rect.y1));
+      pyramid_.copyToPixelBox(level_, rect, buffer.getPixelBuffer()->getCurrentLock());
+      dirty_ = MapRect();
+    }
+
+    if (marker_required_) {
+      drawMarker();
+    }
+  }
+
+  void MinimapDisplay::drawMarker()
+  {
+    marker_required_ = false;
+    marker_->updateTextureSize(MARKER_SIZE, MARKER_SIZE);
+    marker_->setDimensions(MARKER_SIZE, MARKER_SIZE);
+    QColor transparent(0, 0, 0, 0);
+    rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = marker_->getBuffer();
+    QImage image = buffer.getQImage(*marker_, transparent);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    painter.translate(MARKER_SIZE / 2.0, MARKER_SIZE / 2.0);
+    painter.rotate(marker_heading_);
+    const double size = MARKER_SIZE / 2.0 - 1.0;
+    const QPointF arrow[] = {{size, 0.0}, {-size, size * 0.7}, {-size * 0.4, 0.0}, {-size, -size * 0.7}};
+    painter.setPen(QPen(QColor(0, 0, 0, 200), 1.0));
+    painter.setBrush(robot_color_);
+    painter.drawPolygon(arrow, 4);
+    painter.end();
+  }
+
+  void MinimapDisplay::applyPosition()
+  {
+    if (overlay_) {
+      overlay_->setPosition(left_, top_);
+    }
+  }
+
+  void MinimapDisplay::updatePalette()
+  {
+    property_batch_.run("palette", [this]() {
+      std::scoped_lock lock(mutex_);
+      pyramid_.setPalette(occupancyPalette(
+        static_cast<OccupancyColorScheme>(color_scheme_property_->getOptionInt()), alpha_property_->getFloat()));
+      upload_required_ = !pyramid_.empty();
+    });
+  }
+
+  void MinimapDisplay::updateWidth()
+  {
+    std::scoped_lock lock(mutex_);
+    width_ = width_property_->getInt();
+    // another level of the pyramid may fit the new size
+    upload_required_ = !pyramid_.empty();
+  }
+
+  void MinimapDisplay::updateLeft()
+  {
+    std::scoped_lock lock(mutex_);
+    left_ = left_property_->getInt();
+    applyPosition();
+  }
+
+  void MinimapDisplay::updateTop()
+  {
+    std::scoped_lock lock(mutex_);
+    top_ = top_property_->getInt();
+    applyPosition();
+  }
+
+  void MinimapDisplay::updateShowRobot()
+  {
+    std::scoped_lock lock(mutex_);
+    show_robot_ = show_robot_property_->getBool();
+  }
+
+  void MinimapDisplay::updateRobotColor()
+  {
+    std::scoped_lock lock(mutex_);
+    robot_color_ = robot_color_property_->getColor();
+    marker_required_ = true;
+  }
+
+  void MinimapDisplay::updateDrawPriority()
+  {
+    scheduled_draw_->setPriority(draw_priority_property_->getInt());
+    overlay_->setPriority(draw_priority_property_->getInt());
+    marker_->setPriority(draw_priority_property_->getInt());
+  }
+
+  bool MinimapDisplay::isInRegion(int x, int y)
+  {
+    int panel_width;
+    int panel_height;
+    panelSize(panel_width, panel_height);
+    return (top_ < y && top_ + panel_height > y &&
+            left_ < x && left_ + panel_width > x);
+  }
+
+  void MinimapDisplay::movePosition(int x, int y)
+  {
+    top_ = y;
+    left_ = x;
+  }
+
+  void MinimapDisplay::setPosition(int x, int y)
+  {
+    top_property_->setValue(y);
+    left_property_->setValue(x);
+  }
+}  // namespace rviz_2d_overlay_plugins
+
+#include <pluginlib/class_list_macros.hpp>
+PLUGINLIB_EXPORT_CLASS( rviz_2d_overlay_plugins::MinimapDisplay, rviz_common::Display )
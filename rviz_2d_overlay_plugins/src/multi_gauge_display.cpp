@@ -0,0 +1,655 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "multi_gauge_display.hpp"
+#include "font_cache.hpp"
+#include "message_field_access.hpp"
+
+#include <cmath>
+
+#include <OgreHardwarePixelBuffer.h>
+#include <QPainter>
+#include <rviz_common/uniform_string_stream.hpp>
+#include <rviz_rendering/render_system.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+  MultiGaugeDisplay::MultiGaugeDisplay()
+    : columns_(4), cell_size_(128), caption_offset_(0), left_(128), top_(128),
+      value_resolution_(0.01), show_caption_(true), layout_required_(true), values_changed_(false),
+      reported_deadline_misses_(0)
+  {
+    topic_message_type_property_ = std::make_unique<rviz_common::properties::StringProperty>(
+      "Topic Message Type", "std_msgs/msg/Float32MultiArray",
+      "Topic message type to subscribe to",
+      this, SLOT(updateTopicMessageType()));
+    topic_fields_property_ = std::make_unique<rviz_common::properties::StringProperty>(
+      "Topic Fields", "data",
+      "Comma separated list of fields to display. Numeric arrays result in one gauge per element",
+      this, SLOT(updateTopicFields()));
+    captions_property_ = std::make_unique<rviz_common::properties::StringProperty>(
+      "Captions", "",
+      "Comma separated list of gauge captions, the field names are used if empty",
+      this, SLOT(updateCaptions()));
+    columns_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "columns", 4,
+      "number of gauges per row",
+      this, SLOT(updateColumns()));
+    columns_property_->setMin(1);
+    size_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "size", 128,
+      "size of a single gauge",
+      this, SLOT(updateSize()));
+    size_property_->setMin(32);
+    size_property_->setMax(1000);
+    left_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "left", 128,
+      "left of the gauge grid",
+      this, SLOT(updateLeft()));
+    left_property_->setMin(0);
+    top_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "top", 128,
+      "top of the gauge grid",
+      this, SLOT(updateTop()));
+    top_property_->setMin(0);
+    value_resolution_property_ = std::make_unique<rviz_common::properties::FloatProperty>(
+      "value resolution", 0.01,
+      "a gauge is only repainted if its value changed by at least this amount",
+      this, SLOT(updateValueResolution()));
+    value_resolution_property_->setMin(0.0);
+    fg_color_property_ = std::make_unique<rviz_common::properties::ColorProperty>(
+      "foreground color", QColor(25, 255, 240),
+      "color to draw line",
+      this, SLOT(updateFGColor()));
+    fg_alpha_property_ = std::make_unique<rviz_common::properties::FloatProperty>(
+      "foreground alpha", 0.7,
+      "alpha belnding value for foreground",
+      this, SLOT(updateFGAlpha()));
+    fg_alpha_property_->setMin(0.0);
+    fg_alpha_property_->setMax(1.0);
+    fg_alpha2_property_ = std::make_unique<rviz_common::properties::FloatProperty>(
+      "foreground alpha 2", 0.4,
+      "alpha belnding value for foreground for indicator",
+      this, SLOT(updateFGAlpha2()));
+    fg_alpha2_property_->setMin(0.0);
+    fg_alpha2_property_->setMax(1.0);
+    bg_color_property_ = std::make_unique<rviz_common::properties::ColorProperty>(
+      "background color", QColor(0, 0, 0),
+      "background color",
+      this, SLOT(updateBGColor()));
+    bg_alpha_property_ = std::make_unique<rviz_common::properties::FloatProperty>(
+      "backround alpha", 0.0,
+      "alpha belnding value for background",
+      this, SLOT(updateBGAlpha()));
+    bg_alpha_property_->setMin(0.0);
+    bg_alpha_property_->setMax(1.0);
+    text_size_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "text size", 14,
+      "text size",
+      this, SLOT(updateTextSize()));
+    text_size_property_->setMin(1);
+    show_caption_property_ = std::make_unique<rviz_common::properties::BoolProperty>(
+      "show caption", true,
+      "show caption",
+      this, SLOT(updateShowCaption()));
+    max_value_property_ = std::make_unique<rviz_common::properties::FloatProperty>(
+      "max value", 1.0,
+      "max value of the gauges",
+      this, SLOT(updateMaxValue()));
+    min_value_property_ = std::make_unique<rviz_common::properties::FloatProperty>(
+      "min value", 0.0,
+      "min value of the gauges",
+      this, SLOT(updateMinValue()));
+    auto_color_change_property_ = std::make_unique<rviz_common::properties::BoolProperty>(
+      "auto color change", false,
+      "change the color automatically",
+      this, SLOT(updateAutoColorChange()));
+    max_color_property_ = std::make_unique<rviz_common::properties::ColorProperty>(
+      "max color", QColor(255, 0, 0),
+      "only used if auto color change is set to True.",
+      this, SLOT(updateMaxColor()));
+    med_color_property_ = std::make_unique<rviz_common::properties::ColorProperty>(
+      "med color", QColor(255, 0, 0),
+      "only used if auto color change is set to True.",
+      this, SLOT(updateMedColor()));
+    max_color_threshold_property_ = std::make_unique<rviz_common::properties::FloatProperty>(
+      "max color change threthold", 0,
+      "change the max color at threshold",
+      this, SLOT(updateMaxColorThreshold()));
+    med_color_threshold_property_ = std::make_unique<rviz_common::properties::FloatProperty>(
+      "med color change threthold", 0,
+      "change the med color at threshold",
+      this, SLOT(updateMedColorThreshold()));
+    clockwise_rotate_property_ = std::make_unique<rviz_common::properties::BoolProperty>(
+      "clockwise rotate direction", false,
+      "change the rotate direction",
+      this, SLOT(updateClockwiseRotate()));
+    draw_priority_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "draw priority", 0,
+      "overlays with higher priority are drawn first if not all overlays can be drawn within a frame",
+      this, SLOT(updateDrawPriority()));
+  }
+
+  MultiGaugeDisplay::~MultiGaugeDisplay()
+  {
+    scheduled_draw_.reset();
+    onDisable();
+  }
+
+  void MultiGaugeDisplay::onInitialize()
+  {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": initialize");
+    RTDClass::onInitialize();
+    rviz_rendering::RenderSystem::get()->prepareOverlays(scene_manager_);
+    initializeOverlay();
+    updateTopicMessageType();
+  }
+
+  void MultiGaugeDisplay::initializeOverlay()
+  {
+    static int count = 0;
+    rviz_common::UniformStringStream ss;
+    ss << "MultiGaugeDisplayObject" << count++;
+    overlay_ = std::make_shared<OverlayObject>(ss.str());
+    scheduled_draw_ = ScheduledDraw::create([this]() {drawOverlay();});
+    overlay_->setTextureLostCallback([this]() {
+      std::scoped_lock lock(mutex_);
+      // the ring layers are painted again as well
+      markStyleChanged();
+    });
+    onEnable();
+    updateTopicFields();
+    updateCaptions();
+    updateColumns();
+    updateSize();
+    updateLeft();
+    updateTop();
+    updateValueResolution();
+    updateFGColor();
+    updateFGAlpha();
+    updateFGAlpha2();
+    updateBGColor();
+    updateBGAlpha();
+    updateTextSize();
+    updateShowCaption();
+    updateMinValue();
+    updateMaxValue();
+    updateAutoColorChange();
+    updateMaxColor();
+    updateMedColor();
+    updateMaxColorThreshold();
+    updateMedColorThreshold();
+    updateClockwiseRotate();
+    updateDrawPriority();
+  }
+
+  void MultiGaugeDisplay::load(const rviz_common::Config & config)
+  {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": load config");
+    RTDClass::load(config);
+  }
+
+  void MultiGaugeDisplay::updateTopic()
+  {
+    property_batch_.run("topic", [this]() {RTDClass::updateTopic();});
+  }
+
+  void MultiGaugeDisplay::onEnable()
+  {
+    layout_required_ = true;
+    subscribe();
+    if (overlay_) {
+      overlay_->show();
+    }
+  }
+
+  void MultiGaugeDisplay::onDisable()
+  {
+    unsubscribe();
+    if (overlay_) {
+      overlay_->hide();
+      overlay_->releaseTexture();
+    }
+    std::scoped_lock lock(mutex_);
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::processMessage(ros_babel_fish::CompoundMessage::ConstSharedPtr msg)
+  {
+    std::scoped_lock lock(mutex_);
+
+    if (!isEnabled()) {
+      return;
+    }
+
+    if (topic_fields_.empty()) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Error,
+        "Topic",
+        QString("Error parsing: Empty topic fields"));
+      return;
+    }
+
+    incoming_values_.clear();
+    std::vector<size_t> values_per_field;
+    try {
+      const std::string message_type = msg->name();
+      for (auto & field : topic_fields_) {
+        const size_t previous_size = incoming_values_.size();
+        // the field is only looked up by name for the first message of a type
+        field.resolve(message_type);
+        field.appendValues(*msg, incoming_values_);
+        values_per_field.push_back(incoming_values_.size() - previous_size);
+      }
+    } catch (ros_babel_fish::BabelFishException &e) {
+      setStatus(
+        rviz_common::properties::StatusProperty::Error,
+        "Topic",
+        QString::fromStdString(std::string{"Error parsing: "} + e.what()));
+      return;
+    }
+
+    if (incoming_values_.size() != values_.size()) {
+      // number of gauges changed, the grid has to be laid out again
+      default_captions_.clear();
+      for (size_t i = 0; i < topic_fields_.size(); i++) {
+        const QString path = QString::fromStdString(topic_fields_[i].path());
+        if (values_per_field[i] == 1) {
+          default_captions_ << path;
+        } else {
+          for (size_t j = 0; j < values_per_field[i]; j++) {
+            default_captions_ << path + "[" + QString::number(j) + "]";
+          }
+        }
+      }
+      layout_required_ = true;
+    }
+    values_.swap(incoming_values_);
+    values_changed_ = true;
+  }
+
+  void MultiGaugeDisplay::update(float /*wall_dt*/, float /*ros_dt*/)
+  {
+    reportDeadlineMisses(*this, *scheduled_draw_, reported_deadline_misses_);
+    reportTextureUsage(*this, *overlay_, reported_texture_usage_);
+    std::scoped_lock lock(mutex_);
+    // off screen the latest values are kept, the gauges are painted once visible again
+    if ((layout_required_ || values_changed_) && overlay_->isOnScreen()) {
+      scheduled_draw_->requestDraw();
+    }
+  }
+
+  void MultiGaugeDisplay::drawOverlay()
+  {
+    std::scoped_lock lock(mutex_);
+
+    if (!overlay_ || !overlay_->isVisible()) {
+      return;
+    }
+
+    if (layout_required_) {
+      drawAll();
+      layout_required_ = false;
+      values_changed_ = false;
+      return;
+    }
+
+    if (!values_changed_) {
+      return;
+    }
+    values_changed_ = false;
+    for (size_t i = 0; i < values_.size(); i++) {
+      if (quantize(values_[i]) != drawn_values_[i]) {
+        drawCell(i);
+      }
+    }
+  }
+
+  int64_t MultiGaugeDisplay::quantize(double value) const
+  {
+    if (value_resolution_ <= 0.0) {
+      // quantize to the precision of the displayed value
+      return std::llround(value * 100.0);
+    }
+    return std::llround(value / value_resolution_);
+  }
+
+  QRect MultiGaugeDisplay::cellRect(size_t index) const
+  {
+    const int cell_height = cell_size_ + caption_offset_;
+    return QRect((index % columns_) * cell_size_, (index / columns_) * cell_height,
+                 cell_size_, cell_height);
+  }
+
+  const QImage & MultiGaugeDisplay::ringLayer(const QColor & value_color)
+  {
+    auto it = ring_layers_.find(value_color.rgb());
+    if (it != ring_layers_.end()) {
+      return it->second;
+    }
+    // with auto color change the color is interpolated, keep the cache bounded
+    if (ring_layers_.size() > 64) {
+      ring_layers_.clear();
+    }
+
+    QColor bg_color(style_.bg_color);
+    bg_color.setAlpha(style_.bg_alpha);
+    QImage layer(cell_size_, cell_size_ + caption_offset_, QImage::Format_ARGB32);
+    layer.fill(bg_color);
+    QPainter painter(&layer);
+    painter.setRenderHint(QPainter::Antialiasing, true);
+    drawGaugeRing(painter, layer.rect(), caption_offset_, value_color, style_);
+    painter.end();
+    return ring_layers_.emplace(value_color.rgb(), std::move(layer)).first->second;
+  }
+
+  void MultiGaugeDisplay::drawAll()
+  {
+    const size_t gauge_count = std::max<size_t>(values_.size(), 1);
+    const size_t columns = std::min<size_t>(columns_, gauge_count);
+    const size_t rows = (gauge_count + columns_ - 1) / columns_;
+    overlay_->updateTextureSize(columns * cell_size_, rows * (cell_size_ + caption_offset_));
+    overlay_->setPosition(left_, top_);
+    overlay_->setDimensions(overlay_->getTextureWidth(), overlay_->getTextureHeight());
+
+    QColor bg_color(style_.bg_color);
+    bg_color.setAlpha(style_.bg_alpha);
+    drawn_values_.resize(values_.size());
+    {
+      rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer();
+      QImage Hud = buffer.getQImage(*overlay_, bg_color);
+      QPainter painter(&Hud);
+      painter.setRenderHint(QPainter::Antialiasing, true);
+      for (size_t i = 0; i < values_.size(); i++) {
+        drawn_values_[i] = quantize(values_[i]);
+        const double value = value_resolution_ > 0.0 ? drawn_values_[i] * value_resolution_ : values_[i];
+        const QColor value_color = gaugeValueColor(style_, value);
+        const QRect cell = cellRect(i);
+        painter.setCompositionMode(QPainter::CompositionMode_Source);
+        painter.drawImage(cell.topLeft(), ringLayer(value_color));
+        painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+        drawGaugeValue(painter, cell, caption_offset_, value_color, value,
+                       show_caption_ ? captions_.value(i, default_captions_.value(i)) : QString(), style_);
+      }
+      painter.end();
+    }
+  }
+
+  void MultiGaugeDisplay::drawCell(size_t index)
+  {
+    drawn_values_[index] = quantize(values_[index]);
+    const double value =
+      value_resolution_ > 0.0 ? drawn_values_[index] * value_resolution_ : values_[index];
+    const QColor value_color = gaugeValueColor(style_, value);
+    const QRect cell = cellRect(index);
+    const QImage & ring = ringLayer(value_color);
+    {
+      rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer(
+        Ogre::Box(cell.left(), cell.top(), cell.left() + cell.width(), cell.top() + cell.height()));
+      QImage region = buffer.getRegionQImage();
+      QPainter painter(&region);
+      painter.setCompositionMode(QPainter::CompositionMode_Source);
+      painter.drawImage(0, 0, ring);
+      painter.setCompositionMode(QPainter::CompositionMode_SourceOver);
+      painter.setRenderHint(QPainter::Antialiasing, true);
+      drawGaugeValue(painter, QRect(0, 0, cell.width(), cell.height()), caption_offset_, value_color, value,
+                     show_caption_ ? captions_.value(index, default_captions_.value(index)) : QString(), style_);
+      painter.end();
+    }
+  }
+
+  void MultiGaugeDisplay::markStyleChanged()
+  {
+    ring_layers_.clear();
+    layout_required_ = true;
+  }
+
+  void MultiGaugeDisplay::updateTopicMessageType()
+  {
+    topic_property_->setMessageType(topic_message_type_property_->getString());
+    updateTopic();
+  }
+
+  void MultiGaugeDisplay::updateTopicFields()
+  {
+    std::scoped_lock lock(mutex_);
+    topic_fields_.clear();
+    for (const auto & path : topic_fields_property_->getString().split(",", Qt::SkipEmptyParts)) {
+      topic_fields_.emplace_back(path.trimmed().toStdString());
+    }
+    // force a new layout with the next message
+    values_.clear();
+    layout_required_ = true;
+  }
+
+  void MultiGaugeDisplay::updateCaptions()
+  {
+    std::scoped_lock lock(mutex_);
+    captions_.clear();
+    for (const auto & caption : captions_property_->getString().split(",")) {
+      captions_ << caption.trimmed();
+    }
+    if (captions_.size() == 1 && captions_.front().isEmpty()) {
+      captions_.clear();
+    }
+    layout_required_ = true;
+  }
+
+  void MultiGaugeDisplay::updateColumns()
+  {
+    std::scoped_lock lock(mutex_);
+    columns_ = columns_property_->getInt();
+    layout_required_ = true;
+  }
+
+  void MultiGaugeDisplay::updateSize()
+  {
+    std::scoped_lock lock(mutex_);
+    cell_size_ = size_property_->getInt();
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateLeft()
+  {
+    left_ = left_property_->getInt();
+    if (overlay_) {
+      overlay_->setPosition(left_, top_);
+    }
+  }
+
+  void MultiGaugeDisplay::updateTop()
+  {
+    top_ = top_property_->getInt();
+    if (overlay_) {
+      overlay_->setPosition(left_, top_);
+    }
+  }
+
+  void MultiGaugeDisplay::updateValueResolution()
+  {
+    std::scoped_lock lock(mutex_);
+    value_resolution_ = value_resolution_property_->getFloat();
+    layout_required_ = true;
+  }
+
+  void MultiGaugeDisplay::updateFGColor()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.fg_color = fg_color_property_->getColor();
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateFGAlpha()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.fg_alpha = fg_alpha_property_->getFloat() * 255.0;
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateFGAlpha2()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.fg_alpha2 = fg_alpha2_property_->getFloat() * 255.0;
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateBGColor()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.bg_color = bg_color_property_->getColor();
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateBGAlpha()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.bg_alpha = bg_alpha_property_->getFloat() * 255.0;
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateTextSize()
+  {
+    property_batch_.run("text size", [this]() {
+      std::scoped_lock lock(mutex_);
+      style_.text_size = text_size_property_->getInt();
+      caption_offset_ = FontCache::instance().get(QString(), style_.text_size)->metrics.height();
+      markStyleChanged();
+    });
+  }
+
+  void MultiGaugeDisplay::updateShowCaption()
+  {
+    std::scoped_lock lock(mutex_);
+    show_caption_ = show_caption_property_->getBool();
+    layout_required_ = true;
+  }
+
+  void MultiGaugeDisplay::updateMinValue()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.min_value = min_value_property_->getFloat();
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateMaxValue()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.max_value = max_value_property_->getFloat();
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateAutoColorChange()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.auto_color_change = auto_color_change_property_->getBool();
+    if (style_.auto_color_change) {
+      max_color_property_->show();
+      med_color_property_->show();
+      max_color_threshold_property_->show();
+      med_color_threshold_property_->show();
+    } else {
+      max_color_property_->hide();
+      med_color_property_->hide();
+      max_color_threshold_property_->hide();
+      med_color_threshold_property_->hide();
+    }
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateMaxColor()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.max_color = max_color_property_->getColor();
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateMedColor()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.med_color = med_color_property_->getColor();
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateMaxColorThreshold()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.max_color_threshold = max_color_threshold_property_->getFloat();
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateMedColorThreshold()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.med_color_threshold = med_color_threshold_property_->getFloat();
+    markStyleChanged();
+  }
+
+  void MultiGaugeDisplay::updateClockwiseRotate()
+  {
+    std::scoped_lock lock(mutex_);
+    style_.clockwise_rotate = clockwise_rotate_property_->getBool();
+    layout_required_ = true;
+  }
+
+  void MultiGaugeDisplay::updateDrawPriority()
+  {
+    scheduled_draw_->setPriority(draw_priority_property_->getInt());
+    overlay_->setPriority(draw_priority_property_->getInt());
+  }
+
+  bool MultiGaugeDisplay::isInRegion(int x, int y)
+  {
+    const int width = overlay_ ? overlay_->getTextureWidth() : 0;
+    const int height = overlay_ ? overlay_->getTextureHeight() : 0;
+    return (top_ < y && top_ + height > y &&
+            left_ < x && left_ + width > x);
+  }
+
+  void MultiGaugeDisplay::movePosition(int x, int y)
+  {
+    top_ = y;
+    left_ = x;
+  }
+
+  void MultiGaugeDisplay::setPosition(int x, int y)
+  {
+    top_property_->setValue(y);
+    left_property_->setValue(x);
+  }
+}  // namespace rviz_2d_overlay_plugins
+
+#include <pluginlib/class_list_macros.hpp>
+PLUGINLIB_EXPORT_CLASS( rviz_2d_overlay_plugins::MultiGaugeDisplay, rviz_common::Display )
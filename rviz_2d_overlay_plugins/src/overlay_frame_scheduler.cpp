@@ -0,0 +1,229 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "overlay_frame_scheduler.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include <OgreRoot.h>
+#include <rviz_common/logging.hpp>
+
+#include "overlay_texture_budget.hpp"
+
+namespace rviz_2d_overlay_plugins
+{
+  namespace
+  {
+    int64_t steadyNowNs()
+    {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+  }  // namespace
+
+  ScheduledDraw::ScheduledDraw(std::function<void()> draw, int priority)
+    : draw_(std::move(draw)), priority_(priority), pending_(false), pending_since_ns_(0),
+      deadline_misses_(0), missed_(false)
+  {
+  }
+
+  ScheduledDraw::SharedPtr ScheduledDraw::create(std::function<void()> draw, int priority)
+  {
+    SharedPtr scheduled_draw(new ScheduledDraw(std::move(draw), priority));
+    OverlayFrameScheduler::instance().add(scheduled_draw);
+    return scheduled_draw;
+  }
+
+  void ScheduledDraw::requestDraw()
+  {
+    if (!pending_.exchange(true)) {
+      pending_since_ns_ = steadyNowNs();
+    }
+  }
+
+  bool ScheduledDraw::drawPending() const
+  {
+    return pending_;
+  }
+
+  void ScheduledDraw::setPriority(int priority)
+  {
+    priority_ = priority;
+  }
+
+  int ScheduledDraw::priority() const
+  {
+    return priority_;
+  }
+
+  uint64_t ScheduledDraw::deadlineMisses() const
+  {
+    return deadline_misses_;
+  }
+
+  OverlayFrameScheduler & OverlayFrameScheduler::instance()
+  {
+    static OverlayFrameScheduler scheduler;
+    return scheduler;
+  }
+
+  OverlayFrameScheduler::OverlayFrameScheduler()
+    : budget_(8000), deadline_(100000), deadline_misses_(0), listening_(false)
+  {
+    if (const char * budget = std::getenv("RVIZ_2D_OVERLAY_FRAME_BUDGET_MS")) {
+      const double budget_ms = std::atof(budget);
+      if (budget_ms > 0.0) {
+        budget_ = std::chrono::microseconds(static_cast<int64_t>(budget_ms * 1000.0));
+      } else {
+        RVIZ_COMMON_LOG_WARNING_STREAM("Ignoring invalid RVIZ_2D_OVERLAY_FRAME_BUDGET_MS=" << budget);
+      }
+    }
+  }
+
+  void OverlayFrameScheduler::setBudget(std::chrono::microseconds budget)
+  {
+    budget_ = budget;
+  }
+
+  std::chrono::microseconds OverlayFrameScheduler::budget() const
+  {
+    return budget_;
+  }
+
+  void OverlayFrameScheduler::setDeadline(std::chrono::microseconds deadline)
+  {
+    deadline_ = deadline;
+  }
+
+  std::chrono::microseconds OverlayFrameScheduler::deadline() const
+  {
+    return deadline_;
+  }
+
+  uint64_t OverlayFrameScheduler::deadlineMisses() const
+  {
+    return deadline_misses_;
+  }
+
+  void OverlayFrameScheduler::add(const ScheduledDraw::SharedPtr & draw)
+  {
+    if (!listening_) {
+      // displays are created after the render system, so the root exists
+      Ogre::Root::getSingleton().addFrameListener(this);
+      listening_ = true;
+    }
+    draws_.push_back(draw);
+  }
+
+  bool OverlayFrameScheduler::frameStarted(const Ogre::FrameEvent & /*event*/)
+  {
+    const auto frame_start = std::chrono::steady_clock::now();
+    const int64_t now_ns = steadyNowNs();
+    const int64_t deadline_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline_).count();
+
+    // before drawing, overlays that lost their texture request a repaint with their next update
+    OverlayTextureBudget::instance().enforce();
+
+    // draws of destroyed displays are dropped here
+    auto & pending = pending_;
+    draws_.erase(
+      std::remove_if(draws_.begin(), draws_.end(), [&pending](const std::weak_ptr<ScheduledDraw> & weak) {
+        auto draw = weak.lock();
+        if (!draw) {
+          return true;
+        }
+        if (draw->pending_) {
+          pending.push_back(std::move(draw));
+        }
+        return false;
+      }), draws_.end());
+    if (pending.empty()) {
+      return true;
+    }
+
+    std::sort(pending.begin(), pending.end(), [now_ns, deadline_ns](const auto & a, const auto & b) {
+      const int64_t a_since = a->pending_since_ns_;
+      const int64_t b_since = b->pending_since_ns_;
+      const bool a_overdue = now_ns - a_since > deadline_ns;
+      const bool b_overdue = now_ns - b_since > deadline_ns;
+      if (a_overdue != b_overdue) {
+        return a_overdue;
+      }
+      if (a->priority_ != b->priority_) {
+        return a->priority_ > b->priority_;
+      }
+      return a_since < b_since;
+    });
+
+    size_t drawn = 0;
+    for (; drawn < pending.size(); drawn++) {
+      // at least one draw per frame, otherwise an expensive overlay would never be drawn
+      if (drawn > 0 && std::chrono::steady_clock::now() - frame_start >= budget_) {
+        break;
+      }
+      ScheduledDraw & draw = *pending[drawn];
+      // requests arriving while drawing mark the overlay outdated again
+      draw.pending_ = false;
+      draw.missed_ = false;
+      draw.draw_();
+    }
+
+    for (size_t i = drawn; i < pending.size(); i++) {
+      ScheduledDraw & draw = *pending[i];
+      if (!draw.missed_ && now_ns - draw.pending_since_ns_ > deadline_ns) {
+        draw.missed_ = true;
+        draw.deadline_misses_++;
+        deadline_misses_++;
+      }
+    }
+    pending.clear();
+    return true;
+  }
+
+  void reportDeadlineMisses(rviz_common::Display & display, const ScheduledDraw & draw, uint64_t & reported_misses)
+  {
+    const uint64_t misses = draw.deadlineMisses();
+    if (misses == reported_misses) {
+      return;
+    }
+    reported_misses = misses;
+    display.setStatus(
+      rviz_common::properties::StatusProperty::Warn,
+      "Frame budget",
+      QString("Repaint deferred past its deadline %1 times, the overlay frame budget is exhausted").arg(misses));
+  }
+}  // namespace rviz_2d_overlay_plugins
@@ -0,0 +1,297 @@
+// publishes synthetic OverlayText, scalar and array messages to load the overlay displays
+
+// test with:
+// ros2 run rviz_2d_overlay_plugins overlay_load_generator --ros-args -p text_topics:=10 -p rate:=100.0 -p record_path:=/tmp/scenario.yaml
+// replay a recorded scenario:
+// ros2 run rviz_2d_overlay_plugins overlay_load_generator --ros-args --params-file /tmp/scenario.yaml
+// find the saturation point by increasing the rate by 10 Hz every 5 s:
+// ros2 run rviz_2d_overlay_plugins overlay_load_generator --ros-args -p ramp_step:=10.0 -p ramp_interval:=5.0
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <vector>
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
+#include "rviz_2d_overlay_msgs/msg/overlay_text.hpp"
+#include "std_msgs/msg/float32.hpp"
+#include "std_msgs/msg/float32_multi_array.hpp"
+
+
+
+namespace rviz_2d_overlay_plugins
+{
+
+class OverlayLoadGenerator : public rclcpp::Node
+{
+    // Text of one OverlayText topic, kept as words so churn and markup stay well-formed
+    struct TextTopic
+    {
+        std::vector<std::string> words;
+        std::vector<bool> markup;
+        rviz_2d_overlay_msgs::msg::OverlayText message;
+        rclcpp::Publisher<rviz_2d_overlay_msgs::msg::OverlayText>::SharedPtr publisher;
+    };
+
+    std::string randomWord()
+    {
+        std::uniform_int_distribution<int> length(2, 9);
+        std::uniform_int_distribution<int> letter('a', 'z');
+        std::string word(length(rng_), ' ');
+        for (auto &c: word)
+        {
+            c = static_cast<char>(letter(rng_));
+        }
+        return word;
+    }
+
+    // rebuilds the text of the message from the words, reusing its allocation
+    void composeText(TextTopic &topic)
+    {
+        std::string &text = topic.message.text;
+        text.clear();
+        for (size_t i = 0; i < topic.words.size(); i++)
+        {
+            if (i > 0)
+            {
+                // a line break every 8 words, the displays wrap lines themselves otherwise
+                text += i % 8 == 0 ? '\n' : ' ';
+            }
+            if (topic.markup[i])
+            {
+                text += "<span style=\"color: #ff8000;\"><b>";
+                text += topic.words[i];
+                text += "</b></span>";
+            }
+            else
+            {
+                text += topic.words[i];
+            }
+        }
+    }
+
+    void initTextTopic(TextTopic &topic, size_t index)
+    {
+        std::bernoulli_distribution markup(markup_density_);
+        size_t length = 0;
+        while (length < static_cast<size_t>(text_size_))
+        {
+            topic.words.push_back(randomWord());
+            topic.markup.push_back(markup(rng_));
+            length += topic.words.back().size() + 1;
+        }
+        auto &msg = topic.message;
+        msg.width = 400;
+        msg.height = 20 * (1 + topic.words.size() / 8);
+        msg.horizontal_distance = 10;
+        msg.vertical_distance = 10 + 10 * static_cast<int>(index);
+        msg.text_size = 10.0;
+        msg.fg_color.r = 0.94f;
+        msg.fg_color.g = 0.83f;
+        msg.fg_color.b = 0.07f;
+        msg.fg_color.a = 1.0f;
+        composeText(topic);
+    }
+
+    // double quoted YAML scalar, quotes, backslashes and control characters are escaped
+    static std::string yamlQuoted(const std::string &value)
+    {
+        std::string quoted = "\"";
+        for (const char c: value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                quoted += '\\';
+                quoted += c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\x%02x", static_cast<unsigned char>(c));
+                quoted += escaped;
+            }
+            else
+            {
+                quoted += c;
+            }
+        }
+        quoted += '"';
+        return quoted;
+    }
+
+    // writes the effective parameters as parameter file, which replays the scenario with --params-file
+    void recordScenario(const std::string &path)
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            RCLCPP_ERROR_STREAM(this->get_logger(), "Cannot write scenario to " << path);
+            return;
+        }
+        file << this->get_fully_qualified_name() << ":\n";
+        file << "  ros__parameters:\n";
+        for (const auto &name: this->list_parameters({}, 0).names)
+        {
+            if (name == "record_path" || name == "use_sim_time")
+            {
+                continue;
+            }
+            const auto param = this->get_parameter(name);
+            if (param.get_type() == rclcpp::ParameterType::PARAMETER_STRING)
+            {
+                file << "    " << name << ": " << yamlQuoted(param.as_string()) << "\n";
+            }
+            else
+            {
+                file << "    " << name << ": " << param.value_to_string() << "\n";
+            }
+        }
+        RCLCPP_INFO_STREAM(this->get_logger(), "Scenario recorded to " << path);
+    }
+
+    void startTimer()
+    {
+        timer_ = this->create_wall_timer(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1.0 / rate_)),
+            [this]() { publishAll(); });
+    }
+
+public:
+    explicit OverlayLoadGenerator(const rclcpp::NodeOptions &options = rclcpp::NodeOptions())
+        : Node("overlay_load_generator", options)
+    {
+        const int text_topics = this->declare_parameter<int>("text_topics", 1);
+        const int scalar_topics = this->declare_parameter<int>("scalar_topics", 0);
+        const int array_topics = this->declare_parameter<int>("array_topics", 0);
+        const std::string topic_prefix = this->declare_parameter<std::string>("topic_prefix", "load");
+        rate_ = this->declare_parameter<double>("rate", 30.0);
+        text_size_ = this->declare_parameter<int>("text_size", 200);
+        markup_density_ = this->declare_parameter<double>("markup_density", 0.0);
+        churn_ = this->declare_parameter<double>("churn", 0.1);
+        rcl_interfaces::msg::ParameterDescriptor array_size_descriptor;
+        array_size_descriptor.description = "number of elements of every array message";
+        // declaring a value out of range throws, so the node does not start with an invalid size
+        array_size_descriptor.integer_range.resize(1);
+        array_size_descriptor.integer_range[0].from_value = 1;
+        array_size_descriptor.integer_range[0].to_value = 1 << 20;
+        array_size_ = this->declare_parameter<int>("array_size", 16, array_size_descriptor);
+        ramp_step_ = this->declare_parameter<double>("ramp_step", 0.0);
+        ramp_interval_ = this->declare_parameter<double>("ramp_interval", 5.0);
+        const int seed = this->declare_parameter<int>("seed", 42);
+        const std::string record_path = this->declare_parameter<std::string>("record_path", "");
+
+        if (rate_ <= 0.0)
+        {
+            RCLCPP_ERROR_STREAM(this->get_logger(), "Parameter rate has to be positive");
+            rate_ = 30.0;
+        }
+        markup_density_ = std::clamp(markup_density_, 0.0, 1.0);
+        churn_ = std::clamp(churn_, 0.0, 1.0);
+        rng_.seed(seed);
+
+        for (int i = 0; i < text_topics; i++)
+        {
+            auto topic = std::make_unique<TextTopic>();
+            initTextTopic(*topic, i);
+            topic->publisher = this->create_publisher<rviz_2d_overlay_msgs::msg::OverlayText>(
+                topic_prefix + "/text_" + std::to_string(i), 1);
+            text_topics_.push_back(std::move(topic));
+        }
+        for (int i = 0; i < scalar_topics; i++)
+        {
+            scalar_publishers_.push_back(this->create_publisher<std_msgs::msg::Float32>(
+                topic_prefix + "/scalar_" + std::to_string(i), 1));
+        }
+        for (int i = 0; i < array_topics; i++)
+        {
+            array_publishers_.push_back(this->create_publisher<std_msgs::msg::Float32MultiArray>(
+                topic_prefix + "/array_" + std::to_string(i), 1));
+        }
+        array_message_.data.resize(array_size_);
+
+        if (!record_path.empty())
+        {
+            recordScenario(record_path);
+        }
+
+        start_time_ = this->now();
+        startTimer();
+        if (ramp_step_ > 0.0 && ramp_interval_ > 0.0)
+        {
+            ramp_timer_ = this->create_wall_timer(std::chrono::duration<double>(ramp_interval_), [this]() {
+                rate_ += ramp_step_;
+                startTimer();
+                RCLCPP_INFO_STREAM(this->get_logger(), "Ramp: publishing at " << rate_ << " Hz");
+            });
+        }
+        RCLCPP_INFO_STREAM(this->get_logger(), "Node started: " << this->get_name() << " publishing " << text_topics << " text, "
+            << scalar_topics << " scalar and " << array_topics << " array topic(s) at " << rate_ << " Hz");
+    }
+
+private:
+    void publishAll()
+    {
+        const double t = (this->now() - start_time_).seconds();
+
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        std::bernoulli_distribution markup(markup_density_);
+        for (auto &topic: text_topics_)
+        {
+            bool changed = false;
+            for (size_t i = 0; i < topic->words.size(); i++)
+            {
+                if (uniform(rng_) < churn_)
+                {
+                    topic->words[i] = randomWord();
+                    topic->markup[i] = markup(rng_);
+                    changed = true;
+                }
+            }
+            if (changed)
+            {
+                composeText(*topic);
+            }
+            topic->publisher->publish(topic->message);
+        }
+
+        for (size_t i = 0; i < scalar_publishers_.size(); i++)
+        {
+            scalar_message_.data = 0.5 + 0.5 * std::sin(t + i);
+            scalar_publishers_[i]->publish(scalar_message_);
+        }
+        for (size_t i = 0; i < array_publishers_.size(); i++)
+        {
+            for (size_t j = 0; j < array_message_.data.size(); j++)
+            {
+                array_message_.data[j] = 0.5 + 0.5 * std::sin(t + i + 0.1 * j);
+            }
+            array_publishers_[i]->publish(array_message_);
+        }
+    }
+
+    std::mt19937 rng_;
+    double rate_;
+    int text_size_;
+    double markup_density_;
+    double churn_;
+    int array_size_;
+    double ramp_step_;
+    double ramp_interval_;
+    rclcpp::Time start_time_;
+
+    std::vector<std::unique_ptr<TextTopic>> text_topics_;
+    std::vector<rclcpp::Publisher<std_msgs::msg::Float32>::SharedPtr> scalar_publishers_;
+    std::vector<rclcpp::Publisher<std_msgs::msg::Float32MultiArray>::SharedPtr> array_publishers_;
+    std_msgs::msg::Float32 scalar_message_;
+    std_msgs::msg::Float32MultiArray array_message_;
+    rclcpp::TimerBase::SharedPtr timer_;
+    rclcpp::TimerBase::SharedPtr ramp_timer_;
+};
+
+} // namespace rviz_2d_overlay_plugins
+
+RCLCPP_COMPONENTS_REGISTER_NODE(rviz_2d_overlay_plugins::OverlayLoadGenerator)
@@ -35,23 +35,32 @@
  *********************************************************************/
 
 #include "overlay_text_display.hpp"
+#include "font_cache.hpp"
+
+#include <algorithm>
+#include <cmath>
 
 #include <OgreHardwarePixelBuffer.h>
 #include <OgreMaterialManager.h>
 #include <OgreTexture.h>
-#include <QFontDatabase>
 #include <QPainter>
-#include <QStaticText>
 #include <QTextDocument>
-#include <boost/algorithm/string.hpp>
-#include <boost/format.hpp>
-#include <regex>
 #include <rviz_common/logging.hpp>
 #include <rviz_rendering/render_system.hpp>
 #include <sstream>
 
 namespace rviz_2d_overlay_plugins {
+    namespace {
+        // longer lines are cut, textures of this width are supported by all common GPUs
+        constexpr int MAX_TICKER_WIDTH = 8192;
+
+        QColor toQColor(const std_msgs::msg::ColorRGBA &color) {
+            return QColor(color.r * 255.0, color.g * 255.0, color.b * 255.0, color.a * 255.0);
+        }
+    } // namespace
+
     OverlayTextDisplay::OverlayTextDisplay() :
+        reported_deadline_misses_(0),
         texture_width_(0),
         texture_height_(0),
         bg_color_(0, 0, 0, 0),
@@ -60,6 +69,13 @@ namespace rviz_2d_overlay_plugins {
         line_width_(2),
         text_(""),
         font_(""),
+        text_id_(0),
+        text_received_(false),
+        require_layout_(true),
+        ticker_(false),
+        ticker_speed_(50.0),
+        ticker_offset_(0.0),
+        ticker_width_(0),
         require_update_texture_(false) {
         overtake_position_properties_property_ = new rviz_common::properties::BoolProperty(
                 "Overtake Position Properties", false,
@@ -119,16 +135,27 @@ namespace rviz_2d_overlay_plugins {
         bg_alpha_property_->setMin(0.0);
         bg_alpha_property_->setMax(1.0);
 
-        QFontDatabase database;
-        font_families_ = database.families();
+        // the font families are only added when the property is expanded the first time
+        FontCatalog::instance();
         font_property_ =
                 new rviz_common::properties::EnumProperty("font", "DejaVu Sans Mono", "font", this, SLOT(updateFont()));
-        for (ssize_t i = 0; i < font_families_.size(); i++) {
-            font_property_->addOption(font_families_[i], (int) i);
-        }
+        font_property_->addOption("DejaVu Sans Mono", 0);
+        connect(font_property_, SIGNAL(requestOptions(EnumProperty*)), this, SLOT(fillFontOptions()));
+        ticker_property_ = new rviz_common::properties::BoolProperty(
+                "ticker", false, "scroll the text on a single line through the overlay if it is wider than the overlay",
+                this, SLOT(updateTicker()));
+        ticker_speed_property_ = new rviz_common::properties::FloatProperty(
+                "ticker speed", 50.0, "scroll speed of the ticker in pixels per second", ticker_property_,
+                SLOT(updateTickerSpeed()), this);
+        ticker_speed_property_->setMin(0.0);
+        draw_priority_property_ = new rviz_common::properties::IntProperty(
+                "draw priority", 0,
+                "overlays with higher priority are drawn first if not all overlays can be drawn within a frame", this,
+                SLOT(updateDrawPriority()));
     }
 
     OverlayTextDisplay::~OverlayTextDisplay() {
+        scheduled_draw_.reset();
         onDisable();
     }
 
@@ -142,17 +169,25 @@ namespace rviz_2d_overlay_plugins {
     void OverlayTextDisplay::onDisable() {
         if (overlay_) {
             overlay_->hide();
+            overlay_->releaseTexture();
+            // the texture is created again with the next draw after enabling
+            require_update_texture_ = true;
         }
         unsubscribe();
     }
 
     // only the first time
     void OverlayTextDisplay::onInitialize() {
+        PropertyBatch::Scope batch(property_batch_, getNameStd() + ": initialize");
         RTDClass::onInitialize();
         rviz_rendering::RenderSystem::get()->prepareOverlays(scene_manager_);
-
+        initializeOverlay();
         onEnable();
         updateTopic();
+    }
+
+    void OverlayTextDisplay::initializeOverlay() {
+        scheduled_draw_ = ScheduledDraw::create([this]() { drawOverlay(); });
         updateOvertakePositionProperties();
         updateOvertakeFGColorProperties();
         updateOvertakeBGColorProperties();
@@ -171,10 +206,64 @@ namespace rviz_2d_overlay_plugins {
         updateBGAlpha();
         updateFont();
         updateLineWidth();
+        updateTicker();
+        updateTickerSpeed();
+        updateDrawPriority();
         require_update_texture_ = true;
     }
 
-    void OverlayTextDisplay::update(float /*wall_dt*/, float /*ros_dt*/) {
+    void OverlayTextDisplay::load(const rviz_common::Config &config) {
+        PropertyBatch::Scope batch(property_batch_, getNameStd() + ": load config");
+        RTDClass::load(config);
+    }
+
+    void OverlayTextDisplay::updateTopic() {
+        property_batch_.run("topic", [this]() { RTDClass::updateTopic(); });
+    }
+
+    void OverlayTextDisplay::subscribe() {
+        RTDClass::subscribe();
+        if (!isEnabled() || topic_property_->isEmpty()) {
+            return;
+        }
+        try {
+            patch_subscription_ = rviz_ros_node_.lock()
+                    ->get_raw_node()
+                    ->create_subscription<rviz_2d_overlay_msgs::msg::OverlayTextPatch>(
+                            topic_property_->getTopicStd() + "_patch", qos_profile,
+                            [this](rviz_2d_overlay_msgs::msg::OverlayTextPatch::ConstSharedPtr patch) {
+                                processPatch(patch);
+                            });
+            deleteStatus("Patch Topic");
+        } catch (const rclcpp::exceptions::InvalidTopicNameError &e) {
+            setStatus(rviz_common::properties::StatusProperty::Error, "Patch Topic",
+                      QString("Error subscribing: ") + e.what());
+        }
+    }
+
+    void OverlayTextDisplay::unsubscribe() {
+        RTDClass::unsubscribe();
+        patch_subscription_.reset();
+    }
+
+    void OverlayTextDisplay::update(float wall_dt, float /*ros_dt*/) {
+        reportDeadlineMisses(*this, *scheduled_draw_, reported_deadline_misses_);
+        if (overlay_) {
+            reportTextureUsage(*this, *overlay_, reported_texture_usage_);
+        }
+        // hidden by a DELETE action or moved out of the viewport, the text is painted once it is visible again
+        if (require_update_texture_ && overlay_ && overlay_->isOnScreen()) {
+            scheduled_draw_->requestDraw();
+        }
+        // the ticker texture is painted once per text, scrolling only moves the texture coordinates
+        if (ticker_width_ > 0 && ticker_speed_ > 0.0 && overlay_ && overlay_->isOnScreen()) {
+            // wall_dt is given in nanoseconds
+            ticker_offset_ = std::fmod(ticker_offset_ + ticker_speed_ * wall_dt * 1e-9, ticker_width_);
+            updateTickerCoordinates();
+        }
+    }
+
+    void OverlayTextDisplay::drawOverlay() {
         if (!require_update_texture_) {
             return;
         }
@@ -185,26 +274,39 @@ namespace rviz_2d_overlay_plugins {
             return;
         }
 
-        overlay_->updateTextureSize(texture_width_, texture_height_);
+        const std::shared_ptr<const ResolvedFont> resolved_font = textFont();
+        const QFont &font = resolved_font->font;
+        if (require_layout_ && text_.length() > 0) {
+            const double scale = overlay_->getTextureScale();
+            std::string text = text_;
+            if (ticker_) {
+                std::replace(text.begin(), text.end(), '\n', ' ');
+            }
+            text_layout_.layout(text, ticker_ ? -1 : std::max(texture_width_, 1), std::max(texture_height_, 1),
+                                *resolved_font, QTransform::fromScale(scale, scale));
+            require_layout_ = false;
+        }
+        // a line wider than the overlay is painted once into a texture of the width of the line and a gap, the
+        // panel shows a part of it of the width of the overlay
+        ticker_width_ = 0;
+        if (ticker_ && text_.length() > 0 && text_layout_.width() > texture_width_) {
+            ticker_width_ = std::min(text_layout_.width() + 4 * resolved_font->metrics.averageCharWidth(),
+                                     MAX_TICKER_WIDTH);
+            ticker_offset_ = std::fmod(ticker_offset_, ticker_width_);
+        }
+        overlay_->updateTextureSize(ticker_width_ > 0 ? ticker_width_ : texture_width_, texture_height_);
         {
             rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer();
             QImage Hud = buffer.getQImage(*overlay_, bg_color_);
             QPainter painter(&Hud);
+            // the texture budget may have reduced the resolution, paint in the coordinates of the full size
+            painter.scale(overlay_->getTextureScale(), overlay_->getTextureScale());
             painter.setRenderHint(QPainter::Antialiasing, true);
             painter.setPen(QPen(fg_color_, std::max(line_width_, 1), Qt::SolidLine));
-            uint16_t w = overlay_->getTextureWidth();
             uint16_t h = overlay_->getTextureHeight();
 
-            // font
-            if (text_size_ != 0) {
-                // QFont font = painter.font();
-                QFont font(font_.length() > 0 ? font_.c_str() : "Liberation Sans");
-                font.setPointSize(text_size_);
-                font.setBold(true);
-                painter.setFont(font);
-            }
+            painter.setFont(font);
             if (text_.length() > 0) {
-
                 QColor shadow_color;
                 if (invert_shadow_)
                     shadow_color = Qt::white; // fg_color_.lighter();
@@ -212,46 +314,38 @@ namespace rviz_2d_overlay_plugins {
                     shadow_color = Qt::black; // fg_color_.darker();
                 shadow_color.setAlpha(fg_color_.alpha());
 
-                std::string color_wrapped_text =
-                        (boost::format("<span style=\"color: rgba(%2%, %3%, %4%, %5%)\">%1%</span>") % text_ %
-                         fg_color_.red() % fg_color_.green() % fg_color_.blue() % fg_color_.alpha())
-                                .str();
-
-                // find a remove "color: XXX;" regex match to generate a proper shadow
-                std::regex color_tag_re("color:.+?;");
-                std::string null_char("");
-                std::string formatted_text_ = std::regex_replace(text_, color_tag_re, null_char);
-                std::string color_wrapped_shadow =
-                        (boost::format("<span style=\"color: rgba(%2%, %3%, %4%, %5%)\">%1%</span>") % formatted_text_ %
-                         shadow_color.red() % shadow_color.green() % shadow_color.blue() % shadow_color.alpha())
-                                .str();
-
-                QStaticText static_text(boost::algorithm::replace_all_copy(color_wrapped_text, "\n", "<br >").c_str());
-                static_text.setTextWidth(w);
-
-                painter.setPen(QPen(shadow_color, std::max(line_width_, 1), Qt::SolidLine));
-                QStaticText static_shadow(
-                        boost::algorithm::replace_all_copy(color_wrapped_shadow, "\n", "<br >").c_str());
-                static_shadow.setTextWidth(w);
-
-                if (!align_bottom_) {
-                    painter.drawStaticText(1, 1, static_shadow);
-                    painter.drawStaticText(0, 0, static_text);
-                } else {
-                    QStaticText only_wrapped_text(color_wrapped_text.c_str());
-                    QFontMetrics fm(painter.fontMetrics());
-                    QRect text_rect = fm.boundingRect(0, 0, w, h, Qt::TextWordWrap | Qt::AlignLeft | Qt::AlignTop,
-                                                      only_wrapped_text.text().remove(QRegExp("<[^>]*>")));
-                    painter.drawStaticText(1, h - text_rect.height() + 1, static_shadow);
-                    painter.drawStaticText(0, h - text_rect.height(), static_text);
-                }
+                // text without a color of its own is painted with the pen, colors do not require a new layout
+                const int top = align_bottom_ ? h - text_layout_.height() : 0;
+                text_layout_.draw(painter, top, fg_color_, shadow_color, line_width_);
             }
             painter.end();
         }
-        overlay_->setDimensions(overlay_->getTextureWidth(), overlay_->getTextureHeight());
+        overlay_->setDimensions(ticker_width_ > 0 ? texture_width_ : overlay_->getTextureWidth(),
+                                overlay_->getTextureHeight());
+        updateTickerCoordinates();
         require_update_texture_ = false;
     }
 
+    void OverlayTextDisplay::updateTickerCoordinates() {
+        overlay_->setTextureWrapping(ticker_width_ > 0);
+        if (ticker_width_ == 0) {
+            overlay_->setTextureCoordinates(0.0, 0.0, 1.0, 1.0);
+            return;
+        }
+        // with wrapping the texture repeats beyond 1, the end of the line is followed by its start again
+        const double u = ticker_offset_ / ticker_width_;
+        overlay_->setTextureCoordinates(u, 0.0, u + static_cast<double>(texture_width_) / ticker_width_, 1.0);
+    }
+
+    std::shared_ptr<const ResolvedFont> OverlayTextDisplay::textFont() const {
+        if (text_size_ == 0) {
+            // the application font
+            return FontCache::instance().get(QString(), QFont().pointSize());
+        }
+        const QString family = font_.length() > 0 ? font_.c_str() : "Liberation Sans";
+        return FontCache::instance().get(family, text_size_, QFont::Bold);
+    }
+
     void OverlayTextDisplay::reset() {
         RTDClass::reset();
 
@@ -260,51 +354,168 @@ namespace rviz_2d_overlay_plugins {
         }
     }
 
+    void OverlayTextDisplay::createOverlay() {
+        if (overlay_) {
+            return;
+        }
+        static int count = 0;
+        std::stringstream ss;
+        ss << "OverlayTextDisplayObject" << count++;
+        overlay_.reset(new rviz_2d_overlay_plugins::OverlayObject(ss.str()));
+        overlay_->setDownscalable(true);
+        overlay_->setTextureLostCallback([this]() { require_update_texture_ = true; });
+        overlay_->setPriority(draw_priority_property_->getInt());
+        overlay_->show();
+        updateOverlayPosition();
+        require_update_texture_ = true;
+    }
+
     void OverlayTextDisplay::processMessage(rviz_2d_overlay_msgs::msg::OverlayText::ConstSharedPtr msg) {
         if (!isEnabled()) {
             return;
         }
-        if (!overlay_) {
-            static int count = 0;
-            std::stringstream ss;
-            ss << "OverlayTextDisplayObject" << count++;
-            overlay_.reset(new rviz_2d_overlay_plugins::OverlayObject(ss.str()));
-            overlay_->show();
+        createOverlay();
+        setAction(msg->action);
+        text_id_ = msg->id;
+        text_received_ = true;
+
+        // unchanged fields neither require a new layout nor a repaint
+        setText(msg->text);
+        if (!overtake_position_properties_) {
+            setTextureSize(msg->width, msg->height);
+            setTextSize(msg->text_size);
+            setPlacement(msg->horizontal_distance, msg->vertical_distance,
+                         HorizontalAlignment{msg->horizontal_alignment}, VerticalAlignment{msg->vertical_alignment});
         }
-        if (overlay_) {
-            if (msg->action == rviz_2d_overlay_msgs::msg::OverlayText::DELETE) {
-                overlay_->hide();
-            } else if (msg->action == rviz_2d_overlay_msgs::msg::OverlayText::ADD) {
-                overlay_->show();
-            }
+        if (!overtake_bg_color_properties_) {
+            setBGColor(toQColor(msg->bg_color));
         }
+        if (!overtake_fg_color_properties_) {
+            setFGColor(toQColor(msg->fg_color));
+            setFont(msg->font);
+            setLineWidth(msg->line_width);
+        }
+    }
 
-        // store message for update method
-        text_ = msg->text;
-
+    void OverlayTextDisplay::processPatch(rviz_2d_overlay_msgs::msg::OverlayTextPatch::ConstSharedPtr patch) {
+        using Patch = rviz_2d_overlay_msgs::msg::OverlayTextPatch;
+        // a patch only changes a text received before
+        if (!isEnabled() || !overlay_ || !text_received_ || patch->id != text_id_) {
+            return;
+        }
+        if (patch->fields & Patch::ACTION) {
+            setAction(patch->action);
+        }
+        if (patch->fields & Patch::TEXT) {
+            setText(patch->text);
+        }
         if (!overtake_position_properties_) {
-            texture_width_ = msg->width;
-            texture_height_ = msg->height;
-            text_size_ = msg->text_size;
-            horizontal_dist_ = msg->horizontal_distance;
-            vertical_dist_ = msg->vertical_distance;
-
-            horizontal_alignment_ = HorizontalAlignment{msg->horizontal_alignment};
-            vertical_alignment_ = VerticalAlignment{msg->vertical_alignment};
-        }
-        if (!overtake_bg_color_properties_)
-            bg_color_ = QColor(msg->bg_color.r * 255.0, msg->bg_color.g * 255.0, msg->bg_color.b * 255.0,
-                               msg->bg_color.a * 255.0);
+            if (patch->fields & Patch::SIZE) {
+                setTextureSize(patch->width, patch->height);
+            }
+            if (patch->fields & Patch::TEXT_SIZE) {
+                setTextSize(patch->text_size);
+            }
+            if (patch->fields & Patch::POSITION) {
+                setPlacement(patch->horizontal_distance, patch->vertical_distance,
+                             HorizontalAlignment{patch->horizontal_alignment},
+                             VerticalAlignment{patch->vertical_alignment});
+            }
+        }
+        if (!overtake_bg_color_properties_ && (patch->fields & Patch::BG_COLOR)) {
+            setBGColor(toQColor(patch->bg_color));
+        }
         if (!overtake_fg_color_properties_) {
-            fg_color_ = QColor(msg->fg_color.r * 255.0, msg->fg_color.g * 255.0, msg->fg_color.b * 255.0,
-                               msg->fg_color.a * 255.0);
-            font_ = msg->font;
-            line_width_ = msg->line_width;
+            if (patch->fields & Patch::FG_COLOR) {
+                setFGColor(toQColor(patch->fg_color));
+            }
+            if (patch->fields & Patch::FONT) {
+                setFont(patch->font);
+            }
+            if (patch->fields & Patch::LINE_WIDTH) {
+                setLineWidth(patch->line_width);
+            }
+        }
+    }
+
+    void OverlayTextDisplay::setAction(uint8_t action) {
+        if (action == rviz_2d_overlay_msgs::msg::OverlayText::DELETE) {
+            overlay_->hide();
+        } else if (action == rviz_2d_overlay_msgs::msg::OverlayText::ADD) {
+            overlay_->show();
+        }
+    }
+
+    void OverlayTextDisplay::setText(const std::string &text) {
+        if (text != text_) {
+            text_ = text;
+            require_layout_ = true;
+            require_update_texture_ = true;
+        }
+    }
+
+    void OverlayTextDisplay::setTextureSize(int width, int height) {
+        if (width != texture_width_ || height != texture_height_) {
+            texture_width_ = width;
+            texture_height_ = height;
+            require_layout_ = true;
+            require_update_texture_ = true;
+        }
+    }
+
+    void OverlayTextDisplay::setTextSize(int text_size) {
+        if (text_size != text_size_) {
+            text_size_ = text_size;
+            require_layout_ = true;
+            require_update_texture_ = true;
+        }
+    }
+
+    void OverlayTextDisplay::setFont(const std::string &font) {
+        if (font != font_) {
+            font_ = font;
+            require_layout_ = true;
+            require_update_texture_ = true;
+        }
+    }
+
+    void OverlayTextDisplay::setLineWidth(int line_width) {
+        if (line_width != line_width_) {
+            line_width_ = line_width;
+            require_update_texture_ = true;
+        }
+    }
+
+    void OverlayTextDisplay::setFGColor(const QColor &color) {
+        if (color != fg_color_) {
+            fg_color_ = color;
+            require_update_texture_ = true;
+        }
+    }
+
+    void OverlayTextDisplay::setBGColor(const QColor &color) {
+        if (color != bg_color_) {
+            bg_color_ = color;
+            require_update_texture_ = true;
         }
+    }
+
+    void OverlayTextDisplay::setPlacement(int horizontal_dist, int vertical_dist,
+                                          HorizontalAlignment horizontal_alignment,
+                                          VerticalAlignment vertical_alignment) {
+        horizontal_dist_ = horizontal_dist;
+        vertical_dist_ = vertical_dist;
+        horizontal_alignment_ = horizontal_alignment;
+        vertical_alignment_ = vertical_alignment;
+        // only moves the panel, the texture is kept
+        updateOverlayPosition();
+    }
+
+    void OverlayTextDisplay::updateOverlayPosition() {
+        // applied right away, the on screen test of update() relies on the current position
         if (overlay_) {
             overlay_->setPosition(horizontal_dist_, vertical_dist_, horizontal_alignment_, vertical_alignment_);
         }
-        require_update_texture_ = true;
     }
 
     void OverlayTextDisplay::updateOvertakePositionProperties() {
@@ -317,6 +528,8 @@ namespace rviz_2d_overlay_plugins {
             updateWidth();
             updateHeight();
             updateTextSize();
+            updateOverlayPosition();
+            require_layout_ = true;
             require_update_texture_ = true;
         }
 
@@ -347,6 +560,7 @@ namespace rviz_2d_overlay_plugins {
             updateFGAlpha();
             updateFont();
             updateLineWidth();
+            require_layout_ = true;
             require_update_texture_ = true;
         }
         overtake_fg_color_properties_ = overtake_fg_color_properties_property_->getBool();
@@ -397,14 +611,14 @@ namespace rviz_2d_overlay_plugins {
     void OverlayTextDisplay::updateVerticalDistance() {
         vertical_dist_ = ver_dist_property_->getInt();
         if (overtake_position_properties_) {
-            require_update_texture_ = true;
+            updateOverlayPosition();
         }
     }
 
     void OverlayTextDisplay::updateHorizontalDistance() {
         horizontal_dist_ = hor_dist_property_->getInt();
         if (overtake_position_properties_) {
-            require_update_texture_ = true;
+            updateOverlayPosition();
         }
     }
 
@@ -412,7 +626,7 @@ namespace rviz_2d_overlay_plugins {
         vertical_alignment_ = VerticalAlignment{static_cast<uint8_t>(ver_alignment_property_->getOptionInt())};
 
         if (overtake_position_properties_) {
-            require_update_texture_ = true;
+            updateOverlayPosition();
         }
     }
 
@@ -420,13 +634,14 @@ namespace rviz_2d_overlay_plugins {
         horizontal_alignment_ = HorizontalAlignment{static_cast<uint8_t>(hor_alignment_property_->getOptionInt())};
 
         if (overtake_position_properties_) {
-            require_update_texture_ = true;
+            updateOverlayPosition();
         }
     }
 
     void OverlayTextDisplay::updateWidth() {
         texture_width_ = width_property_->getInt();
         if (overtake_position_properties_) {
+            require_layout_ = true;
             require_update_texture_ = true;
         }
     }
@@ -434,6 +649,7 @@ namespace rviz_2d_overlay_plugins {
     void OverlayTextDisplay::updateHeight() {
         texture_height_ = height_property_->getInt();
         if (overtake_position_properties_) {
+            require_layout_ = true;
             require_update_texture_ = true;
         }
     }
@@ -441,6 +657,7 @@ namespace rviz_2d_overlay_plugins {
     void OverlayTextDisplay::updateTextSize() {
         text_size_ = text_size_property_->getInt();
         if (overtake_position_properties_) {
+            require_layout_ = true;
             require_update_texture_ = true;
         }
     }
@@ -480,18 +697,19 @@ namespace rviz_2d_overlay_plugins {
     }
 
     void OverlayTextDisplay::updateFont() {
-        int font_index = font_property_->getOptionInt();
-        if (font_index < font_families_.size()) {
-            font_ = font_families_[font_index].toStdString();
-        } else {
-            RVIZ_COMMON_LOG_ERROR_STREAM("Unexpected error at selecting font index " << font_index);
-            return;
-        }
+        font_ = font_property_->getStdString();
         if (overtake_fg_color_properties_) {
+            require_layout_ = true;
             require_update_texture_ = true;
         }
     }
 
+    void OverlayTextDisplay::fillFontOptions() {
+        // the families only have to be added once
+        disconnect(font_property_, SIGNAL(requestOptions(EnumProperty*)), this, SLOT(fillFontOptions()));
+        FontCatalog::instance().fillOptions(*font_property_);
+    }
+
     void OverlayTextDisplay::updateLineWidth() {
         line_width_ = line_width_property_->getInt();
         if (overtake_fg_color_properties_) {
@@ -499,6 +717,26 @@ namespace rviz_2d_overlay_plugins {
         }
     }
 
+    void OverlayTextDisplay::updateTicker() {
+        if (ticker_ != ticker_property_->getBool()) {
+            ticker_ = ticker_property_->getBool();
+            ticker_offset_ = 0.0;
+            require_layout_ = true;
+            require_update_texture_ = true;
+        }
+    }
+
+    void OverlayTextDisplay::updateTickerSpeed() {
+        ticker_speed_ = ticker_speed_property_->getFloat();
+    }
+
+    void OverlayTextDisplay::updateDrawPriority() {
+        scheduled_draw_->setPriority(draw_priority_property_->getInt());
+        if (overlay_) {
+            overlay_->setPriority(draw_priority_property_->getInt());
+        }
+    }
+
 } // namespace rviz_2d_overlay_plugins
 
 #include <pluginlib/class_list_macros.hpp>
@@ -0,0 +1,117 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#include "overlay_text_layout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <regex>
+
+#include <QRegExp>
+#include <boost/algorithm/string.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+  bool OverlayTextLayout::isPlainText(const std::string & text)
+  {
+    return text.find_first_of("<&") == std::string::npos;
+  }
+
+  void OverlayTextLayout::layout(const std::string & text, int width, int height,
+                                 const ResolvedFont & font, const QTransform & transform)
+  {
+    plain_ = isPlainText(text);
+    if (plain_) {
+      QString plain_text = QString::fromStdString(text);
+      // the plain text layout only breaks lines at line separators
+      plain_text.replace(QLatin1Char('\n'), QChar::LineSeparator);
+      text_.setTextFormat(Qt::PlainText);
+      text_.setText(plain_text);
+      text_.setTextWidth(width);
+      text_.prepare(transform, font.font);
+      shadow_ = QStaticText();
+      width_ = static_cast<int>(std::ceil(text_.size().width()));
+      height_ = static_cast<int>(std::ceil(text_.size().height()));
+      return;
+    }
+
+    text_.setTextFormat(Qt::RichText);
+    text_.setText(QString::fromStdString(boost::algorithm::replace_all_copy(text, "\n", "<br >")));
+    text_.setTextWidth(width);
+    text_.prepare(transform, font.font);
+
+    // find a remove "color: XXX;" regex match to generate a proper shadow
+    std::regex color_tag_re("color:.+?;");
+    std::string null_char("");
+    std::string formatted_text_ = std::regex_replace(text, color_tag_re, null_char);
+    shadow_.setTextFormat(Qt::RichText);
+    shadow_.setText(QString::fromStdString(boost::algorithm::replace_all_copy(formatted_text_, "\n", "<br >")));
+    shadow_.setTextWidth(width);
+    shadow_.prepare(transform, font.font);
+
+    width_ = static_cast<int>(std::ceil(text_.size().width()));
+    if (width < 0) {
+      height_ = static_cast<int>(std::ceil(text_.size().height()));
+      return;
+    }
+    QRect text_rect = font.metrics.boundingRect(0, 0, width, height, Qt::TextWordWrap | Qt::AlignLeft | Qt::AlignTop,
+                                      QString::fromStdString(text).remove(QRegExp("<[^>]*>")));
+    height_ = text_rect.height();
+  }
+
+  void OverlayTextLayout::draw(QPainter & painter, int top, const QColor & text_color, const QColor & shadow_color,
+                               int line_width) const
+  {
+    painter.setPen(QPen(shadow_color, std::max(line_width, 1), Qt::SolidLine));
+    painter.drawStaticText(1, top + 1, plain_ ? text_ : shadow_);
+    painter.setPen(QPen(text_color, std::max(line_width, 1), Qt::SolidLine));
+    painter.drawStaticText(0, top, text_);
+  }
+
+  int OverlayTextLayout::width() const
+  {
+    return width_;
+  }
+
+  int OverlayTextLayout::height() const
+  {
+    return height_;
+  }
+
+  bool OverlayTextLayout::isPlain() const
+  {
+    return plain_;
+  }
+}  // namespace rviz_2d_overlay_plugins
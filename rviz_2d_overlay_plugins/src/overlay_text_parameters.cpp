@@ -0,0 +1,156 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "overlay_text_parameters.hpp"
+
+#include <vector>
+
+namespace rviz_2d_overlay_plugins
+{
+  void setColorFromCode(const std::string & code, std_msgs::msg::ColorRGBA & color)
+  {
+    // https://github.com/jkk-research/colors
+    color.a = 1.0;
+    if (code == "r") {  // red
+      color.r = 0.96f;
+      color.g = 0.22f;
+      color.b = 0.06f;
+    } else if (code == "g") {  // green
+      color.r = 0.30f;
+      color.g = 0.69f;
+      color.b = 0.31f;
+    } else if (code == "b") {  // blue
+      color.r = 0.02f;
+      color.g = 0.50f;
+      color.b = 0.70f;
+    } else if (code == "k") {  // black
+      color.r = 0.19f;
+      color.g = 0.19f;
+      color.b = 0.23f;
+    } else if (code == "w") {  // white
+      color.r = 0.89f;
+      color.g = 0.89f;
+      color.b = 0.93f;
+    } else if (code == "p") {  // pink
+      color.r = 0.91f;
+      color.g = 0.12f;
+      color.b = 0.39f;
+    } else {  // yellow
+      color.r = 0.94f;
+      color.g = 0.83f;
+      color.b = 0.07f;
+    }
+  }
+
+  uint8_t alignmentFromString(const std::string & alignment)
+  {
+    using rviz_2d_overlay_msgs::msg::OverlayText;
+
+    if (alignment == "right") {
+      return OverlayText::RIGHT;
+    } else if (alignment == "center") {
+      return OverlayText::CENTER;
+    } else if (alignment == "top") {
+      return OverlayText::TOP;
+    } else if (alignment == "bottom") {
+      return OverlayText::BOTTOM;
+    }
+    return OverlayText::LEFT;
+  }
+
+  bool applyOverlayTextParameter(
+    rviz_2d_overlay_msgs::msg::OverlayText & msg, const std::string & key,
+    const rclcpp::Parameter & param)
+  {
+    if (key == "fg_color") {
+      setColorFromCode(param.as_string(), msg.fg_color);
+    } else if (key == "bg_color") {
+      if (param.as_string().empty()) {
+        msg.bg_color = std_msgs::msg::ColorRGBA();
+      } else {
+        const float alpha = msg.bg_color.a;
+        setColorFromCode(param.as_string(), msg.bg_color);
+        msg.bg_color.a = alpha;
+      }
+    } else if (key == "bg_alpha") {
+      msg.bg_color.a = param.as_double();
+    } else if (key == "width") {
+      msg.width = param.as_int();
+    } else if (key == "height") {
+      msg.height = param.as_int();
+    } else if (key == "horizontal_distance") {
+      msg.horizontal_distance = param.as_int();
+    } else if (key == "vertical_distance") {
+      msg.vertical_distance = param.as_int();
+    } else if (key == "horizontal_alignment") {
+      msg.horizontal_alignment = alignmentFromString(param.as_string());
+    } else if (key == "vertical_alignment") {
+      msg.vertical_alignment = alignmentFromString(param.as_string());
+    } else if (key == "text_size") {
+      msg.text_size = param.as_double();
+    } else if (key == "font") {
+      msg.font = param.as_string();
+    } else {
+      return false;
+    }
+    return true;
+  }
+
+  void declareOverlayTextParameters(
+    rclcpp::Node & node, const std::string & prefix,
+    rviz_2d_overlay_msgs::msg::OverlayText & msg)
+  {
+    // bg_alpha before bg_color, setting the color keeps the alpha
+    const std::vector<rclcpp::Parameter> parameters{
+      rclcpp::Parameter("fg_color", node.declare_parameter<std::string>(prefix + "fg_color", "")),
+      rclcpp::Parameter("bg_alpha", node.declare_parameter<double>(prefix + "bg_alpha", 0.0)),
+      rclcpp::Parameter("bg_color", node.declare_parameter<std::string>(prefix + "bg_color", "")),
+      rclcpp::Parameter("width", node.declare_parameter<int>(prefix + "width", 200)),
+      rclcpp::Parameter("height", node.declare_parameter<int>(prefix + "height", 40)),
+      rclcpp::Parameter("horizontal_distance", node.declare_parameter<int>(prefix + "horizontal_distance", 0)),
+      rclcpp::Parameter("vertical_distance", node.declare_parameter<int>(prefix + "vertical_distance", 0)),
+      rclcpp::Parameter(
+        "horizontal_alignment", node.declare_parameter<std::string>(prefix + "horizontal_alignment", "left")),
+      rclcpp::Parameter(
+        "vertical_alignment", node.declare_parameter<std::string>(prefix + "vertical_alignment", "top")),
+      rclcpp::Parameter("text_size", node.declare_parameter<double>(prefix + "text_size", 0.0)),
+      rclcpp::Parameter("font", node.declare_parameter<std::string>(prefix + "font", "")),
+    };
+    for (const auto & param : parameters) {
+      applyOverlayTextParameter(msg, param.get_name(), param);
+    }
+  }
+}  // namespace rviz_2d_overlay_plugins
@@ -0,0 +1,273 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "overlay_texture_budget.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include <rviz_common/logging.hpp>
+
+#include "overlay_utils.hpp"
+
+namespace rviz_2d_overlay_plugins
+{
+  namespace
+  {
+    // a quarter of the resolution keeps text and plots readable
+    constexpr double MIN_TEXTURE_SCALE = 0.25;
+
+    QString megabytes(size_t bytes)
+    {
+      return QString::number(bytes / (1024.0 * 1024.0), 'f', 1) + " MB";
+    }
+  }  // namespace
+
+  OverlayTextureBudget & OverlayTextureBudget::instance()
+  {
+    static OverlayTextureBudget budget;
+    return budget;
+  }
+
+  OverlayTextureBudget::OverlayTextureBudget()
+    : budget_(256 * 1024 * 1024), hidden_release_delay_(30000), releases_(0)
+  {
+    if (const char * budget = std::getenv("RVIZ_2D_OVERLAY_TEXTURE_BUDGET_MB")) {
+      char * end = nullptr;
+      const double budget_mb = std::strtod(budget, &end);
+      if (end != budget && budget_mb >= 0.0) {
+        budget_ = static_cast<size_t>(budget_mb * 1024 * 1024);
+      } else {
+        RVIZ_COMMON_LOG_WARNING_STREAM("Ignoring invalid RVIZ_2D_OVERLAY_TEXTURE_BUDGET_MB=" << budget);
+      }
+    }
+  }
+
+  void OverlayTextureBudget::setBudget(size_t bytes)
+  {
+    budget_ = bytes;
+  }
+
+  size_t OverlayTextureBudget::budget() const
+  {
+    return budget_;
+  }
+
+  size_t OverlayTextureBudget::usage() const
+  {
+    size_t usage = 0;
+    for (const auto * overlay : overlays_) {
+      usage += overlay->getTextureBytes();
+    }
+    return usage;
+  }
+
+  void OverlayTextureBudget::setHiddenReleaseDelay(std::chrono::milliseconds delay)
+  {
+    hidden_release_delay_ = delay;
+  }
+
+  std::chrono::milliseconds OverlayTextureBudget::hiddenReleaseDelay() const
+  {
+    return hidden_release_delay_;
+  }
+
+  uint64_t OverlayTextureBudget::releases() const
+  {
+    return releases_;
+  }
+
+  void OverlayTextureBudget::add(OverlayObject * overlay)
+  {
+    overlays_.push_back(overlay);
+  }
+
+  void OverlayTextureBudget::remove(OverlayObject * overlay)
+  {
+    overlays_.erase(std::remove(overlays_.begin(), overlays_.end(), overlay), overlays_.end());
+  }
+
+  size_t OverlayTextureBudget::plannedBytes(const OverlayObject & overlay, double scale)
+  {
+    if (!overlay.isTextureReady()) {
+      return 0;
+    }
+    const size_t width = std::max(1L, std::lround(overlay.requested_width_ * std::min(scale, 1.0)));
+    const size_t height = std::max(1L, std::lround(overlay.requested_height_ * std::min(scale, 1.0)));
+    return width * height * Ogre::PixelUtil::getNumElemBytes(overlay.texture_->getFormat());
+  }
+
+  void OverlayTextureBudget::notifyTextureLost(OverlayObject & overlay)
+  {
+    if (overlay.texture_lost_callback_) {
+      overlay.texture_lost_callback_();
+    }
+  }
+
+  void OverlayTextureBudget::releaseHiddenTextures()
+  {
+    const auto now = std::chrono::steady_clock::now();
+    for (auto * overlay : overlays_) {
+      if (!overlay->isTextureReady() || overlay->isOnScreen()) {
+        overlay->off_screen_ = false;
+        continue;
+      }
+      if (!overlay->off_screen_) {
+        overlay->off_screen_ = true;
+        overlay->off_screen_since_ = now;
+      } else if (now - overlay->off_screen_since_ > hidden_release_delay_) {
+        overlay->releaseTexture();
+        overlay->off_screen_ = false;
+        releases_++;
+        notifyTextureLost(*overlay);
+      }
+    }
+  }
+
+  void OverlayTextureBudget::enforce()
+  {
+    releaseHiddenTextures();
+    if (budget_ == 0) {
+      return;
+    }
+    // downscaled textures are accounted with their new size, even if they are not painted yet
+    size_t usage = 0;
+    bool downscaled = false;
+    for (const auto * overlay : overlays_) {
+      usage += plannedBytes(*overlay, overlay->texture_scale_);
+      downscaled = downscaled || overlay->texture_scale_ < 1.0;
+    }
+    if (usage <= budget_ && !downscaled) {
+      return;
+    }
+
+    if (usage > budget_) {
+      // hidden and off-screen overlays are painted again once they are visible, their textures go first
+      for (auto * overlay : overlays_) {
+        if (usage <= budget_) {
+          break;
+        }
+        if (!overlay->isOnScreen() && overlay->isTextureReady()) {
+          usage -= plannedBytes(*overlay, overlay->texture_scale_);
+          overlay->releaseTexture();
+          releases_++;
+          notifyTextureLost(*overlay);
+        }
+      }
+    }
+
+    candidates_.clear();
+    for (auto * overlay : overlays_) {
+      if (overlay->downscalable_ && overlay->isTextureReady()) {
+        candidates_.push_back(overlay);
+      }
+    }
+
+    if (usage > budget_) {
+      // halve the resolution of the lowest priority overlays, the largest texture first
+      std::sort(candidates_.begin(), candidates_.end(), [](const OverlayObject * a, const OverlayObject * b) {
+        if (a->priority_ != b->priority_) {
+          return a->priority_ < b->priority_;
+        }
+        return a->requested_width_ * a->requested_height_ > b->requested_width_ * b->requested_height_;
+      });
+      for (auto * overlay : candidates_) {
+        if (usage <= budget_) {
+          break;
+        }
+        const double scale = overlay->texture_scale_;
+        double new_scale = scale;
+        size_t bytes = plannedBytes(*overlay, scale);
+        while (usage > budget_ && new_scale / 2 >= MIN_TEXTURE_SCALE) {
+          new_scale /= 2;
+          const size_t new_bytes = plannedBytes(*overlay, new_scale);
+          usage -= bytes - new_bytes;
+          bytes = new_bytes;
+        }
+        if (new_scale != scale) {
+          overlay->setTextureScale(new_scale);
+          notifyTextureLost(*overlay);
+          RVIZ_COMMON_LOG_INFO_STREAM(
+            "Overlay texture budget of " << budget_ / (1024 * 1024) << " MB exceeded, reduced the resolution of "
+                                         << overlay->getName() << " to " << new_scale * 100 << " %");
+        }
+      }
+    } else {
+      // full resolution where it fits again, the highest priority first
+      std::sort(candidates_.begin(), candidates_.end(), [](const OverlayObject * a, const OverlayObject * b) {
+        return a->priority_ > b->priority_;
+      });
+      for (auto * overlay : candidates_) {
+        if (overlay->texture_scale_ >= 1.0) {
+          continue;
+        }
+        const size_t bytes = plannedBytes(*overlay, overlay->texture_scale_);
+        const size_t full_bytes = plannedBytes(*overlay, 1.0);
+        if (usage - bytes + full_bytes <= budget_) {
+          usage = usage - bytes + full_bytes;
+          overlay->setTextureScale(1.0);
+          notifyTextureLost(*overlay);
+        }
+      }
+    }
+  }
+
+  void reportTextureUsage(rviz_common::Display & display, const OverlayObject & overlay, ReportedTextureUsage & reported)
+  {
+    const OverlayTextureBudget & budget = OverlayTextureBudget::instance();
+    const size_t overlay_bytes = overlay.getTextureBytes();
+    const size_t total_bytes = budget.usage();
+    const double scale = overlay.getTextureScale();
+    if (overlay_bytes == reported.overlay_bytes && total_bytes == reported.total_bytes && scale == reported.scale) {
+      return;
+    }
+    reported.overlay_bytes = overlay_bytes;
+    reported.total_bytes = total_bytes;
+    reported.scale = scale;
+
+    QString text = megabytes(overlay_bytes) + ", all overlays " + megabytes(total_bytes);
+    if (budget.budget() > 0) {
+      text += " of " + megabytes(budget.budget());
+    }
+    if (scale < 1.0) {
+      text += QString(", resolution reduced to %1 % by the texture budget").arg(scale * 100);
+    }
+    display.setStatus(
+      scale < 1.0 ? rviz_common::properties::StatusProperty::Warn : rviz_common::properties::StatusProperty::Ok,
+      "Texture memory", text);
+  }
+}  // namespace rviz_2d_overlay_plugins
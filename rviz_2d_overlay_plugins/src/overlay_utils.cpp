@@ -36,14 +36,25 @@
 
 #include "overlay_utils.hpp"
 
+#include <algorithm>
+#include <cmath>
+
+#include <OgreTextureUnitState.h>
 #include <rviz_common/logging.hpp>
 
+#include "overlay_texture_budget.hpp"
+
 namespace rviz_2d_overlay_plugins {
     ScopedPixelBuffer::ScopedPixelBuffer(Ogre::HardwarePixelBufferSharedPtr pixel_buffer) :
         pixel_buffer_(pixel_buffer) {
         pixel_buffer_->lock(Ogre::HardwareBuffer::HBL_NORMAL);
     }
 
+    ScopedPixelBuffer::ScopedPixelBuffer(Ogre::HardwarePixelBufferSharedPtr pixel_buffer, const Ogre::Box &region) :
+        pixel_buffer_(pixel_buffer) {
+        pixel_buffer_->lock(region, Ogre::HardwareBuffer::HBL_NORMAL);
+    }
+
     ScopedPixelBuffer::~ScopedPixelBuffer() {
         pixel_buffer_->unlock();
     }
@@ -69,15 +80,27 @@ namespace rviz_2d_overlay_plugins {
         return Hud;
     }
 
-    QImage ScopedPixelBuffer::getQImage(OverlayObject &overlay) {
-        return getQImage(overlay.getTextureWidth(), overlay.getTextureHeight());
+    QImage ScopedPixelBuffer::getRegionQImage() {
+        const Ogre::PixelBox &pixelBox = pixel_buffer_->getCurrentLock();
+        // the row pitch is given in pixels, QImage expects bytes per line
+        return QImage(static_cast<Ogre::uint8 *>(pixelBox.data), pixelBox.getWidth(), pixelBox.getHeight(),
+                      pixelBox.rowPitch * Ogre::PixelUtil::getNumElemBytes(pixelBox.format), QImage::Format_ARGB32);
+    }
+
+    // the size of the pixel buffer differs from the requested texture size if the texture is downscaled
+    QImage ScopedPixelBuffer::getQImage(OverlayObject & /*overlay*/) {
+        return getQImage(pixel_buffer_->getWidth(), pixel_buffer_->getHeight());
     }
 
-    QImage ScopedPixelBuffer::getQImage(OverlayObject &overlay, QColor &bg_color) {
-        return getQImage(overlay.getTextureWidth(), overlay.getTextureHeight(), bg_color);
+    QImage ScopedPixelBuffer::getQImage(OverlayObject & /*overlay*/, QColor &bg_color) {
+        QImage Hud = getQImage(pixel_buffer_->getWidth(), pixel_buffer_->getHeight());
+        Hud.fill(bg_color);
+        return Hud;
     }
 
-    OverlayObject::OverlayObject(const std::string &name) : name_(name) {
+    OverlayObject::OverlayObject(const std::string &name)
+        : name_(name), requested_width_(0), requested_height_(0), priority_(0), downscalable_(false),
+          texture_scale_(1.0), texture_wrapping_(false), off_screen_(false) {
         std::string material_name = name_ + "Material";
         Ogre::OverlayManager *mOverlayMgr = Ogre::OverlayManager::getSingletonPtr();
         overlay_ = mOverlayMgr->create(name_);
@@ -88,9 +111,13 @@ namespace rviz_2d_overlay_plugins {
                 material_name, Ogre::ResourceGroupManager::DEFAULT_RESOURCE_GROUP_NAME);
         panel_->setMaterialName(panel_material_->getName());
         overlay_->add2D(panel_);
+        OverlayTextureBudget::instance().add(this);
     }
 
     OverlayObject::~OverlayObject() {
+        OverlayTextureBudget::instance().remove(this);
+        // the texture manager keeps the texture alive otherwise
+        releaseTexture();
         Ogre::OverlayManager *mOverlayMgr = Ogre::OverlayManager::getSingletonPtr();
         if (mOverlayMgr) {
             mOverlayMgr->destroyOverlayElement(panel_);
@@ -122,7 +149,7 @@ namespace rviz_2d_overlay_plugins {
         return texture_ != nullptr;
     }
 
-    void OverlayObject::updateTextureSize(unsigned int width, unsigned int height) {
+    void OverlayObject::updateTextureSize(unsigned int width, unsigned int height, Ogre::PixelFormat format) {
         const std::string texture_name = name_ + "Texture";
         if (width == 0) {
             RVIZ_COMMON_LOG_WARNING_STREAM("[OverlayObject] width=0 is specified as texture size");
@@ -134,7 +161,15 @@ namespace rviz_2d_overlay_plugins {
             height = 1;
         }
 
-        if (!isTextureReady() || ((width != texture_->getWidth()) || (height != texture_->getHeight()))) {
+        requested_width_ = width;
+        requested_height_ = height;
+        if (texture_scale_ < 1.0) {
+            width = std::max(1u, static_cast<unsigned int>(std::lround(width * texture_scale_)));
+            height = std::max(1u, static_cast<unsigned int>(std::lround(height * texture_scale_)));
+        }
+
+        if (!isTextureReady() || ((width != texture_->getWidth()) || (height != texture_->getHeight())) ||
+            format != texture_->getFormat()) {
             if (isTextureReady()) {
                 Ogre::TextureManager::getSingleton().remove(texture_name);
                 panel_material_->getTechnique(0)->getPass(0)->removeAllTextureUnitStates();
@@ -146,12 +181,14 @@ namespace rviz_2d_overlay_plugins {
                     Ogre::TEX_TYPE_2D, // type
                     width, height,     // width & height of the render window
                     0,                 // number of mipmaps
-                    Ogre::PF_A8R8G8B8, // pixel format chosen to match a format Qt can use
+                    format,            // PF_A8R8G8B8 by default, matching a format Qt can use
                     Ogre::TU_DEFAULT   // usage
             );
             panel_material_->getTechnique(0)->getPass(0)->createTextureUnitState(texture_name);
+            applyTextureWrapping();
 
             panel_material_->getTechnique(0)->getPass(0)->setSceneBlending(Ogre::SBT_TRANSPARENT_ALPHA);
+            panel_->show();
         }
     }
 
@@ -163,6 +200,14 @@ namespace rviz_2d_overlay_plugins {
         }
     }
 
+    ScopedPixelBuffer OverlayObject::getBuffer(const Ogre::Box &region) {
+        if (isTextureReady()) {
+            return ScopedPixelBuffer(texture_->getBuffer(), region);
+        } else {
+            return ScopedPixelBuffer(Ogre::HardwarePixelBufferSharedPtr());
+        }
+    }
+
     void OverlayObject::setPosition(double hor_dist, double ver_dist, HorizontalAlignment hor_alignment,
                                     VerticalAlignment ver_alignment) {
         // ogre position is always based on the top left corner of the panel, while our position input
@@ -208,13 +253,46 @@ namespace rviz_2d_overlay_plugins {
         panel_->setDimensions(width, height);
     }
 
+    void OverlayObject::setTextureCoordinates(double u1, double v1, double u2, double v2) {
+        panel_->setUV(u1, v1, u2, v2);
+    }
+
     bool OverlayObject::isVisible() const {
         return overlay_->isVisible();
     }
 
+    bool OverlayObject::isOnScreen() const {
+        if (!isVisible()) {
+            return false;
+        }
+        const Ogre::OverlayManager &overlay_manager = Ogre::OverlayManager::getSingleton();
+        const double viewport_width = overlay_manager.getViewportWidth();
+        const double viewport_height = overlay_manager.getViewportHeight();
+        // nothing rendered yet or never painted, the position is not known
+        if (viewport_width <= 0 || viewport_height <= 0 || panel_->getWidth() <= 0 || panel_->getHeight() <= 0) {
+            return true;
+        }
+
+        // in pixel metrics mode the position is relative to the aligned border
+        double left = panel_->getLeft();
+        if (panel_->getHorizontalAlignment() == Ogre::GHA_CENTER) {
+            left += viewport_width / 2;
+        } else if (panel_->getHorizontalAlignment() == Ogre::GHA_RIGHT) {
+            left += viewport_width;
+        }
+        double top = panel_->getTop();
+        if (panel_->getVerticalAlignment() == Ogre::GVA_CENTER) {
+            top += viewport_height / 2;
+        } else if (panel_->getVerticalAlignment() == Ogre::GVA_BOTTOM) {
+            top += viewport_height;
+        }
+        return left < viewport_width && left + panel_->getWidth() > 0 &&
+               top < viewport_height && top + panel_->getHeight() > 0;
+    }
+
     unsigned int OverlayObject::getTextureWidth() const {
         if (isTextureReady()) {
-            return texture_->getWidth();
+            return requested_width_;
         } else {
             return 0;
         }
@@ -222,9 +300,84 @@ namespace rviz_2d_overlay_plugins {
 
     unsigned int OverlayObject::getTextureHeight() const {
         if (isTextureReady()) {
-            return texture_->getHeight();
+            return requested_height_;
         } else {
             return 0;
         }
     }
+
+    size_t OverlayObject::getTextureBytes() const {
+        if (isTextureReady()) {
+            // without mipmaps
+            return Ogre::PixelUtil::getMemorySize(texture_->getWidth(), texture_->getHeight(), 1,
+                                                  texture_->getFormat());
+        } else {
+            return 0;
+        }
+    }
+
+    void OverlayObject::releaseTexture() {
+        if (!isTextureReady()) {
+            return;
+        }
+        // the panel would show the material without texture until the overlay is painted again
+        panel_->hide();
+        if (panel_material_) {
+            panel_material_->getTechnique(0)->getPass(0)->removeAllTextureUnitStates();
+        }
+        Ogre::TextureManager::getSingleton().remove(texture_->getHandle());
+        texture_.reset();
+    }
+
+    void OverlayObject::setZOrder(unsigned short z_order) {
+        overlay_->setZOrder(z_order);
+    }
+
+    void OverlayObject::setPriority(int priority) {
+        priority_ = priority;
+    }
+
+    int OverlayObject::getPriority() const {
+        return priority_;
+    }
+
+    void OverlayObject::setTextureWrapping(bool wrapping) {
+        if (wrapping == texture_wrapping_) {
+            return;
+        }
+        texture_wrapping_ = wrapping;
+        if (isTextureReady()) {
+            applyTextureWrapping();
+        }
+    }
+
+    void OverlayObject::applyTextureWrapping() {
+        // clamped by default, with bilinear filtering wrapping would blend the opposite edge into the borders of
+        // panels whose size differs from the texture
+        panel_material_->getTechnique(0)->getPass(0)->getTextureUnitState(0)->setTextureAddressingMode(
+                texture_wrapping_ ? Ogre::TextureUnitState::TAM_WRAP : Ogre::TextureUnitState::TAM_CLAMP);
+    }
+
+    void OverlayObject::setDownscalable(bool downscalable) {
+        downscalable_ = downscalable;
+        if (!downscalable_) {
+            setTextureScale(1.0);
+        }
+    }
+
+    bool OverlayObject::isDownscalable() const {
+        return downscalable_;
+    }
+
+    void OverlayObject::setTextureScale(double scale) {
+        texture_scale_ = std::min(scale, 1.0);
+    }
+
+    double OverlayObject::getTextureScale() const {
+        return texture_scale_;
+    }
+
+    void OverlayObject::setTextureLostCallback(std::function<void()> callback) {
+        texture_lost_callback_ = std::move(callback);
+    }
 } // namespace rviz_2d_overlay_plugins
@@ -35,6 +35,7 @@
  *********************************************************************/
 
 #include "pie_chart_display.h"
+#include "font_cache.hpp"
 
 #include <OgreMaterialManager.h>
 #include <OgreTextureManager.h>
@@ -43,11 +44,17 @@
 #include <OgreHardwarePixelBuffer.h>
 #include <rviz_rendering/render_system.hpp>
 #include <QPainter>
+#include <QRegion>
+#include <cmath>
 
 namespace rviz_2d_overlay_plugins
 {
 
-    PieChartDisplay::PieChartDisplay() : data_(0.0), update_required_(false), first_time_(true) {
+    PieChartDisplay::PieChartDisplay()
+      : data_(0.0), update_required_(false), value_update_required_(false), first_time_(true),
+        reported_deadline_misses_(0), shape_(GaugeShape::CIRCLE), drawn_color_(0), atlas_steps_(1),
+        atlas_columns_(1), animated_value_(0.0), animation_target_(0.0), animation_settled_(true),
+        animation_dt_(0.0) {
     size_property_ = new rviz_common::properties::IntProperty("size", 128,
                                            "size of the plotter window",
                                            this, SLOT(updateSize()));
@@ -125,10 +132,39 @@ namespace rviz_2d_overlay_plugins
                                false,
                                "change the rotate direction",
                                this, SLOT(updateClockwiseRotate()));
+
+    shape_property_
+      = new rviz_common::properties::EnumProperty("shape", "circle",
+                               "shape of the gauge, bars only repaint the changed part of the bar",
+                               this, SLOT(updateShape()));
+    shape_property_->addOption("circle", static_cast<int>(GaugeShape::CIRCLE));
+    shape_property_->addOption("horizontal bar", static_cast<int>(GaugeShape::HORIZONTAL_BAR));
+    shape_property_->addOption("vertical bar", static_cast<int>(GaugeShape::VERTICAL_BAR));
+
+    smooth_property_
+      = new rviz_common::properties::BoolProperty("smooth value changes", false,
+                               "animate value changes using pre-rendered gauge images instead of jumping",
+                               this, SLOT(updateSmooth()));
+    smoothing_time_property_
+      = new rviz_common::properties::FloatProperty("smoothing time", 0.2,
+                                "time constant of the animation in seconds",
+                                smooth_property_, SLOT(updateSmoothingTime()), this);
+    smoothing_time_property_->setMin(0.0);
+    animation_steps_property_
+      = new rviz_common::properties::IntProperty("animation steps", 32,
+                              "number of pre-rendered gauge images between min and max value",
+                              smooth_property_, SLOT(updateAnimationSteps()), this);
+    animation_steps_property_->setMin(2);
+    animation_steps_property_->setMax(256);
+    draw_priority_property_
+      = new rviz_common::properties::IntProperty("draw priority", 0,
+                              "overlays with higher priority are drawn first if not all overlays can be drawn within a frame",
+                              this, SLOT(updateDrawPriority()));
   }
 
   PieChartDisplay::~PieChartDisplay()
   {
+    scheduled_draw_.reset();
     if (overlay_->isVisible()) {
       overlay_->hide();
     }
@@ -136,12 +172,23 @@ namespace rviz_2d_overlay_plugins
 
   void PieChartDisplay::onInitialize()
   {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": initialize");
     RTDClass::onInitialize();
     rviz_rendering::RenderSystem::get()->prepareOverlays(scene_manager_);
+    initializeOverlay();
+  }
+
+  void PieChartDisplay::initializeOverlay()
+  {
     static int count = 0;
     std::stringstream ss;
     ss << "PieChartDisplayObject" << count++;
     overlay_.reset(new rviz_2d_overlay_plugins::OverlayObject(ss.str()));
+    scheduled_draw_ = ScheduledDraw::create([this]() {drawOverlay();});
+    overlay_->setTextureLostCallback([this]() {
+      std::lock_guard lock(mutex_);
+      update_required_ = true;
+    });
     onEnable();
     updateSize();
     updateLeft();
@@ -161,17 +208,61 @@ namespace rviz_2d_overlay_plugins
     updateMaxColorThreshold();
     updateMedColorThreshold();
     updateClockwiseRotate();
-    overlay_->updateTextureSize(texture_size_, texture_size_ + caption_offset_);
+    updateShape();
+    updateSmooth();
+    updateSmoothingTime();
+    updateAnimationSteps();
+    updateDrawPriority();
     overlay_->hide();
   }
 
-  void PieChartDisplay::update(float /* wall_dt */, float /* ros_dt */) {
+  void PieChartDisplay::load(const rviz_common::Config & config)
+  {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": load config");
+    RTDClass::load(config);
+  }
+
+  void PieChartDisplay::updateTopic()
+  {
+    property_batch_.run("topic", [this]() {RTDClass::updateTopic();});
+  }
+
+  void PieChartDisplay::update(float wall_dt, float /* ros_dt */) {
+      reportDeadlineMisses(*this, *scheduled_draw_, reported_deadline_misses_);
+      reportTextureUsage(*this, *overlay_, reported_texture_usage_);
+      if (!update_required_ && !value_update_required_ && (!smooth_ || animation_settled_)) {
+          animation_dt_ = 0.0;
+          return;
+      }
+      // wall_dt is given in nanoseconds, accumulated while the draw is deferred or the gauge is off screen
+      animation_dt_ += wall_dt * 1e-9;
+      if (overlay_->isOnScreen()) {
+          scheduled_draw_->requestDraw();
+      }
+  }
+
+  void PieChartDisplay::drawOverlay() {
+      std::lock_guard lock(mutex_);
+      if (smooth_) {
+          updateAnimation(animation_dt_);
+          animation_dt_ = 0.0;
+          return;
+      }
       if (update_required_) {
           update_required_ = false;
-          overlay_->updateTextureSize(texture_size_, texture_size_ + caption_offset_);
+          value_update_required_ = false;
+          overlay_->updateTextureSize(textureWidth(), textureHeight());
+          overlay_->setTextureCoordinates(0.0, 0.0, 1.0, 1.0);
           overlay_->setPosition(left_, top_);
           overlay_->setDimensions(overlay_->getTextureWidth(), overlay_->getTextureHeight());
           drawPlot(data_);
+      } else if (value_update_required_) {
+          value_update_required_ = false;
+          if (shape_ == GaugeShape::CIRCLE) {
+              drawPlot(data_);
+          } else {
+              drawBarDelta(data_);
+          }
       }
   }
 
@@ -185,107 +276,273 @@ namespace rviz_2d_overlay_plugins
     if (data_ != msg->data || first_time_) {
       first_time_ = false;
       data_ = msg->data;
-      update_required_ = true;
+      value_update_required_ = true;
     }
   }
   
+  GaugeStyle PieChartDisplay::gaugeStyle() const
+  {
+    GaugeStyle style;
+    style.fg_color = fg_color_;
+    style.bg_color = bg_color_;
+    style.max_color = max_color_;
+    style.med_color = med_color_;
+    style.fg_alpha = fg_alpha_;
+    style.fg_alpha2 = fg_alpha2_;
+    style.bg_alpha = bg_alpha_;
+    style.min_value = min_value_;
+    style.max_value = max_value_;
+    style.max_color_threshold = max_color_threshold_;
+    style.med_color_threshold = med_color_threshold_;
+    style.auto_color_change = auto_color_change_;
+    style.clockwise_rotate = clockwise_rotate_;
+    style.text_size = text_size_;
+    return style;
+  }
+
   void PieChartDisplay::drawPlot(double val)
   {
-    QColor fg_color(fg_color_);
+    QColor bg_color(bg_color_);
+    bg_color.setAlpha(bg_alpha_);
+    {
+      rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer();
+      QImage Hud = buffer.getQImage(*overlay_, bg_color);
+      QPainter painter( &Hud );
+      painter.setRenderHint(QPainter::Antialiasing, true);
+      paintGauge(painter, val);
 
-    if (auto_color_change_) {
-      double r
-        = std::min(1.0, fabs((val - min_value_) / (max_value_ - min_value_)));
-      if (r > 0.6) {
-        double r2 = (r - 0.6) / 0.4;
-        fg_color.setRed((max_color_.red() - fg_color_.red()) * r2
-                        + fg_color_.red());
-        fg_color.setGreen((max_color_.green() - fg_color_.green()) * r2
-                          + fg_color_.green());
-        fg_color.setBlue((max_color_.blue() - fg_color_.blue()) * r2
-                         + fg_color_.blue());
-      }
-      if (max_color_threshold_ != 0) {
-        if (r > max_color_threshold_) {
-        fg_color.setRed(max_color_.red());
-        fg_color.setGreen(max_color_.green());
-        fg_color.setBlue(max_color_.blue());
-        }
-      }
-      if (med_color_threshold_ != 0) {
-        if (max_color_threshold_ > r and r > med_color_threshold_ ) {
-        fg_color.setRed(med_color_.red());
-        fg_color.setGreen(med_color_.green());
-        fg_color.setBlue(med_color_.blue());
-        }
-      }
+      // done
+      painter.end();
+      // Unlock the pixel buffer
+    }
+    if (shape_ != GaugeShape::CIRCLE) {
+      const GaugeStyle style = gaugeStyle();
+      drawn_fill_ = barGaugeFillRect(barGaugeInnerRect(barRect()), val, shape_ == GaugeShape::VERTICAL_BAR, style);
+      drawn_color_ = gaugeValueColor(style, val).rgb();
     }
+  }
+
+  void PieChartDisplay::paintGauge(QPainter & painter, double val)
+  {
+    const GaugeStyle style = gaugeStyle();
+    const QColor fg_color = gaugeValueColor(style, val);
+    if (shape_ == GaugeShape::CIRCLE) {
+      const QRect cell(0, 0, textureWidth(), textureHeight());
+      drawGaugeRing(painter, cell, caption_offset_, fg_color, style);
+      drawGaugeValue(painter, cell, caption_offset_, fg_color, val,
+                     show_caption_ ? getName() : QString(), style);
+    } else {
+      drawBarGauge(painter, barRect(), shape_ == GaugeShape::VERTICAL_BAR, fg_color, val, style);
+      drawBarLabels(painter, fg_color, val, style);
+    }
+  }
+
+  void PieChartDisplay::drawAnimationAtlas()
+  {
+    // keep the atlas within a texture size every GPU supports
+    const int max_texture_size = 4096;
+    const int cell_width = textureWidth();
+    const int cell_height = textureHeight();
+    const int max_columns = std::max(1, max_texture_size / cell_width);
+    const int max_rows = std::max(1, max_texture_size / cell_height);
+    // one cell per animation step, plus one cell for the exact value after settling
+    const int cell_count = std::min(animation_steps_ + 1, max_columns * max_rows);
+    atlas_steps_ = std::max(cell_count - 1, 1);
+    // close to square, but with enough columns to stay within max_rows for tall cells
+    atlas_columns_ = std::max((cell_count + max_rows - 1) / max_rows,
+                              std::min(static_cast<int>(std::ceil(std::sqrt(cell_count))), max_columns));
+    const int rows = (cell_count + atlas_columns_ - 1) / atlas_columns_;
+    overlay_->updateTextureSize(atlas_columns_ * cell_width, rows * cell_height);
 
-    
-    QColor fg_color2(fg_color);
     QColor bg_color(bg_color_);
-    fg_color.setAlpha(fg_alpha_);
-    fg_color2.setAlpha(fg_alpha2_);
     bg_color.setAlpha(bg_alpha_);
-    int width = overlay_->getTextureWidth();
-    int height = overlay_->getTextureHeight();
     {
       rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer();
       QImage Hud = buffer.getQImage(*overlay_, bg_color);
       QPainter painter( &Hud );
       painter.setRenderHint(QPainter::Antialiasing, true);
+      for (int i = 0; i < atlas_steps_; i++) {
+        painter.save();
+        painter.translate(atlasCell(i).topLeft());
+        paintGauge(painter, atlasStepValue(i));
+        painter.restore();
+      }
+      painter.end();
+    }
+  }
 
-      const int outer_line_width = 5;
-      const int value_line_width = 10;
-      const int value_indicator_line_width = 2;
-      const int value_padding = 5;
-
-      const int value_aabb_offset
-        = outer_line_width + value_padding + value_line_width / 2;
-      
-      painter.setPen(QPen(fg_color, outer_line_width, Qt::SolidLine));
-
-      painter.drawEllipse(outer_line_width / 2, outer_line_width / 2,
-                          width - outer_line_width ,
-                          height - outer_line_width - caption_offset_);
-
-      painter.setPen(QPen(fg_color2, value_indicator_line_width, Qt::SolidLine));
-      painter.drawEllipse(value_aabb_offset, value_aabb_offset,
-                          width - value_aabb_offset * 2,
-                          height - value_aabb_offset * 2 - caption_offset_);
-
-      const double ratio = (val - min_value_) / (max_value_ - min_value_);
-      const double rotate_direction = clockwise_rotate_ ? -1.0 : 1.0;
-      const double ratio_angle = ratio * 360.0 * rotate_direction;
-      const double start_angle_offset = -90;
-      painter.setPen(QPen(fg_color, value_line_width, Qt::SolidLine));
-      painter.drawArc(QRectF(value_aabb_offset, value_aabb_offset,
-                             width - value_aabb_offset * 2,
-                             height - value_aabb_offset * 2 - caption_offset_),
-                      start_angle_offset * 16 ,
-                      ratio_angle * 16);
-      QFont font = painter.font();
-      font.setPointSize(text_size_);
-      font.setBold(true);
-      painter.setFont(font);
-      painter.setPen(QPen(fg_color, value_line_width, Qt::SolidLine));
-      std::ostringstream s;
-      s << std::fixed << std::setprecision(2) << val;
-      painter.drawText(0, 0, width, height - caption_offset_,
-                       Qt::AlignCenter | Qt::AlignVCenter,
-                       s.str().c_str());
-
-      // caption
+  void PieChartDisplay::drawAnimationAtlasCell(int index, double val)
+  {
+    const QRect cell = atlasCell(index);
+    QColor bg_color(bg_color_);
+    bg_color.setAlpha(bg_alpha_);
+    {
+      rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer(
+        Ogre::Box(cell.left(), cell.top(), cell.right() + 1, cell.bottom() + 1));
+      QImage region = buffer.getRegionQImage();
+      region.fill(bg_color);
+      QPainter painter(&region);
+      painter.setRenderHint(QPainter::Antialiasing, true);
+      paintGauge(painter, val);
+      painter.end();
+    }
+  }
+
+  QRect PieChartDisplay::atlasCell(int index) const
+  {
+    return QRect((index % atlas_columns_) * textureWidth(), (index / atlas_columns_) * textureHeight(),
+                 textureWidth(), textureHeight());
+  }
+
+  double PieChartDisplay::atlasStepValue(int index) const
+  {
+    return min_value_ + (max_value_ - min_value_) * index / std::max(atlas_steps_ - 1, 1);
+  }
+
+  void PieChartDisplay::showAnimationAtlasCell(int index)
+  {
+    const QRect cell = atlasCell(index);
+    const double texture_width = overlay_->getTextureWidth();
+    const double texture_height = overlay_->getTextureHeight();
+    overlay_->setTextureCoordinates(cell.left() / texture_width, cell.top() / texture_height,
+                                    (cell.right() + 1) / texture_width, (cell.bottom() + 1) / texture_height);
+  }
+
+  void PieChartDisplay::updateAnimation(double wall_dt)
+  {
+    if (update_required_) {
+      update_required_ = false;
+      drawAnimationAtlas();
+      overlay_->setPosition(left_, top_);
+      overlay_->setDimensions(textureWidth(), textureHeight());
+      animated_value_ = data_;
+      value_update_required_ = true;
+    }
+    if (value_update_required_) {
+      value_update_required_ = false;
+      animation_target_ = data_;
+      animation_settled_ = false;
+    }
+    if (animation_settled_) {
+      return;
+    }
+
+    if (smoothing_time_ > 0.0) {
+      animated_value_ += (animation_target_ - animated_value_) * (1.0 - std::exp(-wall_dt / smoothing_time_));
+    } else {
+      animated_value_ = animation_target_;
+    }
+
+    const double step = (max_value_ - min_value_) / std::max(atlas_steps_ - 1, 1);
+    if (std::abs(animation_target_ - animated_value_) <= std::abs(step) / 2) {
+      // the only raster per value change: the exact value into the spare cell
+      animated_value_ = animation_target_;
+      drawAnimationAtlasCell(atlas_steps_, animation_target_);
+      showAnimationAtlasCell(atlas_steps_);
+      animation_settled_ = true;
+    } else {
+      const long index = std::lround((animated_value_ - min_value_) / step);
+      showAnimationAtlasCell(std::min<long>(std::max<long>(index, 0), atlas_steps_ - 1));
+    }
+  }
+
+  void PieChartDisplay::drawBarDelta(double val)
+  {
+    const GaugeStyle style = gaugeStyle();
+    const QColor fg_color = gaugeValueColor(style, val);
+    if (fg_color.rgb() != drawn_color_) {
+      // the color of the whole bar changes
+      drawPlot(val);
+      return;
+    }
+
+    const bool vertical = shape_ == GaugeShape::VERTICAL_BAR;
+    const QRect fill = barGaugeFillRect(barGaugeInnerRect(barRect()), val, vertical, style);
+    // both fills start at the same edge, so the difference is a single strip
+    const QRect strip = QRegion(fill).xored(QRegion(drawn_fill_)).boundingRect();
+    if (!strip.isEmpty()) {
+      const bool grows = fill.contains(strip);
+      QColor strip_color(grows ? fg_color : bg_color_);
+      strip_color.setAlpha(grows ? fg_alpha_ : bg_alpha_);
+      rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer(
+        Ogre::Box(strip.left(), strip.top(), strip.right() + 1, strip.bottom() + 1));
+      QImage region = buffer.getRegionQImage();
+      region.fill(strip_color);
+    }
+    drawn_fill_ = fill;
+
+    const QRect label = valueLabelRect();
+    QColor bg_color(bg_color_);
+    bg_color.setAlpha(bg_alpha_);
+    {
+      rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer(
+        Ogre::Box(label.left(), label.top(), label.right() + 1, label.bottom() + 1));
+      QImage region = buffer.getRegionQImage();
+      region.fill(bg_color);
+      QPainter painter(&region);
+      painter.setRenderHint(QPainter::Antialiasing, true);
+      painter.translate(-label.topLeft());
+      drawBarLabels(painter, fg_color, val, style);
+      painter.end();
+    }
+  }
+
+  void PieChartDisplay::drawBarLabels(QPainter & painter, const QColor & value_color, double val,
+                                      const GaugeStyle & style)
+  {
+    QColor fg_color(value_color);
+    fg_color.setAlpha(style.fg_alpha);
+    painter.setFont(FontCache::instance().font(QString(), text_size_, QFont::Bold));
+    painter.setPen(QPen(fg_color, 1, Qt::SolidLine));
+
+    const QRect label = valueLabelRect();
+    if (shape_ == GaugeShape::HORIZONTAL_BAR) {
+      // caption and value share the row below the bar
+      painter.drawText(label, Qt::AlignRight | Qt::AlignVCenter, formatGaugeValue(val));
       if (show_caption_) {
-        painter.drawText(0, height - caption_offset_, width, caption_offset_,
-                         Qt::AlignCenter | Qt::AlignVCenter,
-                         getName());
+        painter.drawText(label, Qt::AlignLeft | Qt::AlignVCenter, getName());
       }
-      
-      // done
-      painter.end();
-      // Unlock the pixel buffer
+    } else {
+      painter.drawText(label, Qt::AlignCenter | Qt::AlignVCenter, formatGaugeValue(val));
+      if (show_caption_) {
+        painter.drawText(label.translated(0, caption_offset_), Qt::AlignCenter | Qt::AlignVCenter, getName());
+      }
+    }
+  }
+
+  int PieChartDisplay::textureWidth() const
+  {
+    if (shape_ == GaugeShape::VERTICAL_BAR) {
+      return texture_size_ / 2;
     }
+    return texture_size_;
+  }
+
+  int PieChartDisplay::textureHeight() const
+  {
+    switch (shape_) {
+      case GaugeShape::HORIZONTAL_BAR:
+        return texture_size_ / 4 + caption_offset_;
+      case GaugeShape::VERTICAL_BAR:
+        return texture_size_ + 2 * caption_offset_;
+      case GaugeShape::CIRCLE:
+      default:
+        return texture_size_ + caption_offset_;
+    }
+  }
+
+  QRect PieChartDisplay::barRect() const
+  {
+    if (shape_ == GaugeShape::VERTICAL_BAR) {
+      return QRect(0, 0, texture_size_ / 2, texture_size_);
+    }
+    return QRect(0, 0, texture_size_, texture_size_ / 4);
+  }
+
+  QRect PieChartDisplay::valueLabelRect() const
+  {
+    const QRect bar = barRect();
+    return QRect(0, bar.bottom() + 1, bar.width(), caption_offset_);
   }
 
   void PieChartDisplay::onEnable()
@@ -299,6 +556,10 @@ namespace rviz_2d_overlay_plugins
   {
     unsubscribe();
     overlay_->hide();
+    overlay_->releaseTexture();
+    std::lock_guard lock(mutex_);
+    // the texture is created again with the next draw after enabling
+    update_required_ = true;
   }
 
   void PieChartDisplay::updateSize()
@@ -311,12 +572,18 @@ namespace rviz_2d_overlay_plugins
   void PieChartDisplay::updateTop()
   {
     top_ = top_property_->getInt();
+    if (overlay_) {
+      overlay_->setPosition(left_, top_);
+    }
     update_required_ = true;
   }
   
   void PieChartDisplay::updateLeft()
   {
     left_ = left_property_->getInt();
+    if (overlay_) {
+      overlay_->setPosition(left_, top_);
+    }
     update_required_ = true;
   }
   
@@ -372,13 +639,12 @@ namespace rviz_2d_overlay_plugins
   
   void PieChartDisplay::updateTextSize()
   {
+    property_batch_.run("text size", [this]() {
       std::lock_guard lock(mutex_);
-    text_size_ = text_size_property_->getInt();
-    QFont font;
-    font.setPointSize(text_size_);
-    caption_offset_ = QFontMetrics(font).height();
-    update_required_ = true;
-
+      text_size_ = text_size_property_->getInt();
+      caption_offset_ = FontCache::instance().get(QString(), text_size_)->metrics.height();
+      update_required_ = true;
+    });
   }
   
   void PieChartDisplay::updateShowCaption()
@@ -440,10 +706,40 @@ namespace rviz_2d_overlay_plugins
 
   }
 
+  void PieChartDisplay::updateShape()
+  {
+    std::lock_guard lock(mutex_);
+    shape_ = static_cast<GaugeShape>(shape_property_->getOptionInt());
+    update_required_ = true;
+  }
+
+  void PieChartDisplay::updateSmooth()
+  {
+    smooth_ = smooth_property_->getBool();
+    update_required_ = true;
+  }
+
+  void PieChartDisplay::updateSmoothingTime()
+  {
+    smoothing_time_ = smoothing_time_property_->getFloat();
+  }
+
+  void PieChartDisplay::updateAnimationSteps()
+  {
+    animation_steps_ = animation_steps_property_->getInt();
+    update_required_ = true;
+  }
+
+  void PieChartDisplay::updateDrawPriority()
+  {
+    scheduled_draw_->setPriority(draw_priority_property_->getInt());
+    overlay_->setPriority(draw_priority_property_->getInt());
+  }
+
    bool PieChartDisplay::isInRegion(int x, int y)
   {
-    return (top_ < y && top_ + texture_size_ > y &&
-            left_ < x && left_ + texture_size_ > x);
+    return (top_ < y && top_ + textureHeight() > y &&
+            left_ < x && left_ + textureWidth() > x);
   }
 
   void PieChartDisplay::movePosition(int x, int y)
@@ -35,24 +35,33 @@
  *********************************************************************/
 
 #include "plotter_2d_display.hpp"
+#include "font_cache.hpp"
+#include "message_field_access.hpp"
 #include <OgreHardwarePixelBuffer.h>
 #include <rviz_common/uniform_string_stream.hpp>
 #include <rviz_common/display_context.hpp>
 #include <rviz_rendering/render_system.hpp>
 #include <QPainter>
+#include <algorithm>
+#include <cctype>
 
 namespace rviz_2d_overlay_plugins
 {
+  namespace
+  {
+    const char SAMPLE_BLOCK_TYPE[] = "rviz_2d_overlay_msgs/msg/SampleBlock";
+  }  // namespace
+
   Plotter2DDisplay::Plotter2DDisplay()
-    : min_value_(0.0), max_value_(0.0)
+    : reported_deadline_misses_(0), buffer_begin_(0), min_value_(0.0), max_value_(0.0)
   {
     topic_message_type_property_ = std::make_unique<rviz_common::properties::StringProperty>(
       "Topic Message Type", "",
-      "Topic message type to subscribe to",
+      "Topic message type to subscribe to, rviz_2d_overlay_msgs/msg/SampleBlock plots all samples of a block",
       this, SLOT(updateTopicMessageType()));
     topic_field_property_ = std::make_unique<rviz_common::properties::StringProperty>(
       "Topic Field", "",
-      "Topic field to display in plotter window",
+      "Topic field to display in plotter window, the channel name or index for SampleBlock",
       this, SLOT(updateTopicField()));
     show_value_property_ = std::make_unique<rviz_common::properties::BoolProperty>(
       "Show Value", true,
@@ -153,36 +162,71 @@ namespace rviz_2d_overlay_plugins
         QColor(255, 0, 0),
         "only used if auto color change is set to True.",
         this, SLOT(updateMaxColor()));
+    draw_priority_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "draw priority", 0,
+      "overlays with higher priority are drawn first if not all overlays can be drawn within a frame",
+      this, SLOT(updateDrawPriority()));
   }
 
   Plotter2DDisplay::~Plotter2DDisplay()
   {
+    scheduled_draw_.reset();
     onDisable();
   }
 
   void Plotter2DDisplay::initializeBuffer()
   {
-    buffer_.resize(buffer_length_);
+    buffer_.assign(buffer_length_, 0.0);
+    buffer_begin_ = 0;
     if (min_value_ == 0.0 && max_value_ == 0.0) {
       min_value_ = -1.0;
       max_value_ = 1.0;
     }
-    for (ssize_t i = 0; i < buffer_length_; i++) {
-      buffer_[i] = 0.0;
+  }
+
+  double Plotter2DDisplay::sample(size_t i) const
+  {
+    return buffer_[(buffer_begin_ + i) % buffer_.size()];
+  }
+
+  void Plotter2DDisplay::appendSamples(const double * values, size_t count)
+  {
+    const size_t length = buffer_.size();
+    if (count >= length) {
+      std::copy_n(values + count - length, length, buffer_.begin());
+      buffer_begin_ = 0;
+      return;
     }
+    // the new samples replace the oldest ones, in at most two contiguous copies
+    const size_t first = std::min(count, length - buffer_begin_);
+    std::copy_n(values, first, buffer_.begin() + buffer_begin_);
+    std::copy_n(values + first, count - first, buffer_.begin());
+    buffer_begin_ = (buffer_begin_ + count) % length;
   }
 
   void Plotter2DDisplay::onInitialize()
   {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": initialize");
     RTDClass::onInitialize();
     rviz_rendering::RenderSystem::get()->prepareOverlays(scene_manager_);
+    initializeOverlay();
+    updateTopicMessageType();
+  }
+
+  void Plotter2DDisplay::initializeOverlay()
+  {
     static int count = 0;
     rviz_common::UniformStringStream ss;
     ss << "Plotter2DDisplayObject" << count++;
     overlay_ = std::make_shared<OverlayObject>(ss.str());
+    scheduled_draw_ = ScheduledDraw::create([this]() {drawOverlay();});
+    overlay_->setDownscalable(true);
+    overlay_->setTextureLostCallback([this]() {
+      std::scoped_lock lock(mutex_);
+      draw_required_ = true;
+    });
     updateBufferSize();
     onEnable();
-    updateTopicMessageType();
     updateTopicField();
     updateShowValue();
     updateWidth();
@@ -205,8 +249,18 @@ namespace rviz_2d_overlay_plugins
     updateMaxValue();
     updateTextSizeInPlot();
     updateAutoTextSizeInPlot();
-    overlay_->updateTextureSize(width_property_->getInt(),
-                                height_property_->getInt() + caption_offset_);
+    updateDrawPriority();
+  }
+
+  void Plotter2DDisplay::load(const rviz_common::Config & config)
+  {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": load config");
+    RTDClass::load(config);
+  }
+
+  void Plotter2DDisplay::updateTopic()
+  {
+    property_batch_.run("topic", [this]() {RTDClass::updateTopic();});
   }
 
   void Plotter2DDisplay::drawPlot()
@@ -219,7 +273,7 @@ namespace rviz_2d_overlay_plugins
 
     if (auto_color_change_) {
       double r
-        = std::min(std::max((buffer_[buffer_.size() - 1] - min_value_) / (max_value_ - min_value_),
+        = std::min(std::max((sample(buffer_.size() - 1) - min_value_) / (max_value_ - min_value_),
                             0.0), 1.0);
       if (r > 0.3) {
         double r2 = (r - 0.3) / 0.7;
@@ -234,16 +288,13 @@ namespace rviz_2d_overlay_plugins
 
     {
       rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer();
-      QImage Hud = buffer.getQImage(*overlay_);
       // initialize by the background color
-      for (unsigned int i = 0; i < overlay_->getTextureWidth(); i++) {
-        for (unsigned int j = 0; j < overlay_->getTextureHeight(); j++) {
-          Hud.setPixel(i, j, bg_color.rgba());
-        }
-      }
+      QImage Hud = buffer.getQImage(*overlay_, bg_color);
       // paste in HUD speedometer. I resize the image and offset it by 8 pixels from
       // the bottom left edge of the render window
       QPainter painter( &Hud );
+      // the texture budget may have reduced the resolution, paint in the coordinates of the full size
+      painter.scale(overlay_->getTextureScale(), overlay_->getTextureScale());
       painter.setRenderHint(QPainter::Antialiasing, true);
       painter.setPen(QPen(fg_color, line_width_, Qt::SolidLine));
 
@@ -253,24 +304,33 @@ namespace rviz_2d_overlay_plugins
       double margined_max_value = max_value_ + (max_value_ - min_value_) / 2;
       double margined_min_value = min_value_ - (max_value_ - min_value_) / 2;
 
-      for (ssize_t i = 1; i < buffer_length_; i++) {
-        double v_prev = (margined_max_value - buffer_[i - 1]) / (margined_max_value - margined_min_value);
-        double v = (margined_max_value - buffer_[i]) / (margined_max_value - margined_min_value);
-        double u_prev = (i - 1) / (float)buffer_length_;
-        double u = i / (float)buffer_length_;
-
+      const auto row = [&](double value) {
+        const double v = (margined_max_value - value) / (margined_max_value - margined_min_value);
         // chop within 0 ~ 1
-        v_prev = std::max(std::min(v_prev, 1.0), 0.0);
-        u_prev = std::max(std::min(u_prev, 1.0), 0.0);
-        v = std::max(std::min(v, 1.0), 0.0);
-        u = std::max(std::min(u, 1.0), 0.0);
-
-        uint16_t x_prev = (int)(u_prev * w);
-        uint16_t x = (int)(u * w);
-        uint16_t y_prev = (int)(v_prev * h);
-        uint16_t y = (int)(v * h);
-        painter.drawLine(x_prev, y_prev, x, y);
+        return static_cast<int>(std::max(std::min(v, 1.0), 0.0) * h);
+      };
+      QPolygon line;
+      if (buffer_length_ > 2 * w) {
+        // dense buffers, e.g. of sample blocks, are drawn as the envelope of the samples of every column
+        line.reserve(2 * w);
+        ssize_t i = 0;
+        for (int x = 0; x < w; x++) {
+          const ssize_t end = static_cast<ssize_t>(x + 1) * buffer_length_ / w;
+          double min_value = sample(i);
+          double max_value = min_value;
+          for (; i < end; i++) {
+            min_value = std::min(min_value, sample(i));
+            max_value = std::max(max_value, sample(i));
+          }
+          line << QPoint(x, row(max_value)) << QPoint(x, row(min_value));
+        }
+      } else {
+        line.reserve(buffer_length_);
+        for (ssize_t i = 0; i < buffer_length_; i++) {
+          line << QPoint(static_cast<int>(i / (float)buffer_length_ * w), row(sample(i)));
+        }
       }
+      painter.drawPolyline(line);
       // draw border
       if (show_border_) {
         painter.drawLine(0, 0, 0, h);
@@ -280,25 +340,16 @@ namespace rviz_2d_overlay_plugins
       }
       // draw caption
       if (show_caption_) {
-        QFont font = painter.font();
-        font.setPointSize(text_size_);
-        font.setBold(true);
-        painter.setFont(font);
+        painter.setFont(FontCache::instance().font(QString(), text_size_, QFont::Bold));
         painter.drawText(0, h, w, caption_offset_,
                          Qt::AlignCenter | Qt::AlignVCenter,
                          getName());
       }
       if (show_value_) {
-        QFont font = painter.font();
-        if (auto_text_size_in_plot_) {
-          font.setPointSize(w / 4);
-        } else {
-          font.setPointSize(text_size_in_plot_);
-        }
-        font.setBold(true);
-        painter.setFont(font);
+        const int text_size = auto_text_size_in_plot_ ? w / 4 : text_size_in_plot_;
+        painter.setFont(FontCache::instance().font(QString(), text_size, QFont::Bold));
         std::ostringstream ss;
-        ss << std::fixed << std::setprecision(2) << buffer_[buffer_.size() - 1];
+        ss << std::fixed << std::setprecision(2) << sample(buffer_.size() - 1);
         painter.drawText(0, 0, w, h,
                          Qt::AlignCenter | Qt::AlignVCenter,
                          ss.str().c_str());
@@ -309,77 +360,10 @@ namespace rviz_2d_overlay_plugins
     }
   }
 
-  double Plotter2DDisplay::recurseToField(const ros_babel_fish::Message& msg, size_t topic_field_idx)
-  {
-    using namespace ros_babel_fish;
-
-    if (topic_field_idx == topic_fields_.size()) {
-      switch ( msg.type() ) {
-        case MessageTypes::Float:
-          return msg.value<float>();
-          break;
-        case MessageTypes::Double:
-          return msg.value<double>();
-          break;
-        case MessageTypes::LongDouble:
-          return msg.value<long double>();
-          break;
-#pragma push_macro("Bool")
-#undef Bool
-        case MessageTypes::Bool:
-          return msg.value<bool>();
-          break;
-#pragma pop_macro("Bool")
-        case MessageTypes::Octet:
-          return msg.value<uint8_t>();
-          break;
-        case MessageTypes::UInt8:
-          return msg.value<uint8_t>();
-          break;
-        case MessageTypes::Int8:
-          return msg.value<int8_t>();
-          break;
-        case MessageTypes::UInt16:
-          return msg.value<uint16_t>();
-          break;
-        case MessageTypes::Int16:
-          return msg.value<int16_t>();
-          break;
-        case MessageTypes::UInt32:
-          return msg.value<uint32_t>();
-          break;
-        case MessageTypes::Int32:
-          return msg.value<int32_t>();
-          break;
-        case MessageTypes::UInt64:
-          return msg.value<uint64_t>();
-          break;
-        case MessageTypes::Int64:
-          return msg.value<int64_t>();
-          break;
-        case MessageTypes::Compound:
-        {
-          auto &compound = msg.as<CompoundMessage>();
-          if ( compound.isTime() ) {
-            return compound.value<rclcpp::Time>().seconds();
-          } else if ( compound.isDuration() ) {
-            return compound.value<rclcpp::Duration>().seconds();
-          }
-          [[fallthrough]];
-        }
-        default:
-          throw BabelFishException("Field '" + topic_field_ + "' found, but not convertable to floating point representation");
-          break;
-      }
-    }
-
-    auto & compound = msg.as<CompoundMessage>();
-    const auto & field_name = topic_fields_[topic_field_idx];
-    if (!compound.containsKey(field_name)) {
-      throw BabelFishException("Field '" + field_name + "' of '" + topic_field_ + "' not found in message");
-    }
-
-    return recurseToField(compound[field_name], ++topic_field_idx);
+  double Plotter2DDisplay::readField(const ros_babel_fish::CompoundMessage & msg)
+  {
+    topic_field_accessor_.resolve(msg.name());
+    return topic_field_accessor_.value(msg);
   }
 
   void Plotter2DDisplay::processMessage(ros_babel_fish::CompoundMessage::ConstSharedPtr msg)
@@ -390,81 +374,119 @@ namespace rviz_2d_overlay_plugins
       return;
     }
 
-    if (topic_fields_.empty()) {
-      setStatus(
-        rviz_common::properties::StatusProperty::Error,
-        "Topic",
-        QString("Error parsing: Empty topic field"));
-      return;
-    }
+    if (topic_message_type_ == SAMPLE_BLOCK_TYPE) {
+      // the babel fish message is the C++ message, the samples are appended without converting every field
+      auto block =
+        std::static_pointer_cast<const rviz_2d_overlay_msgs::msg::SampleBlock>(msg->type_erased_message());
+      const rviz_2d_overlay_msgs::msg::SampleChannel * channel = selectChannel(*block);
+      if (!channel) {
+        setStatus(
+          rviz_common::properties::StatusProperty::Error,
+          "Topic",
+          QString::fromStdString("No channel '" + topic_field_ + "' in the sample block"));
+        return;
+      }
+      appendSamples(channel->values.data(), channel->values.size());
+      updateScale();
+    } else {
+      if (topic_field_.empty()) {
+        setStatus(
+          rviz_common::properties::StatusProperty::Error,
+          "Topic",
+          QString("Error parsing: Empty topic field"));
+        return;
+      }
 
-    double data{0.0};
-    try {
-      data = recurseToField(*msg, 0);
-    } catch (ros_babel_fish::BabelFishException &e) {
-      setStatus(
-        rviz_common::properties::StatusProperty::Error,
-        "Topic",
-        QString::fromStdString(std::string{"Error parsing: "} + e.what()));
+      double data{0.0};
+      try {
+        data = readField(*msg);
+      } catch (ros_babel_fish::BabelFishException &e) {
+        setStatus(
+          rviz_common::properties::StatusProperty::Error,
+          "Topic",
+          QString::fromStdString(std::string{"Error parsing: "} + e.what()));
+        return;
+      }
+      appendSamples(&data, 1);
+      updateScale();
+    }
+    if (!overlay_->isVisible()) {
       return;
     }
 
-    // add the message to the buffer
-    double min_value = buffer_[0];
-    double max_value = buffer_[0];
-    for (ssize_t i = 0; i < buffer_length_ - 1; i++) {
-      buffer_[i] = buffer_[i + 1];
-      if (min_value > buffer_[i]) {
-        min_value = buffer_[i];
-      }
-      if (max_value < buffer_[i]) {
-        max_value = buffer_[i];
-      }
-    }
-    buffer_[buffer_length_ - 1] = data;
-    if (min_value > data) {
-      min_value = data;
+    draw_required_ = true;
+  }
+
+  const rviz_2d_overlay_msgs::msg::SampleChannel * Plotter2DDisplay::selectChannel(
+    const rviz_2d_overlay_msgs::msg::SampleBlock & block) const
+  {
+    if (topic_field_.empty()) {
+      return block.channels.empty() ? nullptr : &block.channels.front();
     }
-    if (max_value < data) {
-      max_value = data;
+    for (const auto & channel : block.channels) {
+      if (channel.name == topic_field_) {
+        return &channel;
+      }
     }
-    if (auto_scale_) {
-      min_value_ = min_value;
-      max_value_ = max_value;
-      if (min_value_ == max_value_) {
-        min_value_ = min_value_ - 0.5;
-        max_value_ = max_value_ + 0.5;
+    if (topic_field_.size() < 10 &&
+        std::all_of(topic_field_.begin(), topic_field_.end(), [](unsigned char c) {return std::isdigit(c);}))
+    {
+      const size_t index = std::stoul(topic_field_);
+      if (index < block.channels.size()) {
+        return &block.channels[index];
       }
     }
-    if (!overlay_->isVisible()) {
+    return nullptr;
+  }
+
+  void Plotter2DDisplay::updateScale()
+  {
+    if (!auto_scale_) {
       return;
     }
-
-    draw_required_ = true;
+    const auto [min_value, max_value] = std::minmax_element(buffer_.begin(), buffer_.end());
+    min_value_ = *min_value;
+    max_value_ = *max_value;
+    if (min_value_ == max_value_) {
+      min_value_ = min_value_ - 0.5;
+      max_value_ = max_value_ + 0.5;
+    }
   }
 
   void Plotter2DDisplay::update(float wall_dt, float /*ros_dt*/)
   {
+    reportDeadlineMisses(*this, *scheduled_draw_, reported_deadline_misses_);
+    reportTextureUsage(*this, *overlay_, reported_texture_usage_);
     if (draw_required_) {
-      if (wall_dt + last_time_ > update_interval_) {
-        overlay_->updateTextureSize(texture_width_,
-                                    texture_height_ + caption_offset_);
-        overlay_->setPosition(left_, top_);
-        overlay_->setDimensions(overlay_->getTextureWidth(), overlay_->getTextureHeight());
-        last_time_ = 0;
-        drawPlot();
-        draw_required_ = false;
-      }
-      else {
-        last_time_ = last_time_ + wall_dt;
+      // wall_dt is given in nanoseconds, the update interval in seconds
+      last_time_ = last_time_ + wall_dt * 1e-9;
+      // off screen only the buffer is filled, the plot is drawn once it is visible again
+      if (last_time_ > update_interval_ && overlay_->isOnScreen()) {
+        scheduled_draw_->requestDraw();
       }
     }
   }
 
-  void Plotter2DDisplay::onEnable()
+  void Plotter2DDisplay::drawOverlay()
   {
+    std::scoped_lock lock(mutex_);
+    if (!draw_required_) {
+      return;
+    }
+    overlay_->updateTextureSize(texture_width_,
+                                texture_height_ + caption_offset_);
+    overlay_->setPosition(left_, top_);
+    overlay_->setDimensions(overlay_->getTextureWidth(), overlay_->getTextureHeight());
     last_time_ = 0;
+    drawPlot();
     draw_required_ = false;
+  }
+
+  void Plotter2DDisplay::onEnable()
+  {
+    last_time_ = 0;
+    // the texture was released on disable, paint the buffered values again
+    draw_required_ = true;
     subscribe();
     overlay_->show();
   }
@@ -473,6 +495,7 @@ namespace rviz_2d_overlay_plugins
   {
     unsubscribe();
     overlay_->hide();
+    overlay_->releaseTexture();
   }
 
   void Plotter2DDisplay::updateWidth()
@@ -490,11 +513,17 @@ namespace rviz_2d_overlay_plugins
   void Plotter2DDisplay::updateTop()
   {
     top_ = top_property_->getInt();
+    if (overlay_) {
+      overlay_->setPosition(left_, top_);
+    }
   }
 
   void Plotter2DDisplay::updateLeft()
   {
     left_ = left_property_->getInt();
+    if (overlay_) {
+      overlay_->setPosition(left_, top_);
+    }
   }
 
   void Plotter2DDisplay::updateBGColor()
@@ -526,14 +555,9 @@ namespace rviz_2d_overlay_plugins
 
   void Plotter2DDisplay::updateTopicField()
   {
+    std::scoped_lock lock(mutex_);
     topic_field_ = topic_field_property_->getString().toStdString();
-    std::stringstream ss(topic_field_);
-    std::string sub_field;
-
-    topic_fields_.clear();
-    while (std::getline(ss, sub_field, '.')) {
-      topic_fields_.push_back(sub_field);
-    }
+    topic_field_accessor_ = FieldAccessor(topic_field_);
   }
 
   void Plotter2DDisplay::updateShowValue()
@@ -553,8 +577,10 @@ namespace rviz_2d_overlay_plugins
 
   void Plotter2DDisplay::updateBufferSize()
   {
-    buffer_length_ = buffer_length_property_->getInt();
-    initializeBuffer();
+    property_batch_.run("buffer size", [this]() {
+      buffer_length_ = buffer_length_property_->getInt();
+      initializeBuffer();
+    });
   }
 
   void Plotter2DDisplay::updateAutoColorChange()
@@ -578,12 +604,18 @@ namespace rviz_2d_overlay_plugins
     update_interval_ = update_interval_property_->getFloat();
   }
 
+  void Plotter2DDisplay::updateDrawPriority()
+  {
+    scheduled_draw_->setPriority(draw_priority_property_->getInt());
+    overlay_->setPriority(draw_priority_property_->getInt());
+  }
+
   void Plotter2DDisplay::updateTextSize()
   {
-    text_size_ = text_size_property_->getInt();
-    QFont font;
-    font.setPointSize(text_size_);
-    caption_offset_ = QFontMetrics(font).height();
+    property_batch_.run("text size", [this]() {
+      text_size_ = text_size_property_->getInt();
+      caption_offset_ = FontCache::instance().get(QString(), text_size_)->metrics.height();
+    });
   }
 
   void Plotter2DDisplay::updateShowCaption()
@@ -0,0 +1,91 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+
+#include "property_batch.hpp"
+
+#include <cstring>
+
+#include <rviz_common/logging.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+  PropertyBatch::Scope::Scope(PropertyBatch & batch, std::string timing_label)
+    : batch_(batch), timing_label_(std::move(timing_label)), start_(std::chrono::steady_clock::now())
+  {
+    batch_.depth_++;
+  }
+
+  PropertyBatch::Scope::~Scope()
+  {
+    if (--batch_.depth_ == 0) {
+      batch_.commit();
+    }
+    if (!timing_label_.empty()) {
+      const std::chrono::duration<double, std::milli> duration = std::chrono::steady_clock::now() - start_;
+      RVIZ_COMMON_LOG_DEBUG_STREAM(timing_label_ << " took " << duration.count() << " ms");
+    }
+  }
+
+  void PropertyBatch::run(const char * key, std::function<void()> action)
+  {
+    if (depth_ == 0) {
+      action();
+      return;
+    }
+    for (auto & deferred : deferred_) {
+      if (std::strcmp(deferred.first, key) == 0) {
+        deferred.second = std::move(action);
+        return;
+      }
+    }
+    deferred_.emplace_back(key, std::move(action));
+  }
+
+  bool PropertyBatch::active() const
+  {
+    return depth_ > 0;
+  }
+
+  void PropertyBatch::commit()
+  {
+    // actions may change properties again, those run right away
+    auto deferred = std::move(deferred_);
+    deferred_.clear();
+    for (auto & action : deferred) {
+      action.second();
+    }
+  }
+}  // namespace rviz_2d_overlay_plugins
@@ -0,0 +1,369 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#include "shm_overlay_channel.hpp"
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace rviz_2d_overlay_plugins
+{
+  namespace
+  {
+    constexpr uint32_t CHANNEL_MAGIC = 0x52324f56;  // "R2OV"
+    constexpr uint32_t CHANNEL_VERSION = 1;
+    // slots and rows start on cache lines
+    constexpr size_t ALIGNMENT = 64;
+
+    static_assert(std::atomic<uint32_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+                  "atomics shared between processes have to be lock free");
+
+    struct ChannelHeader
+    {
+      // written last by the writer, readers reject the channel until it is set
+      std::atomic<uint32_t> magic;
+      uint32_t version;
+      uint32_t slot_count;
+      uint32_t max_width;
+      uint32_t max_height;
+      uint32_t slot_step;
+      uint64_t slot_stride;
+      std::atomic<uint64_t> latest_frame;
+    };
+
+    struct SlotHeader
+    {
+      // twice the number of the frame in the slot, odd while the writer fills the slot
+      std::atomic<uint64_t> sequence;
+      uint32_t width;
+      uint32_t height;
+      uint32_t format;
+    };
+
+    constexpr size_t alignUp(size_t value)
+    {
+      return (value + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    }
+
+    constexpr size_t HEADER_SIZE = alignUp(sizeof(ChannelHeader));
+    constexpr size_t SLOT_HEADER_SIZE = alignUp(sizeof(SlotHeader));
+
+    ChannelHeader * channelHeader(void * memory)
+    {
+      return static_cast<ChannelHeader *>(memory);
+    }
+
+    SlotHeader * slotHeader(void * memory, uint64_t frame_number)
+    {
+      const ChannelHeader * header = channelHeader(memory);
+      return reinterpret_cast<SlotHeader *>(
+        static_cast<uint8_t *>(memory) + HEADER_SIZE + (frame_number % header->slot_count) * header->slot_stride);
+    }
+
+    uint8_t * slotPixels(SlotHeader * slot)
+    {
+      return reinterpret_cast<uint8_t *>(slot) + SLOT_HEADER_SIZE;
+    }
+  }  // namespace
+
+  ShmOverlayWriter::ShmOverlayWriter(
+    const std::string & name, uint32_t max_width, uint32_t max_height, uint32_t slot_count)
+    : name_(name), memory_(nullptr), size_(0), device_(0), inode_(0), frame_number_(0), writing_(false)
+  {
+    if (max_width == 0 || max_height == 0 || slot_count < 2) {
+      throw std::invalid_argument("Shared memory channel needs a non-empty frame size and at least two slots");
+    }
+    const uint32_t slot_step = static_cast<uint32_t>(alignUp(static_cast<size_t>(max_width) * 4));
+    const uint64_t slot_stride = SLOT_HEADER_SIZE + alignUp(static_cast<size_t>(slot_step) * max_height);
+    size_ = HEADER_SIZE + slot_count * slot_stride;
+
+    // readers of a previous writer keep their mapping of the removed object and notice that it is stale
+    shm_unlink(name_.c_str());
+    const int fd = shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0) {
+      throw std::system_error(errno, std::generic_category(), "Creating shared memory '" + name_ + "' failed");
+    }
+    struct stat status;
+    if (fstat(fd, &status) == 0) {
+      device_ = status.st_dev;
+      inode_ = status.st_ino;
+    }
+    if (ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+      const int error = errno;
+      ::close(fd);
+      shm_unlink(name_.c_str());
+      throw std::system_error(error, std::generic_category(), "Resizing shared memory '" + name_ + "' failed");
+    }
+    memory_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    const int error = errno;
+    ::close(fd);
+    if (memory_ == MAP_FAILED) {
+      memory_ = nullptr;
+      shm_unlink(name_.c_str());
+      throw std::system_error(error, std::generic_category(), "Mapping shared memory '" + name_ + "' failed");
+    }
+
+    // the new object is zero filled, the sequences of all slots are 0
+    ChannelHeader * header = new (memory_) ChannelHeader();
+    header->version = CHANNEL_VERSION;
+    header->slot_count = slot_count;
+    header->max_width = max_width;
+    header->max_height = max_height;
+    header->slot_step = slot_step;
+    header->slot_stride = slot_stride;
+    header->latest_frame.store(0, std::memory_order_relaxed);
+    for (uint32_t i = 0; i < slot_count; i++) {
+      new (slotHeader(memory_, i)) SlotHeader();
+    }
+    header->magic.store(CHANNEL_MAGIC, std::memory_order_release);
+  }
+
+  ShmOverlayWriter::~ShmOverlayWriter()
+  {
+    if (!memory_) {
+      return;
+    }
+    munmap(memory_, size_);
+    // a writer started meanwhile replaced the object under the same name, its readers keep it
+    const int fd = shm_open(name_.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+      return;
+    }
+    struct stat status;
+    if (fstat(fd, &status) == 0 && status.st_dev == device_ && status.st_ino == inode_) {
+      shm_unlink(name_.c_str());
+    }
+    ::close(fd);
+  }
+
+  uint8_t * ShmOverlayWriter::beginFrame(uint32_t width, uint32_t height, ShmPixelFormat format, uint32_t & step)
+  {
+    ChannelHeader * header = channelHeader(memory_);
+    if (width == 0 || height == 0 || width > header->max_width || height > header->max_height) {
+      throw std::invalid_argument(
+        "Frame size " + std::to_string(width) + " x " + std::to_string(height) + " exceeds the channel size " +
+        std::to_string(header->max_width) + " x " + std::to_string(header->max_height));
+    }
+    const uint64_t frame_number = frame_number_ + 1;
+    SlotHeader * slot = slotHeader(memory_, frame_number);
+    slot->sequence.store(2 * frame_number - 1, std::memory_order_relaxed);
+    // readers seeing any of the following writes also see the odd sequence
+    std::atomic_thread_fence(std::memory_order_release);
+    slot->width = width;
+    slot->height = height;
+    slot->format = static_cast<uint32_t>(format);
+    step = header->slot_step;
+    writing_ = true;
+    return slotPixels(slot);
+  }
+
+  void ShmOverlayWriter::endFrame()
+  {
+    if (!writing_) {
+      return;
+    }
+    const uint64_t frame_number = frame_number_ + 1;
+    slotHeader(memory_, frame_number)->sequence.store(2 * frame_number, std::memory_order_release);
+    channelHeader(memory_)->latest_frame.store(frame_number, std::memory_order_release);
+    frame_number_ = frame_number;
+    writing_ = false;
+  }
+
+  void ShmOverlayWriter::write(
+    const uint8_t * data, uint32_t width, uint32_t height, uint32_t step, ShmPixelFormat format)
+  {
+    uint32_t slot_step;
+    uint8_t * pixels = beginFrame(width, height, format, slot_step);
+    for (uint32_t y = 0; y < height; y++) {
+      std::memcpy(pixels + static_cast<size_t>(y) * slot_step, data + static_cast<size_t>(y) * step,
+                  static_cast<size_t>(width) * 4);
+    }
+    endFrame();
+  }
+
+  uint32_t ShmOverlayWriter::maxWidth() const
+  {
+    return channelHeader(memory_)->max_width;
+  }
+
+  uint32_t ShmOverlayWriter::maxHeight() const
+  {
+    return channelHeader(memory_)->max_height;
+  }
+
+  ShmOverlayReader::ShmOverlayReader()
+    : fd_(-1), memory_(nullptr), size_(0), last_frame_(0)
+  {
+  }
+
+  ShmOverlayReader::~ShmOverlayReader()
+  {
+    close();
+  }
+
+  bool ShmOverlayReader::open(const std::string & name, std::string & error)
+  {
+    close();
+    fd_ = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd_ < 0) {
+      error = "Opening shared memory '" + name + "' failed: " + std::strerror(errno);
+      return false;
+    }
+    struct stat status;
+    if (fstat(fd_, &status) != 0 || static_cast<size_t>(status.st_size) < HEADER_SIZE) {
+      error = "Shared memory '" + name + "' is not initialized by a writer yet";
+      close();
+      return false;
+    }
+    size_ = status.st_size;
+    memory_ = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+    if (memory_ == MAP_FAILED) {
+      memory_ = nullptr;
+      error = "Mapping shared memory '" + name + "' failed: " + std::strerror(errno);
+      close();
+      return false;
+    }
+
+    const ChannelHeader * header = channelHeader(memory_);
+    if (header->magic.load(std::memory_order_acquire) != CHANNEL_MAGIC) {
+      error = "Shared memory '" + name + "' is not an overlay channel or not initialized yet";
+      close();
+      return false;
+    }
+    if (header->version != CHANNEL_VERSION || header->slot_count == 0 ||
+        header->slot_step < static_cast<uint64_t>(header->max_width) * 4 ||
+        header->slot_stride < SLOT_HEADER_SIZE + static_cast<uint64_t>(header->slot_step) * header->max_height ||
+        HEADER_SIZE + header->slot_count * header->slot_stride > size_)
+    {
+      error = "Shared memory '" + name + "' has an unsupported layout";
+      close();
+      return false;
+    }
+    last_frame_ = 0;
+    return true;
+  }
+
+  void ShmOverlayReader::close()
+  {
+    if (memory_) {
+      munmap(memory_, size_);
+      memory_ = nullptr;
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+    size_ = 0;
+  }
+
+  bool ShmOverlayReader::isOpen() const
+  {
+    return memory_ != nullptr;
+  }
+
+  bool ShmOverlayReader::isStale() const
+  {
+    struct stat status;
+    return !isOpen() || fstat(fd_, &status) != 0 || status.st_nlink == 0;
+  }
+
+  bool ShmOverlayReader::hasNewFrame() const
+  {
+    return isOpen() && channelHeader(memory_)->latest_frame.load(std::memory_order_acquire) != last_frame_;
+  }
+
+  bool ShmOverlayReader::beginRead(ShmFrame & frame)
+  {
+    if (!isOpen()) {
+      return false;
+    }
+    const ChannelHeader * header = channelHeader(memory_);
+    const uint64_t frame_number = header->latest_frame.load(std::memory_order_acquire);
+    if (frame_number == 0 || frame_number == last_frame_) {
+      return false;
+    }
+    SlotHeader * slot = slotHeader(memory_, frame_number);
+    // the slot is overwritten already, a newer frame is published soon
+    if (slot->sequence.load(std::memory_order_acquire) != 2 * frame_number) {
+      return false;
+    }
+    frame.width = slot->width;
+    frame.height = slot->height;
+    frame.format = static_cast<ShmPixelFormat>(slot->format);
+    // a torn size is caught by endRead(), it must not make the reader leave the slot
+    if (frame.width == 0 || frame.height == 0 || frame.width > header->max_width ||
+        frame.height > header->max_height)
+    {
+      return false;
+    }
+    frame.step = header->slot_step;
+    frame.data = slotPixels(slot);
+    frame.number = frame_number;
+    return true;
+  }
+
+  bool ShmOverlayReader::endRead(const ShmFrame & frame)
+  {
+    if (!isOpen()) {
+      return false;
+    }
+    // the pixel reads happen before the sequence is read again
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slotHeader(memory_, frame.number)->sequence.load(std::memory_order_relaxed) != 2 * frame.number) {
+      return false;
+    }
+    last_frame_ = frame.number;
+    return true;
+  }
+
+  uint64_t ShmOverlayReader::lastFrame() const
+  {
+    return last_frame_;
+  }
+
+  void ShmOverlayReader::forgetLastFrame()
+  {
+    last_frame_ = 0;
+  }
+}  // namespace rviz_2d_overlay_plugins
@@ -0,0 +1,119 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+// Writes an animated test pattern into a shared memory overlay channel, shown by the ShmOverlay display.
+//
+//   ros2 run rviz_2d_overlay_plugins shm_overlay_demo_writer [--channel /rviz_overlay] [--width 320]
+//                                                            [--height 240] [--rate 60]
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "shm_overlay_channel.hpp"
+
+namespace
+{
+  std::atomic<bool> running{true};
+
+  void stop(int)
+  {
+    running = false;
+  }
+
+  // translucent gradient with an opaque bar sweeping across, rendered straight into the slot
+  void renderPattern(uint8_t * pixels, uint32_t width, uint32_t height, uint32_t step, uint64_t frame)
+  {
+    const uint32_t bar = static_cast<uint32_t>(frame * 4 % width);
+    for (uint32_t y = 0; y < height; y++) {
+      uint8_t * row = pixels + static_cast<size_t>(y) * step;
+      for (uint32_t x = 0; x < width; x++) {
+        uint8_t * pixel = row + static_cast<size_t>(x) * 4;
+        const bool on_bar = x >= bar && x < bar + 8;
+        pixel[0] = on_bar ? 255 : static_cast<uint8_t>(x * 255 / width);
+        pixel[1] = on_bar ? 255 : static_cast<uint8_t>(y * 255 / height);
+        pixel[2] = on_bar ? 255 : static_cast<uint8_t>(128 + 127 * std::sin(frame * 0.05));
+        pixel[3] = on_bar ? 255 : 160;
+      }
+    }
+  }
+}  // namespace
+
+int main(int argc, char ** argv)
+{
+  std::string channel = "/rviz_overlay";
+  uint32_t width = 320;
+  uint32_t height = 240;
+  double rate = 60.0;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (std::strcmp(argv[i], "--channel") == 0) {
+      channel = argv[i + 1];
+    } else if (std::strcmp(argv[i], "--width") == 0) {
+      width = std::atoi(argv[i + 1]);
+    } else if (std::strcmp(argv[i], "--height") == 0) {
+      height = std::atoi(argv[i + 1]);
+    } else if (std::strcmp(argv[i], "--rate") == 0) {
+      rate = std::atof(argv[i + 1]);
+    }
+  }
+  if (width == 0 || height == 0 || rate <= 0.0) {
+    std::fprintf(stderr, "width, height and rate have to be positive\n");
+    return 1;
+  }
+
+  std::signal(SIGINT, stop);
+  std::signal(SIGTERM, stop);
+  rviz_2d_overlay_plugins::ShmOverlayWriter writer(channel, width, height);
+  std::printf("writing %u x %u frames at %.0f Hz to %s\n", width, height, rate, channel.c_str());
+
+  const auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(1.0 / rate));
+  auto next = std::chrono::steady_clock::now();
+  for (uint64_t frame = 0; running; frame++) {
+    uint32_t step;
+    uint8_t * pixels = writer.beginFrame(width, height, rviz_2d_overlay_plugins::ShmPixelFormat::RGBA8, step);
+    renderPattern(pixels, width, height, step, frame);
+    writer.endFrame();
+    next += period;
+    std::this_thread::sleep_until(next);
+  }
+  return 0;
+}
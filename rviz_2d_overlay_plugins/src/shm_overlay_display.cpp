@@ -0,0 +1,274 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#include "shm_overlay_display.hpp"
+
+#include <cstring>
+
+#include <OgreHardwarePixelBuffer.h>
+#include <rviz_common/uniform_string_stream.hpp>
+#include <rviz_rendering/render_system.hpp>
+
+namespace rviz_2d_overlay_plugins
+{
+  namespace
+  {
+    // seconds without frames before a removed or replaced channel is opened again
+    constexpr float REOPEN_INTERVAL = 1.0f;
+    // reads of a frame the writer overwrote meanwhile before the draw is left to the next frame
+    constexpr int MAX_READ_ATTEMPTS = 3;
+
+    ImageFormat imageFormat(ShmPixelFormat format)
+    {
+      return format == ShmPixelFormat::BGRA8 ? ImageFormat::BGRA8 : ImageFormat::RGBA8;
+    }
+  }  // namespace
+
+  ShmOverlayDisplay::ShmOverlayDisplay()
+    : width_(0), height_(0), left_(0), top_(0), panel_width_(0), panel_height_(0), idle_time_(0.0f),
+      reported_deadline_misses_(0)
+  {
+    channel_property_ = std::make_unique<rviz_common::properties::StringProperty>(
+      "channel", "/rviz_overlay",
+      "name of the shared memory channel, as passed to the ShmOverlayWriter of the external renderer",
+      this, SLOT(updateChannel()));
+    width_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "width", 0,
+      "width of the overlay, 0 for the frame width",
+      this, SLOT(updateSize()));
+    width_property_->setMin(0);
+    height_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "height", 0,
+      "height of the overlay, 0 for the frame height",
+      this, SLOT(updateSize()));
+    height_property_->setMin(0);
+    left_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "left", 128,
+      "left of the overlay",
+      this, SLOT(updateLeft()));
+    left_property_->setMin(0);
+    top_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "top", 128,
+      "top of the overlay",
+      this, SLOT(updateTop()));
+    top_property_->setMin(0);
+    draw_priority_property_ = std::make_unique<rviz_common::properties::IntProperty>(
+      "draw priority", 0,
+      "overlays with higher priority are drawn first if not all overlays can be drawn within a frame",
+      this, SLOT(updateDrawPriority()));
+  }
+
+  ShmOverlayDisplay::~ShmOverlayDisplay()
+  {
+    scheduled_draw_.reset();
+    onDisable();
+  }
+
+  void ShmOverlayDisplay::onInitialize()
+  {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": initialize");
+    rviz_rendering::RenderSystem::get()->prepareOverlays(scene_manager_);
+    static int count = 0;
+    rviz_common::UniformStringStream ss;
+    ss << "ShmOverlayDisplayObject" << count++;
+    overlay_ = std::make_shared<OverlayObject>(ss.str());
+    scheduled_draw_ = ScheduledDraw::create([this]() {drawOverlay();});
+    // the newest frame is still in the channel, it is uploaded again
+    overlay_->setTextureLostCallback([this]() {reader_.forgetLastFrame();});
+    onEnable();
+    updateChannel();
+    updateSize();
+    updateLeft();
+    updateTop();
+    updateDrawPriority();
+  }
+
+  void ShmOverlayDisplay::load(const rviz_common::Config & config)
+  {
+    PropertyBatch::Scope batch(property_batch_, getNameStd() + ": load config");
+    rviz_common::Display::load(config);
+  }
+
+  void ShmOverlayDisplay::onEnable()
+  {
+    if (overlay_) {
+      overlay_->show();
+    }
+    reader_.forgetLastFrame();
+  }
+
+  void ShmOverlayDisplay::onDisable()
+  {
+    if (overlay_) {
+      overlay_->hide();
+      overlay_->releaseTexture();
+    }
+  }
+
+  void ShmOverlayDisplay::openChannel()
+  {
+    idle_time_ = 0.0f;
+    std::string error;
+    if (channel_.empty()) {
+      reader_.close();
+      setStatus(rviz_common::properties::StatusProperty::Error, "Channel", "No channel name set");
+    } else if (reader_.open(channel_, error)) {
+      setStatus(rviz_common::properties::StatusProperty::Ok, "Channel", "Mapped");
+    } else {
+      // the writer may not be running yet, the channel is opened again with the next updates
+      setStatus(rviz_common::properties::StatusProperty::Warn, "Channel", QString::fromStdString(error));
+    }
+  }
+
+  void ShmOverlayDisplay::update(float wall_dt, float /*ros_dt*/)
+  {
+    reportDeadlineMisses(*this, *scheduled_draw_, reported_deadline_misses_);
+    reportTextureUsage(*this, *overlay_, reported_texture_usage_);
+    if (reader_.hasNewFrame()) {
+      idle_time_ = 0.0f;
+      // off screen the channel is not read, the newest frame is uploaded once visible again
+      if (overlay_->isOnScreen()) {
+        scheduled_draw_->requestDraw();
+      }
+      return;
+    }
+    // wall_dt is given in nanoseconds
+    idle_time_ += wall_dt * 1e-9f;
+    // fstat is only called once per interval while no frames arrive
+    if (idle_time_ >= REOPEN_INTERVAL && !channel_.empty()) {
+      idle_time_ = 0.0f;
+      if (reader_.isStale()) {
+        openChannel();
+      }
+    }
+  }
+
+  void ShmOverlayDisplay::drawOverlay()
+  {
+    if (!overlay_ || !overlay_->isVisible()) {
+      return;
+    }
+    // the slot is copied out before the texture is touched, only a copy endRead() confirms is uploaded, so a
+    // frame the writer overwrote while it was read never reaches the screen
+    ShmFrame frame;
+    bool read = false;
+    for (int attempt = 0; attempt < MAX_READ_ATTEMPTS && !read; attempt++) {
+      if (!reader_.beginRead(frame)) {
+        return;
+      }
+      const size_t row_size = static_cast<size_t>(frame.width) * 4;
+      frame_copy_.resize(row_size * frame.height);
+      for (uint32_t y = 0; y < frame.height; y++) {
+        std::memcpy(frame_copy_.data() + y * row_size, frame.data + static_cast<size_t>(y) * frame.step, row_size);
+      }
+      read = reader_.endRead(frame);
+    }
+    // the frame stays unread, update() requests another draw
+    if (!read) {
+      return;
+    }
+
+    const ImageView view{frame_copy_.data(), frame.width, frame.height, static_cast<size_t>(frame.width) * 4,
+                         imageFormat(frame.format)};
+    overlay_->updateTextureSize(frame.width, frame.height, texturePixelFormat(view.format));
+    panel_width_ = width_ > 0 ? width_ : static_cast<int>(frame.width);
+    panel_height_ = height_ > 0 ? height_ : static_cast<int>(frame.height);
+    overlay_->setDimensions(panel_width_, panel_height_);
+    overlay_->setPosition(left_, top_);
+    {
+      rviz_2d_overlay_plugins::ScopedPixelBuffer buffer = overlay_->getBuffer();
+      copyToPixelBox(view, buffer.getPixelBuffer()->getCurrentLock());
+    }
+  }
+
+  void ShmOverlayDisplay::updateChannel()
+  {
+    property_batch_.run("channel", [this]() {
+      channel_ = channel_property_->getStdString();
+      openChannel();
+    });
+  }
+
+  void ShmOverlayDisplay::updateSize()
+  {
+    width_ = width_property_->getInt();
+    height_ = height_property_->getInt();
+    // the newest frame is uploaded again with the new panel size
+    reader_.forgetLastFrame();
+  }
+
+  void ShmOverlayDisplay::updateLeft()
+  {
+    left_ = left_property_->getInt();
+    if (overlay_) {
+      overlay_->setPosition(left_, top_);
+    }
+  }
+
+  void ShmOverlayDisplay::updateTop()
+  {
+    top_ = top_property_->getInt();
+    if (overlay_) {
+      overlay_->setPosition(left_, top_);
+    }
+  }
+
+  void ShmOverlayDisplay::updateDrawPriority()
+  {
+    scheduled_draw_->setPriority(draw_priority_property_->getInt());
+    overlay_->setPriority(draw_priority_property_->getInt());
+  }
+
+  bool ShmOverlayDisplay::isInRegion(int x, int y)
+  {
+    return (top_ < y && top_ + panel_height_ > y &&
+            left_ < x && left_ + panel_width_ > x);
+  }
+
+  void ShmOverlayDisplay::movePosition(int x, int y)
+  {
+    top_ = y;
+    left_ = x;
+  }
+
+  void ShmOverlayDisplay::setPosition(int x, int y)
+  {
+    top_property_->setValue(y);
+    left_property_->setValue(x);
+  }
+}  // namespace rviz_2d_overlay_plugins
+
+#include <pluginlib/class_list_macros.hpp>
+PLUGINLIB_EXPORT_CLASS( rviz_2d_overlay_plugins::ShmOverlayDisplay, rviz_common::Display )
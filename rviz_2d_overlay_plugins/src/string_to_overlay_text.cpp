@@ -4,22 +4,131 @@
 // ros2 topic pub /chatter std_msgs/String "data: Hello world"
 // ros2 run rviz_2d_overlay_plugins string_to_overlay_text
 // ros2 run rviz_2d_overlay_plugins string_to_overlay_text --ros-args -p string_topic:=chatter -p fg_color:=r
+// ros2 run rviz_2d_overlay_plugins string_to_overlay_text --ros-args -p mappings:="[status, log]" -p status.string_topic:=status -p log.string_topic:=log -p log.max_rate:=10.0
 // ros2 launch rviz_2d_overlay_plugins string_to_overlay_text_example.launch.py
+// ros2 component load /ComponentManager rviz_2d_overlay_plugins rviz_2d_overlay_plugins::Rviz2dString
 
+#include <chrono>
 #include <iostream>
+#include <memory>
 #include <vector>
 #include "rclcpp/rclcpp.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
 #include "rviz_2d_overlay_msgs/msg/overlay_text.hpp"
 #include "std_msgs/msg/string.hpp"
 #include "rcl_interfaces/msg/set_parameters_result.hpp"
+#include "diagnostic_msgs/msg/diagnostic_array.hpp"
+#include "overlay_text_parameters.hpp"
 
 
 
 using namespace std::chrono_literals;
 using std::placeholders::_1;
 
+namespace rviz_2d_overlay_plugins
+{
+
 class Rviz2dString : public rclcpp::Node
 {
+    // One string topic converted to one overlay text topic
+    struct Mapping
+    {
+        // parameter prefix, empty for the single topic configuration
+        std::string name;
+        std::string string_topic;
+        std::string overlay_text_topic;
+        // formatting of every message, the text of the prototype stays empty
+        rviz_2d_overlay_msgs::msg::OverlayText message;
+        // last published text, only kept to suppress duplicates
+        std::string last_text;
+        // formatting changed since the last publish, so an unchanged text has to be sent again
+        bool message_changed = true;
+        bool suppress_duplicates = false;
+        std::chrono::nanoseconds min_period{0};
+        std::chrono::steady_clock::time_point last_publish;
+        // latest text received within min_period of the last publish, sent by flush_timer
+        std::string pending_text;
+        bool pending = false;
+        rclcpp::TimerBase::SharedPtr flush_timer;
+        rclcpp::Subscription<std_msgs::msg::String>::SharedPtr subscription;
+        rclcpp::Publisher<rviz_2d_overlay_msgs::msg::OverlayText>::SharedPtr publisher;
+
+        // every received text is counted once: received == forwarded + coalesced + duplicates, plus one while a
+        // text is pending
+        uint64_t received = 0;
+        uint64_t forwarded = 0;
+        // pending texts replaced by a newer one before they were sent
+        uint64_t coalesced = 0;
+        uint64_t duplicates = 0;
+    };
+
+    // applies a parameter (without the mapping prefix), returns false for unknown keys
+    bool applyParameter(Mapping &mapping, const std::string &key, const rclcpp::Parameter &param)
+    {
+        if (key == "max_rate")
+        {
+            const double max_rate = param.as_double();
+            mapping.min_period = max_rate > 0.0
+                ? std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::duration<double>(1.0 / max_rate))
+                : std::chrono::nanoseconds(0);
+            updateFlushTimer(mapping);
+            return true;
+        }
+        if (key == "suppress_duplicates")
+        {
+            mapping.suppress_duplicates = param.as_bool();
+            // last_text is only kept while duplicates are suppressed, the next text is always sent
+            mapping.message_changed = true;
+            return true;
+        }
+        if (applyOverlayTextParameter(mapping.message, key, param))
+        {
+            mapping.message_changed = true;
+            return true;
+        }
+        return false;
+    }
+
+    // (re)creates the trailing-edge flush timer of a rate limited mapping, it only runs while texts are pending
+    void updateFlushTimer(Mapping &mapping)
+    {
+        if (mapping.flush_timer)
+        {
+            mapping.flush_timer->cancel();
+            mapping.flush_timer.reset();
+        }
+        if (mapping.min_period.count() == 0)
+        {
+            if (mapping.pending && mapping.publisher)
+            {
+                publishText(mapping, mapping.pending_text);
+            }
+            mapping.pending = false;
+            return;
+        }
+        Mapping *m = &mapping;
+        mapping.flush_timer = this->create_wall_timer(mapping.min_period, [this, m]() { flush(*m); });
+        if (!mapping.pending)
+        {
+            mapping.flush_timer->cancel();
+        }
+    }
+
+    // declares the parameters of a mapping, the defaults match the former single topic node
+    void declareMappingParameters(Mapping &mapping)
+    {
+        const std::string prefix = mapping.name.empty() ? "" : mapping.name + ".";
+        declareOverlayTextParameters(*this, prefix, mapping.message);
+        const std::vector<rclcpp::Parameter> parameters{
+            rclcpp::Parameter("max_rate", this->declare_parameter<double>(prefix + "max_rate", 0.0)),
+            rclcpp::Parameter("suppress_duplicates", this->declare_parameter<bool>(prefix + "suppress_duplicates", false)),
+        };
+        for (const auto &param: parameters)
+        {
+            applyParameter(mapping, param.get_name(), param);
+        }
+    }
+
     rcl_interfaces::msg::SetParametersResult parametersCallback(const std::vector<rclcpp::Parameter> &parameters)
     {
         rcl_interfaces::msg::SetParametersResult result;
@@ -28,106 +137,222 @@ class Rviz2dString : public rclcpp::Node
         for (const auto &param: parameters)
         {
             RCLCPP_INFO_STREAM(this->get_logger(), "Param update: " << param.get_name().c_str() << ": " <<param.value_to_string().c_str());
-            if (param.get_name() == "string_topic")
+            for (auto &mapping: mappings_)
             {
-                string_topic = param.as_string();
-                overlay_text_topic = string_topic + "_overlay_text";
+                const std::string prefix = mapping->name.empty() ? "" : mapping->name + ".";
+                if (param.get_name().rfind(prefix, 0) != 0)
+                {
+                    continue;
+                }
+                const std::string key = param.get_name().substr(prefix.size());
+                if (key == "string_topic" || key == "overlay_text_topic")
+                {
+                    RCLCPP_WARN_STREAM(this->get_logger(), "Topics are only read on startup, ignoring update of " << param.get_name());
+                }
+                else
+                {
+                    applyParameter(*mapping, key, param);
+                }
             }
-            if (param.get_name() == "fg_color")
-            {
-                fg_color = param.as_string();
-            }            
         }
-        RCLCPP_INFO_STREAM(this->get_logger(), "subscribed: " << string_topic << " publishing: " << overlay_text_topic << " fg color: " << fg_color << " ");
         return result;
     }
 
 public:
-    Rviz2dString() : Node("rviz2d_from_string_node")
-    {      
-        this->declare_parameter<std::string>("string_topic", "");
-        this->declare_parameter<std::string>("fg_color", "");
-        this->get_parameter("string_topic", string_topic);
-        this->get_parameter("fg_color", fg_color);
-        if (string_topic == "")
+    explicit Rviz2dString(const rclcpp::NodeOptions &options = rclcpp::NodeOptions())
+        : Node("rviz2d_from_string_node", options)
+    {
+        const auto mapping_names = this->declare_parameter<std::vector<std::string>>("mappings", std::vector<std::string>());
+        if (mapping_names.empty())
+        {
+            // single topic configuration
+            auto mapping = std::make_unique<Mapping>();
+            mapping->string_topic = this->declare_parameter<std::string>("string_topic", "");
+            if (mapping->string_topic == "")
+            {
+                RCLCPP_ERROR_STREAM(this->get_logger(), "Parameter string_topic not set");
+                mapping->string_topic = "/chatter";
+            }
+            mappings_.push_back(std::move(mapping));
+        }
+        for (const auto &name: mapping_names)
         {
-            RCLCPP_ERROR_STREAM(this->get_logger(), "Parameter string_topic not set");
-            string_topic = "/chatter";   
+            auto mapping = std::make_unique<Mapping>();
+            mapping->name = name;
+            mapping->string_topic = this->declare_parameter<std::string>(name + ".string_topic", name);
+            mappings_.push_back(std::move(mapping));
         }
-        overlay_text_topic = string_topic + "_overlay_text";
 
-        sub_st_ = this->create_subscription<std_msgs::msg::String>(string_topic, 10, std::bind(&Rviz2dString::strCallback, this, _1));
-        pub_ov_ = this->create_publisher<rviz_2d_overlay_msgs::msg::OverlayText>(overlay_text_topic, 1);
+        intra_process_ = this->get_node_options().use_intra_process_comms();
+        for (auto &mapping: mappings_)
+        {
+            const std::string prefix = mapping->name.empty() ? "" : mapping->name + ".";
+            mapping->overlay_text_topic = this->declare_parameter<std::string>(
+                prefix + "overlay_text_topic", mapping->string_topic + "_overlay_text");
+            declareMappingParameters(*mapping);
+
+            Mapping *m = mapping.get();
+            mapping->subscription = this->create_subscription<std_msgs::msg::String>(
+                mapping->string_topic, 10, [this, m](std_msgs::msg::String::UniquePtr st_msg) { strCallback(*m, std::move(st_msg)); });
+            mapping->publisher = this->create_publisher<rviz_2d_overlay_msgs::msg::OverlayText>(mapping->overlay_text_topic, 1);
+            RCLCPP_INFO_STREAM(this->get_logger(), "subscribed: " << mapping->string_topic << " publishing: " << mapping->overlay_text_topic << " ");
+        }
         callback_handle_ = this->add_on_set_parameters_callback(std::bind(&Rviz2dString::parametersCallback, this, std::placeholders::_1));
-        RCLCPP_INFO_STREAM(this->get_logger(), "Node started: " << this->get_name() << " subscribed: " << string_topic << " publishing: " << overlay_text_topic << " ");
+
+        const double diagnostics_period = this->declare_parameter<double>("diagnostics_period", 1.0);
+        if (diagnostics_period > 0.0)
+        {
+            pub_diagnostics_ = this->create_publisher<diagnostic_msgs::msg::DiagnosticArray>("/diagnostics", 1);
+            diagnostics_timer_ = this->create_wall_timer(
+                std::chrono::duration<double>(diagnostics_period), [this]() { publishDiagnostics(); });
+        }
+        RCLCPP_INFO_STREAM(this->get_logger(), "Node started: " << this->get_name() << " with " << mappings_.size() << " topic(s)");
     }
 
-private:
-    // Callback for string
-    void strCallback(const std_msgs::msg::String &st_msg)
+    struct Counters
     {
-        rviz_2d_overlay_msgs::msg::OverlayText ov_msg;
-        ov_msg.text = st_msg.data;
-        ov_msg.fg_color.a = 1.0;
+        uint64_t received, forwarded, coalesced, duplicates;
+    };
 
-        // https://github.com/jkk-research/colors
-        if (fg_color == "r") // red
+    // message counters of the mapping subscribed to string_topic, summed up over all mappings for an empty topic
+    Counters counters(const std::string &string_topic = "") const
+    {
+        Counters counters{0, 0, 0, 0};
+        for (const auto &mapping: mappings_)
         {
-            ov_msg.fg_color.r = 0.96f;
-            ov_msg.fg_color.g = 0.22f;
-            ov_msg.fg_color.b = 0.06f;
+            if (string_topic.empty() || mapping->string_topic == string_topic)
+            {
+                counters.received += mapping->received;
+                counters.forwarded += mapping->forwarded;
+                counters.coalesced += mapping->coalesced;
+                counters.duplicates += mapping->duplicates;
+            }
         }
-        else if (fg_color == "g") // green
+        return counters;
+    }
+
+private:
+    // Callback for string, taking ownership allows moving the text when running in the same process
+    void strCallback(Mapping &mapping, std_msgs::msg::String::UniquePtr st_msg)
+    {
+        mapping.received++;
+        std::string &text = st_msg->data;
+
+        if (mapping.suppress_duplicates && !mapping.message_changed)
         {
-            ov_msg.fg_color.r = 0.30f;
-            ov_msg.fg_color.g = 0.69f;
-            ov_msg.fg_color.b = 0.31f;
+            // latest-wins: a text equal to the one that would be shown next changes nothing
+            if (text == (mapping.pending ? mapping.pending_text : mapping.last_text))
+            {
+                mapping.duplicates++;
+                return;
+            }
+            // back to the displayed text: the pending text is coalesced, this one is a duplicate
+            if (mapping.pending && text == mapping.last_text)
+            {
+                mapping.pending = false;
+                mapping.coalesced++;
+                mapping.duplicates++;
+                return;
+            }
         }
-        else if (fg_color == "b") // blue
+
+        const auto now = std::chrono::steady_clock::now();
+        if (mapping.min_period.count() > 0 && (mapping.pending || now - mapping.last_publish < mapping.min_period))
         {
-            ov_msg.fg_color.r = 0.02f;
-            ov_msg.fg_color.g = 0.50f;
-            ov_msg.fg_color.b = 0.70f;
+            // leading edge already sent, keep only the latest text for the trailing edge
+            if (mapping.pending)
+            {
+                mapping.coalesced++;
+            }
+            mapping.pending_text.swap(text);
+            mapping.pending = true;
+            return;
         }
-        else if (fg_color == "k") // black
+        publishText(mapping, text);
+        if (mapping.flush_timer)
         {
-            ov_msg.fg_color.r = 0.19f;
-            ov_msg.fg_color.g = 0.19f;
-            ov_msg.fg_color.b = 0.23f;
+            // the trailing edge follows min_period after this publish, the timer is canceled if nothing is pending
+            mapping.flush_timer->reset();
         }
-        else if (fg_color == "w") // white
+    }
+
+    // trailing edge of the rate limit, keeps running at max_rate while texts arrive faster
+    void flush(Mapping &mapping)
+    {
+        if (!mapping.pending)
         {
-            ov_msg.fg_color.r = 0.89f;
-            ov_msg.fg_color.g = 0.89f;
-            ov_msg.fg_color.b = 0.93f;
-        }    
-        else if (fg_color == "p") // pink
+            mapping.flush_timer->cancel();
+            return;
+        }
+        mapping.pending = false;
+        publishText(mapping, mapping.pending_text);
+    }
+
+    // publishes the text with the formatting of the mapping, text is moved from
+    void publishText(Mapping &mapping, std::string &text)
+    {
+        mapping.last_publish = std::chrono::steady_clock::now();
+        mapping.message_changed = false;
+        mapping.forwarded++;
+
+        if (intra_process_)
         {
-            ov_msg.fg_color.r = 0.91f;
-            ov_msg.fg_color.g = 0.12f;
-            ov_msg.fg_color.b = 0.39f;
-        }                     
+            // unique_ptr allows zero-copy intra-process publishing, the prototype only carries the formatting
+            auto message = std::make_unique<rviz_2d_overlay_msgs::msg::OverlayText>(mapping.message);
+            if (mapping.suppress_duplicates)
+            {
+                mapping.last_text = text;
+            }
+            message->text = std::move(text);
+            mapping.publisher->publish(std::move(message));
+        }
         else
-        { // yellow
-            ov_msg.fg_color.r = 0.94f;
-            ov_msg.fg_color.g = 0.83f;
-            ov_msg.fg_color.b = 0.07f;
-        }        
-        ov_msg.width = 200;
-        ov_msg.height = 40;
-        pub_ov_->publish(ov_msg);
+        {
+            // serialized from the prototype, the text is swapped in and out again
+            mapping.message.text.swap(text);
+            mapping.publisher->publish(mapping.message);
+            mapping.message.text.swap(text);
+            if (mapping.suppress_duplicates)
+            {
+                mapping.last_text.swap(text);
+            }
+        }
+    }
+
+    void publishDiagnostics()
+    {
+        diagnostic_msgs::msg::DiagnosticArray array;
+        array.header.stamp = this->now();
+        for (const auto &mapping: mappings_)
+        {
+            diagnostic_msgs::msg::DiagnosticStatus status;
+            status.level = diagnostic_msgs::msg::DiagnosticStatus::OK;
+            status.name = std::string(this->get_name()) + ": " + mapping->string_topic;
+            status.message = "ok";
+            status.hardware_id = mapping->overlay_text_topic;
+            const auto add_value = [&status](const std::string &key, uint64_t value) {
+                diagnostic_msgs::msg::KeyValue key_value;
+                key_value.key = key;
+                key_value.value = std::to_string(value);
+                status.values.push_back(std::move(key_value));
+            };
+            add_value("received", mapping->received);
+            add_value("forwarded", mapping->forwarded);
+            add_value("coalesced", mapping->coalesced);
+            add_value("duplicates", mapping->duplicates);
+            array.status.push_back(std::move(status));
+        }
+        pub_diagnostics_->publish(array);
     }
 
-    rclcpp::Subscription<std_msgs::msg::String>::SharedPtr sub_st_;
-    std::string string_topic, overlay_text_topic, fg_color;
-    rclcpp::Publisher<rviz_2d_overlay_msgs::msg::OverlayText>::SharedPtr pub_ov_;
+    // unique_ptr keeps the mappings at a fixed address for the subscription callbacks
+    std::vector<std::unique_ptr<Mapping>> mappings_;
+    bool intra_process_;
     OnSetParametersCallbackHandle::SharedPtr callback_handle_;
+    rclcpp::Publisher<diagnostic_msgs::msg::DiagnosticArray>::SharedPtr pub_diagnostics_;
+    rclcpp::TimerBase::SharedPtr diagnostics_timer_;
 };
 
-int main(int argc, char **argv)
-{
-    rclcpp::init(argc, argv);
-    rclcpp::spin(std::make_shared<Rviz2dString>());
-    rclcpp::shutdown();
-    return 0;
-}
\ No newline at end of file
+} // namespace rviz_2d_overlay_plugins
+
+RCLCPP_COMPONENTS_REGISTER_NODE(rviz_2d_overlay_plugins::Rviz2dString)
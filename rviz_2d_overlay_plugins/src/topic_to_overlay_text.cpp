@@ -0,0 +1,201 @@
+// publishes rviz_2d_overlay_msgs/msg/OverlayText from fields of arbitrary messages
+
+// test with:
+// ros2 topic pub /cmd_vel geometry_msgs/Twist "linear: {x: 0.5}"
+// ros2 run rviz_2d_overlay_plugins topic_to_overlay_text --ros-args -p topic:=cmd_vel -p message_type:=geometry_msgs/msg/Twist -p format:="v={linear.x:.2f} m/s"
+// ros2 component load /ComponentManager rviz_2d_overlay_plugins rviz_2d_overlay_plugins::TopicToOverlayText
+
+#include <memory>
+#include <vector>
+#include "rclcpp/rclcpp.hpp"
+#include "rclcpp/expand_topic_or_service_name.hpp"
+#include "rclcpp_components/register_node_macro.hpp"
+#include "rviz_2d_overlay_msgs/msg/overlay_text.hpp"
+#include "rcl_interfaces/msg/set_parameters_result.hpp"
+#include "ros_babel_fish/babel_fish.hpp"
+#include "field_formatter.hpp"
+#include "overlay_text_parameters.hpp"
+
+
+
+namespace rviz_2d_overlay_plugins
+{
+
+class TopicToOverlayText : public rclcpp::Node
+{
+    // One topic formatted into one overlay text topic
+    struct Mapping
+    {
+        // parameter prefix, empty for the single topic configuration
+        std::string name;
+        std::string topic;
+        std::string overlay_text_topic;
+        std::unique_ptr<FieldFormatter> formatter;
+        // reused for every message, only the text changes
+        rviz_2d_overlay_msgs::msg::OverlayText message;
+        // formatting output, swapped with the text of message to keep both allocations
+        std::string text;
+        ros_babel_fish::BabelFishSubscription::SharedPtr subscription;
+        rclcpp::Publisher<rviz_2d_overlay_msgs::msg::OverlayText>::SharedPtr publisher;
+    };
+
+    rcl_interfaces::msg::SetParametersResult parametersCallback(const std::vector<rclcpp::Parameter> &parameters)
+    {
+        rcl_interfaces::msg::SetParametersResult result;
+        result.successful = true;
+        result.reason = "success";
+        for (const auto &param: parameters)
+        {
+            RCLCPP_INFO_STREAM(this->get_logger(), "Param update: " << param.get_name().c_str() << ": " <<param.value_to_string().c_str());
+            for (auto &mapping: mappings_)
+            {
+                const std::string prefix = mapping->name.empty() ? "" : mapping->name + ".";
+                if (param.get_name().rfind(prefix, 0) != 0)
+                {
+                    continue;
+                }
+                const std::string key = param.get_name().substr(prefix.size());
+                if (key == "format")
+                {
+                    try
+                    {
+                        mapping->formatter = std::make_unique<FieldFormatter>(param.as_string());
+                    }
+                    catch (const std::invalid_argument &e)
+                    {
+                        result.successful = false;
+                        result.reason = e.what();
+                    }
+                }
+                else if (key == "topic" || key == "message_type" || key == "overlay_text_topic")
+                {
+                    RCLCPP_WARN_STREAM(this->get_logger(), "Topics are only read on startup, ignoring update of " << param.get_name());
+                }
+                else
+                {
+                    applyOverlayTextParameter(mapping->message, key, param);
+                }
+            }
+        }
+        return result;
+    }
+
+    // message type of a topic that is already advertised, empty if unknown
+    std::string lookupMessageType(const std::string &topic)
+    {
+        const auto topics = this->get_topic_names_and_types();
+        const auto it = topics.find(rclcpp::expand_topic_or_service_name(topic, this->get_name(), this->get_namespace()));
+        if (it == topics.end() || it->second.empty())
+        {
+            return "";
+        }
+        return it->second.front();
+    }
+
+public:
+    explicit TopicToOverlayText(const rclcpp::NodeOptions &options = rclcpp::NodeOptions())
+        : Node("topic_to_overlay_text_node", options), fish_(ros_babel_fish::BabelFish::make_shared())
+    {
+        auto mapping_names = this->declare_parameter<std::vector<std::string>>("mappings", std::vector<std::string>());
+        const bool single_topic = mapping_names.empty();
+        if (single_topic)
+        {
+            mapping_names.emplace_back();
+        }
+
+        intra_process_ = this->get_node_options().use_intra_process_comms();
+        for (const auto &name: mapping_names)
+        {
+            const std::string prefix = single_topic ? "" : name + ".";
+            auto mapping = std::make_unique<Mapping>();
+            mapping->name = name;
+            mapping->topic = this->declare_parameter<std::string>(prefix + "topic", name);
+            std::string message_type = this->declare_parameter<std::string>(prefix + "message_type", "");
+            const std::string format = this->declare_parameter<std::string>(prefix + "format", "{data}");
+            mapping->overlay_text_topic = this->declare_parameter<std::string>(
+                prefix + "overlay_text_topic", mapping->topic + "_overlay_text");
+            declareOverlayTextParameters(*this, prefix, mapping->message);
+
+            if (mapping->topic.empty())
+            {
+                RCLCPP_ERROR_STREAM(this->get_logger(), "Parameter " << prefix << "topic not set");
+                continue;
+            }
+            if (message_type.empty())
+            {
+                message_type = lookupMessageType(mapping->topic);
+                if (message_type.empty())
+                {
+                    RCLCPP_ERROR_STREAM(this->get_logger(), "Parameter " << prefix << "message_type not set and "
+                        << mapping->topic << " is not advertised");
+                    continue;
+                }
+            }
+            try
+            {
+                mapping->formatter = std::make_unique<FieldFormatter>(format);
+            }
+            catch (const std::invalid_argument &e)
+            {
+                RCLCPP_ERROR_STREAM(this->get_logger(), "Invalid " << prefix << "format: " << e.what());
+                continue;
+            }
+
+            Mapping *m = mapping.get();
+            try
+            {
+                mapping->subscription = fish_->create_subscription(
+                    *this, mapping->topic, message_type, rclcpp::QoS(10),
+                    [this, m](ros_babel_fish::CompoundMessage::ConstSharedPtr msg) { msgCallback(*m, *msg); });
+            }
+            catch (const ros_babel_fish::BabelFishException &e)
+            {
+                RCLCPP_ERROR_STREAM(this->get_logger(), "Error subscribing to " << mapping->topic << ": " << e.what());
+                continue;
+            }
+            mapping->publisher = this->create_publisher<rviz_2d_overlay_msgs::msg::OverlayText>(mapping->overlay_text_topic, 1);
+            RCLCPP_INFO_STREAM(this->get_logger(), "subscribed: " << mapping->topic << " (" << message_type << ") publishing: " << mapping->overlay_text_topic << " ");
+            mappings_.push_back(std::move(mapping));
+        }
+        callback_handle_ = this->add_on_set_parameters_callback(std::bind(&TopicToOverlayText::parametersCallback, this, std::placeholders::_1));
+        RCLCPP_INFO_STREAM(this->get_logger(), "Node started: " << this->get_name() << " with " << mappings_.size() << " topic(s)");
+    }
+
+private:
+    void msgCallback(Mapping &mapping, const ros_babel_fish::CompoundMessage &msg)
+    {
+        try
+        {
+            mapping.formatter->format(msg, mapping.text);
+        }
+        catch (const ros_babel_fish::BabelFishException &e)
+        {
+            RCLCPP_WARN_STREAM_THROTTLE(this->get_logger(), *this->get_clock(), 5000, mapping.topic << ": " << e.what());
+            return;
+        }
+        if (intra_process_)
+        {
+            // the template of the mapping keeps an empty text, only its style fields are copied and the formatted
+            // text is moved into the message handed over to the subscribers
+            auto message = std::make_unique<rviz_2d_overlay_msgs::msg::OverlayText>(mapping.message);
+            message->text.swap(mapping.text);
+            mapping.publisher->publish(std::move(message));
+        }
+        else
+        {
+            // the previous text becomes the buffer the next message is formatted into
+            mapping.message.text.swap(mapping.text);
+            mapping.publisher->publish(mapping.message);
+        }
+    }
+
+    ros_babel_fish::BabelFish::SharedPtr fish_;
+    // unique_ptr keeps the mappings at a fixed address for the subscription callbacks
+    std::vector<std::unique_ptr<Mapping>> mappings_;
+    bool intra_process_;
+    OnSetParametersCallbackHandle::SharedPtr callback_handle_;
+};
+
+} // namespace rviz_2d_overlay_plugins
+
+RCLCPP_COMPONENTS_REGISTER_NODE(rviz_2d_overlay_plugins::TopicToOverlayText)
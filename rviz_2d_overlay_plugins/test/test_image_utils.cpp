@@ -0,0 +1,174 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "image_utils.hpp"
+
+using rviz_2d_overlay_plugins::ImageFormat;
+using rviz_2d_overlay_plugins::ImageView;
+
+namespace
+{
+  std::vector<uint8_t> uniformImage(uint32_t width, uint32_t height, const std::vector<uint8_t> & pixel)
+  {
+    std::vector<uint8_t> image;
+    image.reserve(static_cast<size_t>(width) * height * pixel.size());
+    for (size_t i = 0; i < static_cast<size_t>(width) * height; i++) {
+      image.insert(image.end(), pixel.begin(), pixel.end());
+    }
+    return image;
+  }
+
+  void expectUniformDownscale(uint32_t source_width, uint32_t source_height, uint32_t width, uint32_t height,
+                              ImageFormat format, const std::vector<uint8_t> & pixel)
+  {
+    const std::vector<uint8_t> source = uniformImage(source_width, source_height, pixel);
+    ImageView view;
+    view.data = source.data();
+    view.width = source_width;
+    view.height = source_height;
+    view.step = source_width * pixel.size();
+    view.format = format;
+
+    std::vector<uint8_t> target;
+    rviz_2d_overlay_plugins::downscaleArea(view, width, height, target);
+    ASSERT_EQ(target, uniformImage(width, height, pixel))
+      << source_width << "x" << source_height << " to " << width << "x" << height;
+  }
+
+  // area average of a mono image in double precision
+  std::vector<double> referenceDownscale(const std::vector<uint8_t> & source, uint32_t source_width,
+                                         uint32_t source_height, uint32_t width, uint32_t height)
+  {
+    const double scale_x = static_cast<double>(source_width) / width;
+    const double scale_y = static_cast<double>(source_height) / height;
+    std::vector<double> target(static_cast<size_t>(width) * height, 0.0);
+    for (uint32_t y = 0; y < height; y++) {
+      for (uint32_t x = 0; x < width; x++) {
+        double sum = 0.0;
+        for (uint32_t sy = 0; sy < source_height; sy++) {
+          const double cover_y = std::min<double>(sy + 1, (y + 1) * scale_y) - std::max<double>(sy, y * scale_y);
+          if (cover_y <= 0.0) {
+            continue;
+          }
+          for (uint32_t sx = 0; sx < source_width; sx++) {
+            const double cover_x = std::min<double>(sx + 1, (x + 1) * scale_x) - std::max<double>(sx, x * scale_x);
+            if (cover_x > 0.0) {
+              sum += cover_x * cover_y * source[sy * source_width + sx];
+            }
+          }
+        }
+        target[y * width + x] = sum / (scale_x * scale_y);
+      }
+    }
+    return target;
+  }
+}  // namespace
+
+TEST(DownscaleArea, UniformImageStaysUniformForIntegerFactors)
+{
+  for (uint32_t factor = 2; factor <= 64; factor++) {
+    expectUniformDownscale(7 * factor, 5 * factor, 7, 5, ImageFormat::BGRA8, {37, 180, 255, 200});
+    expectUniformDownscale(7 * factor, 5 * factor, 7, 5, ImageFormat::MONO8, {201});
+  }
+}
+
+TEST(DownscaleArea, UniformImageStaysUniformForFractionalFactors)
+{
+  for (uint32_t factor = 2; factor <= 64; factor++) {
+    // the target pixels cover fractions of the source pixels at both of their borders
+    expectUniformDownscale(7 * factor + factor / 2 + 1, 5 * factor + 1, 7, 5, ImageFormat::RGBA8, {255, 0, 128, 255});
+  }
+}
+
+TEST(DownscaleArea, UniformThumbnails)
+{
+  expectUniformDownscale(1920, 1080, 64, 36, ImageFormat::BGRA8, {255, 255, 255, 255});
+  expectUniformDownscale(3000, 2000, 100, 66, ImageFormat::BGRA8, {12, 34, 56, 78});
+}
+
+TEST(DownscaleArea, MatchesAreaAverage)
+{
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<int> value(0, 255);
+  for (uint32_t factor = 2; factor <= 64; factor++) {
+    const uint32_t width = 3;
+    const uint32_t height = 2;
+    const uint32_t source_width = width * factor + factor / 3;
+    const uint32_t source_height = height * factor;
+    std::vector<uint8_t> source(static_cast<size_t>(source_width) * source_height);
+    for (auto & pixel : source) {
+      pixel = static_cast<uint8_t>(value(rng));
+    }
+    ImageView view;
+    view.data = source.data();
+    view.width = source_width;
+    view.height = source_height;
+    view.step = source_width;
+    view.format = ImageFormat::MONO8;
+
+    std::vector<uint8_t> target;
+    rviz_2d_overlay_plugins::downscaleArea(view, width, height, target);
+    const std::vector<double> reference = referenceDownscale(source, source_width, source_height, width, height);
+    ASSERT_EQ(target.size(), reference.size());
+    for (size_t i = 0; i < target.size(); i++) {
+      // 8 bit weights, the error stays within one step
+      EXPECT_NEAR(target[i], reference[i], 1.5) << "factor " << factor << ", pixel " << i;
+    }
+  }
+}
+
+TEST(DownscaleArea, AveragesCoveredPixels)
+{
+  // two columns of black and white average to gray
+  const std::vector<uint8_t> source{0, 255, 0, 255, 0, 255, 0, 255};
+  ImageView view;
+  view.data = source.data();
+  view.width = 4;
+  view.height = 2;
+  view.step = 4;
+  view.format = ImageFormat::MONO8;
+  std::vector<uint8_t> target;
+  rviz_2d_overlay_plugins::downscaleArea(view, 2, 1, target);
+  EXPECT_EQ(target, std::vector<uint8_t>({128, 128}));
+}
@@ -0,0 +1,247 @@
+// -*- mode: c++; -*-
+/*********************************************************************
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2024, rcp1
+ *  Copyright (c) 2014, JSK Lab
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of the JSK Lab nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ *********************************************************************/
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include "shm_overlay_channel.hpp"
+
+using rviz_2d_overlay_plugins::ShmFrame;
+using rviz_2d_overlay_plugins::ShmOverlayReader;
+using rviz_2d_overlay_plugins::ShmOverlayWriter;
+using rviz_2d_overlay_plugins::ShmPixelFormat;
+
+namespace
+{
+  std::string channelName(const std::string & test)
+  {
+    return "/rviz_2d_overlay_test_" + test + "_" + std::to_string(getpid());
+  }
+
+  // every pixel of the frame has the value of the low byte of the frame number
+  void writeFrame(ShmOverlayWriter & writer, uint32_t width, uint32_t height, uint8_t value)
+  {
+    const std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4, value);
+    writer.write(pixels.data(), width, height, width * 4, ShmPixelFormat::BGRA8);
+  }
+
+  std::vector<uint8_t> copyFrame(const ShmFrame & frame)
+  {
+    std::vector<uint8_t> pixels;
+    for (uint32_t y = 0; y < frame.height; y++) {
+      const uint8_t * row = frame.data + static_cast<size_t>(y) * frame.step;
+      pixels.insert(pixels.end(), row, row + frame.width * 4);
+    }
+    return pixels;
+  }
+}  // namespace
+
+TEST(ShmOverlayChannel, RoundTrip)
+{
+  const std::string name = channelName("round_trip");
+  ShmOverlayWriter writer(name, 64, 32);
+  ShmOverlayReader reader;
+  std::string error;
+  ASSERT_TRUE(reader.open(name, error)) << error;
+  EXPECT_FALSE(reader.hasNewFrame());
+
+  uint32_t step;
+  uint8_t * pixels = writer.beginFrame(16, 8, ShmPixelFormat::RGBA8, step);
+  ASSERT_GE(step, 16u * 4);
+  for (uint32_t y = 0; y < 8; y++) {
+    for (uint32_t x = 0; x < 16 * 4; x++) {
+      pixels[y * step + x] = static_cast<uint8_t>(y * 64 + x);
+    }
+  }
+  // not published before endFrame()
+  ShmFrame frame;
+  EXPECT_FALSE(reader.hasNewFrame());
+  EXPECT_FALSE(reader.beginRead(frame));
+  writer.endFrame();
+
+  ASSERT_TRUE(reader.hasNewFrame());
+  ASSERT_TRUE(reader.beginRead(frame));
+  EXPECT_EQ(frame.width, 16u);
+  EXPECT_EQ(frame.height, 8u);
+  EXPECT_EQ(frame.format, ShmPixelFormat::RGBA8);
+  EXPECT_EQ(frame.number, 1u);
+  const std::vector<uint8_t> copy = copyFrame(frame);
+  ASSERT_TRUE(reader.endRead(frame));
+  for (uint32_t y = 0; y < 8; y++) {
+    for (uint32_t x = 0; x < 16 * 4; x++) {
+      ASSERT_EQ(copy[y * 16 * 4 + x], static_cast<uint8_t>(y * 64 + x));
+    }
+  }
+  EXPECT_EQ(reader.lastFrame(), 1u);
+  EXPECT_FALSE(reader.hasNewFrame());
+  EXPECT_FALSE(reader.beginRead(frame));
+
+  // the newest frame is read, older ones are skipped
+  writeFrame(writer, 64, 32, 2);
+  writeFrame(writer, 32, 32, 3);
+  ASSERT_TRUE(reader.beginRead(frame));
+  EXPECT_EQ(frame.number, 3u);
+  EXPECT_EQ(frame.width, 32u);
+  EXPECT_EQ(frame.format, ShmPixelFormat::BGRA8);
+  EXPECT_EQ(copyFrame(frame), std::vector<uint8_t>(32 * 32 * 4, 3));
+  EXPECT_TRUE(reader.endRead(frame));
+
+  reader.forgetLastFrame();
+  EXPECT_TRUE(reader.hasNewFrame());
+}
+
+TEST(ShmOverlayChannel, RejectsFramesLargerThanTheChannel)
+{
+  ShmOverlayWriter writer(channelName("size"), 64, 32);
+  uint32_t step;
+  EXPECT_THROW(writer.beginFrame(65, 32, ShmPixelFormat::RGBA8, step), std::invalid_argument);
+  EXPECT_THROW(writer.beginFrame(64, 33, ShmPixelFormat::RGBA8, step), std::invalid_argument);
+  EXPECT_THROW(writer.beginFrame(0, 32, ShmPixelFormat::RGBA8, step), std::invalid_argument);
+}
+
+TEST(ShmOverlayChannel, RejectsTornRead)
+{
+  const std::string name = channelName("torn");
+  ShmOverlayWriter writer(name, 8, 8, 3);
+  ShmOverlayReader reader;
+  std::string error;
+  ASSERT_TRUE(reader.open(name, error)) << error;
+
+  writeFrame(writer, 8, 8, 1);
+  ShmFrame frame;
+  ASSERT_TRUE(reader.beginRead(frame));
+  ASSERT_EQ(frame.number, 1u);
+  // frames 2 and 3 go to the other slots, frame 4 starts overwriting the slot of frame 1
+  writeFrame(writer, 8, 8, 2);
+  writeFrame(writer, 8, 8, 3);
+  uint32_t step;
+  uint8_t * pixels = writer.beginFrame(8, 8, ShmPixelFormat::BGRA8, step);
+  std::memset(pixels, 4, 8 * step);
+  EXPECT_FALSE(reader.endRead(frame));
+  EXPECT_EQ(reader.lastFrame(), 0u);
+  // the slot of the newest frame is intact
+  ASSERT_TRUE(reader.beginRead(frame));
+  EXPECT_EQ(frame.number, 3u);
+  writer.endFrame();
+  EXPECT_TRUE(reader.endRead(frame));
+
+  // a completely overwritten slot is rejected as well
+  ASSERT_TRUE(reader.beginRead(frame));
+  ASSERT_EQ(frame.number, 4u);
+  for (uint8_t value = 5; value <= 7; value++) {
+    writeFrame(writer, 8, 8, value);
+  }
+  EXPECT_FALSE(reader.endRead(frame));
+  EXPECT_EQ(reader.lastFrame(), 3u);
+}
+
+TEST(ShmOverlayChannel, ConfirmedReadsAreConsistent)
+{
+  const std::string name = channelName("concurrent");
+  constexpr uint32_t width = 64;
+  constexpr uint32_t height = 64;
+  ShmOverlayWriter writer(name, width, height, 2);
+  ShmOverlayReader reader;
+  std::string error;
+  ASSERT_TRUE(reader.open(name, error)) << error;
+
+  std::atomic<bool> done{false};
+  std::thread writer_thread([&]() {
+    for (uint32_t i = 1; i <= 20000; i++) {
+      writeFrame(writer, width, height, static_cast<uint8_t>(i));
+    }
+    done = true;
+  });
+  size_t confirmed = 0;
+  while (!done) {
+    ShmFrame frame;
+    if (!reader.beginRead(frame)) {
+      continue;
+    }
+    const std::vector<uint8_t> copy = copyFrame(frame);
+    if (!reader.endRead(frame)) {
+      continue;
+    }
+    confirmed++;
+    ASSERT_EQ(copy, std::vector<uint8_t>(width * height * 4, static_cast<uint8_t>(frame.number)))
+      << "frame " << frame.number;
+  }
+  writer_thread.join();
+  EXPECT_GT(confirmed, 0u);
+}
+
+TEST(ShmOverlayChannel, ReopensStaleChannel)
+{
+  const std::string name = channelName("stale");
+  ShmOverlayReader reader;
+  std::string error;
+  EXPECT_FALSE(reader.open(name, error));
+  EXPECT_TRUE(reader.isStale());
+
+  auto writer = std::make_unique<ShmOverlayWriter>(name, 8, 8);
+  ASSERT_TRUE(reader.open(name, error)) << error;
+  EXPECT_FALSE(reader.isStale());
+  writeFrame(*writer, 8, 8, 1);
+  ShmFrame frame;
+  ASSERT_TRUE(reader.beginRead(frame));
+  ASSERT_TRUE(reader.endRead(frame));
+
+  // a restarted writer replaces the channel, the reader keeps the old mapping until it opens the channel again
+  writer = std::make_unique<ShmOverlayWriter>(name, 16, 16);
+  EXPECT_TRUE(reader.isStale());
+  writeFrame(*writer, 16, 16, 2);
+  EXPECT_FALSE(reader.hasNewFrame());
+  ASSERT_TRUE(reader.open(name, error)) << error;
+  EXPECT_FALSE(reader.isStale());
+  ASSERT_TRUE(reader.beginRead(frame));
+  EXPECT_EQ(frame.number, 1u);
+  EXPECT_EQ(frame.width, 16u);
+  EXPECT_EQ(copyFrame(frame), std::vector<uint8_t>(16 * 16 * 4, 2));
+  EXPECT_TRUE(reader.endRead(frame));
+
+  // a writer that exits removes the channel
+  writer.reset();
+  EXPECT_TRUE(reader.isStale());
+  EXPECT_FALSE(reader.open(name, error));
+}